@@ -0,0 +1,175 @@
+/**
+ * @file nsync_bench.c
+ * Throughput benchmark of the `ip route` line scanner against the stdio
+ * reading it replaced (fmemopen, fgets and strstr). Builds a synthetic
+ * dump in memory, so no commands are run and nothing is written.
+ *
+ *   make nsync_bench && ./nsync_bench [lines]
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <time.h>
+#include "nsync_utils.h"
+#include "nsync_route.h"
+#include "nsync_scan.h"
+
+#define BENCH_DEFAULT_LINES 1000000
+#define BENCH_RUNS 5
+#define BENCH_LINE_LEN 1000     // the line buffer the stdio readers used
+
+/**
+ * @brief Builds an `ip route` dump in which one line in ten is a kernel route
+ * @param num_lines the number of lines
+ * @param out receives the dump
+ * @returns false if memory could not be allocated
+ */
+static bool bench_make_dump(int num_lines, exec_buf_t *out)
+{
+    out->cap = (size_t)num_lines * 96;
+    out->data = malloc(out->cap);
+    if (!out->data)
+        return false;
+
+    out->len = 0;
+    for (int i = 0; i < num_lines; i++) {
+        int n;
+        if (i % 10 == 0)
+            n = snprintf(&out->data[out->len], out->cap - out->len,
+                         "10.%d.%d.0/24 dev eth%d proto kernel scope link src 10.%d.%d.1 \n",
+                         (i >> 16) & 255, (i >> 8) & 255, i % 8, (i >> 16) & 255, (i >> 8) & 255);
+        else
+            n = snprintf(&out->data[out->len], out->cap - out->len,
+                         "172.%d.%d.0/24 via 192.0.2.%d dev eth%d proto static metric %d \n",
+                         16 + ((i >> 16) & 15), (i >> 8) & 255, 1 + i % 200, i % 8, 100 + i % 5);
+        out->len += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the time in seconds
+ */
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Reads the dump as the parsers did before the scanner
+ * @param dump the dump
+ * @param parse whether to parse the routes or only find them
+ * @returns the number of routes kept
+ */
+static int bench_stdio(const exec_buf_t *dump, bool parse)
+{
+    FILE *fp = fmemopen(dump->data, dump->len, "r");
+    if (!fp)
+        return -1;
+
+    char line[BENCH_LINE_LEN];
+    route_t rt;
+    int kept = 0;
+    while (fgets(line, BENCH_LINE_LEN, fp)) {
+        if (strstr(line, ROUTE_KERNEL_KW) != NULL)
+            continue;
+        if (parse && !route_parse(slice_make(line), &rt))
+            break;
+        kept++;
+    }
+    fclose(fp);
+    return kept;
+}
+
+/**
+ * @brief Reads the dump with the line scanner
+ * @param dump the dump
+ * @param parse whether to parse the routes or only find them
+ * @returns the number of routes kept
+ */
+static int bench_scan(const exec_buf_t *dump, bool parse)
+{
+    line_scanner_t scan;
+    str_slice_t line;
+    bool kernel;
+    route_t rt;
+    int kept = 0;
+    scan_init(&scan, dump->data, dump->len, ROUTE_KERNEL_KW);
+    while (scan_next_line(&scan, &line, &kernel)) {
+        if (kernel || line.len == 0)
+            continue;
+        if (parse && !route_parse(line, &rt))
+            break;
+        kept++;
+    }
+    return kept;
+}
+
+/**
+ * @brief Times a reader, taking the best of several runs
+ * @param name what is timed
+ * @param reader the reader
+ * @param dump the dump
+ * @param parse whether the routes are parsed
+ * @param num_lines the number of lines of the dump
+ */
+static void bench_run(const char *name, int (*reader)(const exec_buf_t *, bool),
+                      const exec_buf_t *dump, bool parse, int num_lines)
+{
+    double best = 0;
+    int kept = 0;
+    for (int r = 0; r < BENCH_RUNS; r++) {
+        double start = bench_now();
+        kept = reader(dump, parse);
+        double t = bench_now() - start;
+        if (r == 0 || t < best)
+            best = t;
+        arena_reset(parse_arena);
+    }
+    printf("%-24s %9.1f MB/s %8.1f ns/line %9d routes\n", name,
+           dump->len / best / 1e6, best * 1e9 / num_lines, kept);
+}
+
+int main(int argc, char *argv[])
+{
+    int num_lines = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_LINES;
+    if (num_lines <= 0) {
+        fprintf(stderr, "usage: %s [lines]\n", argv[0]);
+        return 1;
+    }
+
+    static arena_t arena;
+    static intern_table_t strings;
+    parse_arena = &arena;
+    parse_strings = &strings;
+
+    exec_buf_t dump = { 0 };
+    if (!bench_make_dump(num_lines, &dump)) {
+        fprintf(stderr, "could not allocate the dump\n");
+        return 1;
+    }
+    printf("%d lines, %.1f MB\n\n", num_lines, dump.len / 1e6);
+
+    /** Splitting lines and finding kernel routes alone, on every path the CPU has */
+    bench_run("fgets + strstr", bench_stdio, &dump, false, num_lines);
+    scan_isa_t best = scan_isa();
+    for (scan_isa_t isa = SCAN_SCALAR; isa <= SCAN_AVX2; isa++) {
+        char name[32];
+        if (!scan_set_isa(isa))
+            continue;
+        snprintf(name, sizeof(name), "scan (%s)", scan_isa_name(isa));
+        bench_run(name, bench_scan, &dump, false, num_lines);
+    }
+    scan_set_isa(best);
+
+    /** With the routes parsed, as the parsers do */
+    printf("\n");
+    bench_run("fgets + route_parse", bench_stdio, &dump, true, num_lines);
+    bench_run("scan + route_parse", bench_scan, &dump, true, num_lines);
+
+    route_devs_free();
+    exec_buf_free(&dump);
+    return 0;
+}
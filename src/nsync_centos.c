@@ -8,6 +8,8 @@
  */
 
 #include "nsync_centos.h"
+#include "nsync_collect.h"
+#include "nsync_dhcp.h"
 #include <time.h>
 
 state_func_t centos_state_funcs = {
@@ -31,6 +33,68 @@ cmd_list_t centos_cmd_list = {
     .get_routes = "ip route",
 };
 
+/**
+ * @brief Gets the prefix length of the address of an ifcfg file, from its
+ * NETMASK or else its PREFIX
+ * @param stored the parsed file
+ * @returns the prefix length, or -1 if the file has neither or it is invalid
+ */
+static int centos_stored_prefix_len(const ifcfg_fields_t *stored)
+{
+    if (stored->netmask) {
+        ip_addr_t mask;
+        if (!ip_addr_parse(slice_make(stored->netmask), &mask))
+            return -1;
+        return ip_netmask_len(&mask);
+    }
+    if (stored->prefix) {
+        char *end;
+        long len = strtol(stored->prefix, &end, 10);
+        if (end == stored->prefix || *end || len < 0 || len > 32)
+            return -1;
+        return len;
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Fills the compared fields of the active configurations and of the
+ * ifcfg files into two tables, one row per interface. Rows of interfaces
+ * without either are left zero.
+ * 
+ * @param info A struct containing all of the info related to the nsync utility
+ * @param active the table of the active configurations
+ * @param stored the table of the ifcfg files
+ */
+static void centos_fill_if_tables(net_sync_info_t *info, if_table_t *active, if_table_t *stored)
+{
+    for (int i = 0; i < CENTOS_NUM_IF; i++) {
+        ip_show_fields_t *act = CENTOS_ACTIVE_CFG(i);
+        ifcfg_fields_t *cfg = CENTOS_STORED_IFCFG(i);
+        if (!act || !cfg)
+            continue;
+
+        /** Names and values are interned, so a string's pointer stands for its value */
+        IF_CELL(active, CENTOS_COL_NAME, i) = (uintptr_t)act->name;
+        IF_CELL(stored, CENTOS_COL_NAME, i) = (uintptr_t)cfg->device;
+        IF_CELL(active, CENTOS_COL_MTU, i) = (uintptr_t)act->mtu;
+        IF_CELL(stored, CENTOS_COL_MTU, i) = (uintptr_t)cfg->mtu;
+
+        /** Addresses are compared by value, so 10.0.0.1 matches 010.0.0.1 */
+        ip_addr_t cfg_ip = { 0 };
+        if (cfg->ipaddr && !ip_addr_parse(slice_make(cfg->ipaddr), &cfg_ip))
+            memset(&cfg_ip, 0, sizeof(cfg_ip));
+        if_table_set_addr(active, CENTOS_COL_INET, i, &act->inet);
+        if_table_set_addr(stored, CENTOS_COL_INET, i, &cfg_ip);
+
+        /** The mask may be given as NETMASK or as PREFIX, so its length is compared */
+        IF_CELL(active, CENTOS_COL_PREFIX_LEN, i) = (uint64_t)ip_netmask_len(&act->inet_mask);
+        IF_CELL(stored, CENTOS_COL_PREFIX_LEN, i) = (uint64_t)centos_stored_prefix_len(cfg);
+    }
+}
+
+
 /**
  * @brief Gets all information about the current persistent network configuration files
  * and information about the active network configuration and stores all the data in the
@@ -45,7 +109,11 @@ nsync_state_t centos_get_config(net_sync_info_t *info)
     
     centos_parse_func_t parsers = *(centos_parse_func_t *)info->parsers;
     
-    info->net_config = calloc(1, sizeof(centos_net_cfg_t));
+    info->net_config = arena_alloc(&info->arena, sizeof(centos_net_cfg_t));
+    MEM_CHECK(info->net_config, NSYNC_ERROR);
+
+    /** Collectors that gather everything in one pass do so up front */
+    if (parsers.collect && !parsers.collect(info->cmd_list)) return NSYNC_ERROR;
 
     /** Get all the interfaces */
     if_list_parsed_t *if_parsed = parsers.parse_if_list(CENTOS_GET_IF_LIST); 
@@ -54,18 +122,34 @@ nsync_state_t centos_get_config(net_sync_info_t *info)
     CENTOS_IF_LIST = if_parsed->if_list;
     CENTOS_NUM_IF = if_parsed->num_if;
 
-    /** Get all the routes */
-    routes_parsed_t *routes_parsed = parsers.parse_routes(CENTOS_GET_ACTIVE_ROUTES);
-    if (!routes_parsed) return NSYNC_ERROR;
+    /** Get all the routes, mapped to their interfaces */
+    map_routes_if_t mapped;
+    if (parsers.stream_routes) {
+        /** Read straight into the interfaces' lists; only their routes are held */
+        mapped = parsers.stream_routes(CENTOS_GET_ACTIVE_ROUTES, if_parsed);
+        if (!mapped) return NSYNC_ERROR;
+    } else {
+        routes_parsed_t *routes_parsed = parsers.parse_routes(CENTOS_GET_ACTIVE_ROUTES);
+        if (!routes_parsed) return NSYNC_ERROR;
 
-    CENTOS_ACTIVE_ROUTES = routes_parsed->route_list;
-    CENTOS_ACTIVE_NUM_ROUTES = routes_parsed->num_route;
+        CENTOS_ACTIVE_ROUTES = routes_parsed->route_list;
+        CENTOS_ACTIVE_NUM_ROUTES = routes_parsed->num_route;
 
-    /** map routes to their interfaces */
-    map_routes_if_t mapped = parsers.map_routes_to_if(routes_parsed, if_parsed);
+        /** map routes to their interfaces */
+        mapped = parsers.map_routes_to_if(routes_parsed, if_parsed);
+        if (!mapped) return NSYNC_ERROR;
+    }
 
     CENTOS_MAPPED = mapped;
 
+    /** Size the per-interface state now that the interfaces are known */
+    CENTOS_NET_CFG->stored_configs = arena_alloc(&info->arena, CENTOS_NUM_IF * sizeof(ifcfg_fields_t *));
+    MEM_CHECK(CENTOS_NET_CFG->stored_configs, NSYNC_ERROR);
+    CENTOS_NET_CFG->active_configs = arena_alloc(&info->arena, CENTOS_NUM_IF * sizeof(ip_show_fields_t *));
+    MEM_CHECK(CENTOS_NET_CFG->active_configs, NSYNC_ERROR);
+    CENTOS_NET_CFG->persist_rts = arena_alloc(&info->arena, CENTOS_NUM_IF * sizeof(rt_cfg_t *));
+    MEM_CHECK(CENTOS_NET_CFG->persist_rts, NSYNC_ERROR);
+    if (!bitset_init(&info->synced, CENTOS_NUM_IF, &info->arena)) return NSYNC_ERROR;
 
     /** Get all stored configs */
     char cfg_filepath_fmt[FILENAME_MAX];
@@ -90,15 +174,46 @@ nsync_state_t centos_get_config(net_sync_info_t *info)
 
     /** Get active network config */
     char get_link_fields_cmd[MAX_CMD_LEN];
+    if (parsers.collect == NULL){
+        /** Run the ip commands side by side; parse_ip_show picks up their output */
+        char (*active_cfg_cmds)[MAX_CMD_LEN] = calloc(CENTOS_NUM_IF, MAX_CMD_LEN);
+        char **active_cfg_argv = calloc(CENTOS_NUM_IF, sizeof(char *));
+        MEM_CHECK(active_cfg_cmds, NSYNC_ERROR);
+        MEM_CHECK(active_cfg_argv, NSYNC_ERROR);
+        for(i = 0; i < CENTOS_NUM_IF; i++){
+            sprintf(active_cfg_cmds[i], CENTOS_GET_ACTIVE_CFG, CENTOS_IF_LIST_I(i));
+            active_cfg_argv[i] = active_cfg_cmds[i];
+        }
+        bool prefetched = exec_prefetch(active_cfg_argv, CENTOS_NUM_IF);
+        free(active_cfg_argv);
+        free(active_cfg_cmds);
+        if (!prefetched) return NSYNC_ERROR;
+    }
     for(i = 0; i < CENTOS_NUM_IF; i++){ 
         sprintf(get_link_fields_cmd, CENTOS_GET_ACTIVE_CFG, CENTOS_IF_LIST_I(i));
         CENTOS_ACTIVE_CFG(i) = parsers.parse_ip_show(get_link_fields_cmd);
         if(CENTOS_ACTIVE_CFG(i) == fatal_err_ptr) return NSYNC_ERROR;
+
+        /** Leave the files of an interface that timed out untouched */
+        if(CENTOS_ACTIVE_CFG(i) == NULL){
+            fprintf(stderr, "%sWarning: %s, skipping %s%s\n", KYEL, err_msg, CENTOS_IF_LIST_I(i), KNRM);
+            bitset_set(&info->synced, i);
+        }
     }
 
 
+    /** Compare every interface's fields at once */
+    if_table_t active_table, stored_table;
+    if (!if_table_init(&active_table, CENTOS_NUM_COLS, CENTOS_NUM_IF, &info->arena) ||
+        !if_table_init(&stored_table, CENTOS_NUM_COLS, CENTOS_NUM_IF, &info->arena))
+        return NSYNC_ERROR;
+    centos_fill_if_tables(info, &active_table, &stored_table);
+    CENTOS_NET_CFG->if_diff = if_table_diff(&active_table, &stored_table, &info->arena);
+    if (!CENTOS_NET_CFG->if_diff) return NSYNC_ERROR;
+
     /** Print some general info about what was parsed */
     if (info->verbose) {
+        char route[ROUTE_TEXT_LEN];
         printf("##################################################################\n\n");
 
         printf("Found the following active interfaces:");
@@ -110,7 +225,7 @@ nsync_state_t centos_get_config(net_sync_info_t *info)
         for (int i = 0; i < CENTOS_NUM_IF; i++) {
             printf("Interface %s",  CENTOS_IF_LIST_I(i));
             
-            if(!CENTOS_MAPPED_I(i) || CENTOS_MAPPED_I_ROUTE_NUM(i) == 0)
+            if(CENTOS_MAPPED_I_ROUTE_NUM(i) == 0)
             {
                 printf(" has no routes associated.\n\n");
                 continue;
@@ -118,7 +233,7 @@ nsync_state_t centos_get_config(net_sync_info_t *info)
 
             printf(" has the following route(s):\n");
             for (int j = 0; j < CENTOS_MAPPED_I_ROUTE_NUM(i); j++) {
-                printf("%s\n", CENTOS_MAPPED_I_ROUTE_J(i,j));
+                printf("%s\n", route_str(&CENTOS_MAPPED_I_ROUTE_J(i,j), route));
             }
             printf("\n");
         }
@@ -143,7 +258,7 @@ nsync_state_t centos_get_config(net_sync_info_t *info)
 
                 printf(" has the following route(s):\n");
                 for (int j = 0; j < CENTOS_PERSIST_ROUTES_NUM_ROUTE(i); j++) {
-                        printf("%s\n", CENTOS_PERSIST_ROUTES_ROUTE(i,j));
+                        printf("%s\n", route_str(&CENTOS_PERSIST_ROUTES_ROUTE(i,j), route));
                 }    
                 printf("\n");
             }
@@ -151,10 +266,6 @@ nsync_state_t centos_get_config(net_sync_info_t *info)
         printf("##################################################################\n\n");
     }
 
-    /** Free the memory */
-    free(if_parsed);
-    free(routes_parsed);
-
     return NSYNC_GET_UNSYNCED;
 }
 
@@ -170,10 +281,7 @@ nsync_state_t centos_get_config(net_sync_info_t *info)
 nsync_state_t centos_get_unsynced(net_sync_info_t *info)
 {
     /** Find next unsynced interface */
-    int i;
-    for (i = 0; i < CENTOS_NUM_IF; i++) {
-        if(!info->synced[i]) break;
-    }
+    int i = bitset_first_clear(&info->synced);
 
     /** If none are unsynced then we are done! */
     if (i == CENTOS_NUM_IF) 
@@ -200,7 +308,7 @@ nsync_state_t centos_get_unsynced(net_sync_info_t *info)
 nsync_state_t centos_check_persistent_files(net_sync_info_t *info)
 {
     /** Check for interface */
-    char *interface = CENTOS_IF_LIST_I(info->next_to_sync);
+    const char *interface = CENTOS_IF_LIST_I(info->next_to_sync);
     if (interface == NULL) {
         sprintf(err_msg, "interface is (null)");
         return NSYNC_ERROR;
@@ -269,28 +377,29 @@ nsync_state_t centos_create_and_write_to_file(net_sync_info_t *info)
      * otherwise, don't bring up on boot and asyume dynamic because we have
      * no ip address to manually assign.
      */
-    if (CENTOS_ACTIVE_CFG_INET(i)) {
+    char addr[IP_ADDR_STR_LEN];
+    if (IP_ADDR_IS_SET(CENTOS_ACTIVE_CFG_INET(i))) {
         fprintf(fp, "ONBOOT=yes\n");
 
         /** Check if interface is dynamic */
         if(CENTOS_ACTIVE_CFG_DYNAMIC(i))
-            fprintf(fp, "BOOTPROTO=dhcp\nIPADDR=%s\n", CENTOS_ACTIVE_CFG_INET(i));
+            fprintf(fp, "BOOTPROTO=dhcp\nIPADDR=%s\n", ip_addr_str(&CENTOS_ACTIVE_CFG_INET(i), addr));
         else 
-            fprintf(fp, "BOOTPROTO=none\nIPADDR=%s\n", CENTOS_ACTIVE_CFG_INET(i));
+            fprintf(fp, "BOOTPROTO=none\nIPADDR=%s\n", ip_addr_str(&CENTOS_ACTIVE_CFG_INET(i), addr));
     }
     else 
         fprintf(fp, "ONBOOT=no\nBOOTPROTO=dhcp\n");
 
 
     /** Check for these few fields and if they have a value then add to the config */
-    if (CENTOS_ACTIVE_CFG_INET_MASK(i)) 
-        fprintf(fp, "NETMASK=%s\n", CENTOS_ACTIVE_CFG_INET_MASK(i));
+    if (IP_ADDR_IS_SET(CENTOS_ACTIVE_CFG_INET_MASK(i))) 
+        fprintf(fp, "NETMASK=%s\n", ip_addr_str(&CENTOS_ACTIVE_CFG_INET_MASK(i), addr));
 
     if (CENTOS_ACTIVE_CFG_MTU(i)) 
         fprintf(fp, "MTU=%s\n", CENTOS_ACTIVE_CFG_MTU(i));
 
     /** If there is an ipv6 address then add ipv6 activation to the config */
-    if (CENTOS_ACTIVE_CFG_INET6(i)) 
+    if (IP_ADDR_IS_SET(CENTOS_ACTIVE_CFG_INET6(i))) 
         fprintf(fp, "IPV6INIT=yes\nIPV6AUTOCONF=yes");
     else 
         fprintf(fp, "IPV6INIT=no\n");
@@ -315,8 +424,9 @@ nsync_state_t centos_create_and_write_to_file(net_sync_info_t *info)
             return NSYNC_ERROR;
         }
         /** Iterate through the routes */
+        char route[ROUTE_TEXT_LEN];
         for (int j = 0; j < CENTOS_MAPPED_I_ROUTE_NUM(i); j++) {
-            fprintf(fp,"%s", CENTOS_MAPPED_I_ROUTE_J(i,j));
+            fprintf(fp,"%s", route_str(&CENTOS_MAPPED_I_ROUTE_J(i,j), route));
             fprintf(fp, "\n");
         }
         fclose(fp);
@@ -353,16 +463,21 @@ nsync_state_t centos_compare_configs(net_sync_info_t *info)
     if (persist_rt_cnt != active_rt_cnt)
         match = false;
 
+    /** The active routes may outnumber the persistent ones */
+    if (!rt_cfg_reserve(CENTOS_PERSIST_ROUTES(to_sync), active_rt_cnt))
+        return NSYNC_ERROR;
+
     /** Compare all the routes */
     for (int i = 0; i < active_rt_cnt; i++) {
-        if (!CENTOS_PERSIST_ROUTES_ROUTE(to_sync, i)){ 
-            CENTOS_PERSIST_ROUTES_ROUTE(to_sync, i) = calloc(MAX_OUTPUT_LEN, sizeof(char));
+        centos_route_t *active_rt = &CENTOS_MAPPED_I_ROUTE_J(to_sync, i);
+        bool missing = i >= persist_rt_cnt;
+        if (missing)
             CENTOS_PERSIST_ROUTES_NUM_ROUTE(to_sync)++;
-        }
-        if (strcmp(CENTOS_PERSIST_ROUTES_ROUTE(to_sync, i), CENTOS_ACTIVE_ROUTES_I(i)) != 0){
+
+        /** Records are compared field by field and copied whole */
+        if (missing || !route_eq(&CENTOS_PERSIST_ROUTES_ROUTE(to_sync, i), active_rt)){
             match = false;
-            memcpy(CENTOS_PERSIST_ROUTES_ROUTE(to_sync, i), CENTOS_ACTIVE_ROUTES_I(i), MAX_OUTPUT_LEN);
-        
+            CENTOS_PERSIST_ROUTES_ROUTE(to_sync, i) = *active_rt;
         }
     }
 
@@ -379,58 +494,49 @@ compare_ifcfg:
     ifcfg_fields_t *stored = CENTOS_STORED_IFCFG(to_sync);
     ip_show_fields_t *active = CENTOS_ACTIVE_CFG(to_sync);
 
-   
-    if(active->name != NULL){
-        if (!stored->device){ 
-            stored->device = calloc(MAX_OPT_LEN, sizeof(char));
-            MEM_CHECK(stored->device, NSYNC_ERROR);
-        }
-        if(strcmp(active->name, stored->device) != 0){
-            match = false;
-            memcpy(stored->device, active->name, MAX_OPT_LEN);
-        }
+    /** The fields of every interface were compared together by get_config */
+    uint64_t diff = CENTOS_IF_DIFF(to_sync);
+    if(active->name != NULL && (diff & IF_DIFF(CENTOS_COL_NAME, 1))){
+        match = false;
+        if (!ifcfg_set_field(stored, DEVICE, active->name))
+            return NSYNC_ERROR;
     }
 
     // MTU may be left out as 1500 is default
-    if(active->mtu != NULL){
-        if (!stored->mtu){ 
-            stored->mtu = calloc(MAX_OPT_LEN, sizeof(char));
-            MEM_CHECK(stored->mtu, NSYNC_ERROR);
-        }
-        if(strcmp(active->mtu, stored->mtu) != 0 && strcmp(active->mtu, "1500") != 0){
+    if(active->mtu != NULL && (diff & IF_DIFF(CENTOS_COL_MTU, 1))){
+        if(strcmp(active->mtu, "1500") != 0){
             match = false;
-            memcpy(stored->mtu, active->mtu, MAX_OPT_LEN);
+            if (!ifcfg_set_field(stored, MTU, active->mtu))
+                return NSYNC_ERROR;
         }
     }
 
-    if(active->inet != NULL && !active->dynamic){
-        if (!stored->ipaddr){ 
-            stored->ipaddr = calloc(20, sizeof(char));
-            MEM_CHECK(stored->ipaddr, NSYNC_ERROR);
-        }
-        if(strcmp(active->inet, stored->ipaddr) != 0){
-            match = false;
-            memcpy(stored->ipaddr, active->inet, 20);
-        }
+    char addr[IP_ADDR_STR_LEN];
+    if(IP_ADDR_IS_SET(active->inet) && !active->dynamic &&
+       (diff & IF_DIFF(CENTOS_COL_INET, IF_TABLE_ADDR_COLS))){
+        match = false;
+        if (!ifcfg_set_field(stored, IPADDR, ip_addr_str(&active->inet, addr)))
+            return NSYNC_ERROR;
     }
 
-    if(active->inet_mask != NULL && !active->dynamic){
-        if (!stored->netmask){ 
-            stored->netmask = calloc(20, sizeof(char));
-            MEM_CHECK(stored->netmask, NSYNC_ERROR);
-        }
-        if(strcmp(active->inet_mask, stored->netmask) != 0){
-            match = false;
-            memcpy(stored->netmask, active->inet_mask, 20);
+    /** The mask is kept in the form the file uses */
+    if(IP_ADDR_IS_SET(active->inet_mask) && !active->dynamic &&
+       (diff & IF_DIFF(CENTOS_COL_PREFIX_LEN, 1))){
+        match = false;
+        if (!stored->netmask && stored->prefix) {
+            snprintf(addr, sizeof(addr), "%d", ip_netmask_len(&active->inet_mask));
+            if (!ifcfg_set_field(stored, PREFIX, addr))
+                return NSYNC_ERROR;
+        } else if (!ifcfg_set_field(stored, NETMASK, ip_addr_str(&active->inet_mask, addr))) {
+            return NSYNC_ERROR;
         }
     }
 
     if (info->arping_wait && !stored->arping_wait){
         printf("match");
         match = false;
-        stored->arping_wait = calloc(MAX_OPT_LEN, sizeof(char));
-        MEM_CHECK(stored->arping_wait, NSYNC_ERROR);
-        memcpy(stored->arping_wait, "8", 1);
+        if (!ifcfg_set_field(stored, ARPING_WAIT, "8"))
+            return NSYNC_ERROR;
     }
 
     if (match) {
@@ -475,7 +581,7 @@ nsync_state_t centos_backup_files(net_sync_info_t *info)
         location = info->backup.default_path;
     }
 
-    char *interface = CENTOS_IF_LIST_I(info->next_to_sync);
+    const char *interface = CENTOS_IF_LIST_I(info->next_to_sync);
 
     /** Format backup folder */
     char *dir_fmt = "nsync.%s";
@@ -500,18 +606,15 @@ nsync_state_t centos_backup_files(net_sync_info_t *info)
      * then create the backup directory 
      * */
     if (!dir_check(full_path) && !info->backup.started){
-        char mkdir_cmd[MAX_CMD_LEN];
-        sprintf(mkdir_cmd, "mkdir %s", full_path);
-        if (system(mkdir_cmd) == -1){
-            sprintf(err_msg, "command `%s` failed", mkdir_cmd);
+        if (mkdir(full_path, 0777) != 0){
+            sprintf(err_msg, "could not create directory %s: %s", full_path, strerror(errno));
             return NSYNC_ERROR;
         }
         info->backup.started = true;
     }
 
-    /** Build system level backup commands */
-    char *backup_cmd_fmt = "cp %s %s";
-    char backup_cmd[MAX_CMD_LEN];
+    /** Copy backups with cp, without going through a shell */
+    char *backup_argv[] = { "cp", NULL, full_path, NULL };
 
     char backup_file_fmt[FILENAME_MAX];
     sprintf(backup_file_fmt, "%s%s", CFG_FILE_LOC, CFG_FILE);
@@ -520,9 +623,9 @@ nsync_state_t centos_backup_files(net_sync_info_t *info)
     /** Backup ifcfg-<interface> file */
     sprintf(backup_file, backup_file_fmt, interface);
     if (file_exists(backup_file)){
-        sprintf(backup_cmd, backup_cmd_fmt, backup_file, full_path);
-        if (system(backup_cmd) == -1){
-            sprintf(err_msg, "command `%s` failed", backup_cmd);
+        backup_argv[1] = backup_file;
+        if (exec_argv(backup_argv, NULL) != 0){
+            sprintf(err_msg, "could not copy %s to %s", backup_file, full_path);
             return NSYNC_ERROR;
         }
     }
@@ -531,9 +634,9 @@ nsync_state_t centos_backup_files(net_sync_info_t *info)
     sprintf(backup_file_fmt, "%s%s", CFG_FILE_LOC, ROUTE_FILE);
     sprintf(backup_file, backup_file_fmt, interface);
     if (file_exists(backup_file)){
-        sprintf(backup_cmd, backup_cmd_fmt, backup_file, full_path);
-        if (system(backup_cmd) == -1){
-            sprintf(err_msg, "command `%s` failed", backup_cmd);
+        backup_argv[1] = backup_file;
+        if (exec_argv(backup_argv, NULL) != 0){
+            sprintf(err_msg, "could not copy %s to %s", backup_file, full_path);
             return NSYNC_ERROR;
         }
     }
@@ -554,7 +657,7 @@ nsync_state_t centos_mark_synced(net_sync_info_t *info)
         printf(" done\n\n");
     }
     /** Mark current interface as synced */
-    info->synced[info->next_to_sync] = true;
+    bitset_set(&info->synced, info->next_to_sync);
     return NSYNC_GET_UNSYNCED;
 }
 
@@ -575,13 +678,8 @@ nsync_state_t centos_overwrite_configs(net_sync_info_t *info)
     routes_parsed_t *active_routes = CENTOS_MAPPED_I(i);
 
     if (active_routes->num_route > 0) {
-        if (stored_cfg->onboot != NULL)
-            memcpy(stored_cfg->onboot, "yes", 3);
-        else {
-            stored_cfg->onboot = calloc(MAX_OPT_LEN, sizeof(char));
-            MEM_CHECK(stored_cfg->onboot, NSYNC_ERROR);
-            memcpy(stored_cfg->onboot, "yes", 3);
-        }
+        if (!ifcfg_set_field(stored_cfg, ONBOOT, "yes"))
+            return NSYNC_ERROR;
     }
 
     char if_cfg_file_fmt[FILENAME_MAX];
@@ -601,193 +699,27 @@ nsync_state_t centos_overwrite_configs(net_sync_info_t *info)
     sprintf(cfg_filepath_fmt, "%s%s",CFG_FILE_LOC, CFG_FILE);
     sprintf(cfg_filepath, cfg_filepath_fmt, CENTOS_IF_LIST_I(i));
 
-    /** Open the file for reading */
-    FILE *fp_old = fopen(cfg_filepath, "r");
-    if (!fp_old) {
-        sprintf(err_msg, "file %s could not be read", cfg_filepath);
-        return NSYNC_ERROR;
-    }
+    /** MTU is left to its default rather than written as 1500 */
+    if (stored_cfg->mtu && (!strlen(stored_cfg->mtu) || !strcmp(stored_cfg->mtu, "1500")))
+        ifcfg_set_field(stored_cfg, MTU, NULL);
 
-    char line[CFG_LINE_LEN];
-    
-    bool added_arp_wait = false;
-
-    /** Iterate through the lines of the file and parse out the field of the configuration */
-    while (fgets(line, CFG_LINE_LEN, fp_old)) {
-        char opt_str[MAX_OPT_LEN];
-        char opt_val[MAX_VAL_LEN];
-
-        /** Check for comments */
-        if (line[0] == '#'){
-            sprintf(opt_str, "#");
-            safe_strncpy(opt_val, &line[1], MAX_VAL_LEN);
-        } else {
-            get_field_delim(opt_str, line, 1, MAX_OPT_LEN, "=");
-            get_field_delim(opt_val, line, 2, MAX_VAL_LEN, "=");
-        }
-        /** Remove quotes around opt_val */
-        trim(opt_val,"\"\n");
-
-        /** If we find the appropriate field then check that it has a value and print it */
-        ifcfg_opt_t opt = opt_str_to_enum(opt_str);
-        switch(opt){
-            case COMMENT:
-                fprintf(fp, "#%s\n", opt_val);    
-                break;
-
-            case TYPE:
-                if (stored_cfg->type)               
-                    fprintf(fp, "TYPE=%s\n",stored_cfg->type);
-                break;
-
-            case DEVICE:
-                if (stored_cfg->device)              
-                    fprintf(fp, "DEVICE=%s\n",stored_cfg->device);
-                break;
-
-            case ONBOOT:
-                if (stored_cfg->onboot)              
-                    fprintf(fp, "ONBOOT=%s\n",stored_cfg->onboot);
-                break;
-
-            case BOOTPROTO:
-                if (stored_cfg->bootproto)           
-                    fprintf(fp, "BOOTPROTO=%s\n",stored_cfg->bootproto);
-                break;
-
-            case IPADDR:
-                if (stored_cfg->ipaddr)              
-                    fprintf(fp, "IPADDR=%s\n",stored_cfg->ipaddr);
-                break;
-
-            case GATEWAY:
-                if (stored_cfg->gateway)             
-                    fprintf(fp, "GATEWAY=%s\n",stored_cfg->gateway);
-                break;
-
-            case NETMASK:
-                if (stored_cfg->netmask)             
-                    fprintf(fp, "NETMASK=%s\n",stored_cfg->netmask);
-                break;
-
-            case DNS1:
-                if (stored_cfg->dns[0])              
-                    fprintf(fp, "DNS1=%s\n",stored_cfg->dns[0]);
-                break;
-
-            case DNS2:
-                if (stored_cfg->dns[1])              
-                    fprintf(fp, "DNS2=%s\n",stored_cfg->dns[1]);
-                break;
-
-            case IPV4_FAILURE_FATAL:
-                if (stored_cfg->ipv4_failure_fatal)  
-                    fprintf(fp, "IPV4_FAILURE_FATAL=%s\n",stored_cfg->ipv4_failure_fatal);
-                break;
-
-            case IPV6ADDR:
-                if (stored_cfg->ipv6addr)            
-                    fprintf(fp, "IPV6ADDR=%s\n",stored_cfg->ipv6addr);
-                break;
-
-            case IPV6INIT:
-                if (stored_cfg->ipv6init)            
-                    fprintf(fp, "IPV6INIT=%s\n",stored_cfg->ipv6init);
-                break;
-
-            case NM_CONTROLLED:
-                if (stored_cfg->nm_controlled)       
-                    fprintf(fp, "NM_CONTROLLED=%s\n",stored_cfg->nm_controlled);
-                break;
-
-            case USERCTL:
-                if (stored_cfg->userctl)             
-                    fprintf(fp, "USERCTL=%s\n",stored_cfg->userctl);
-                break;
-
-            case DEFROUTE:
-                if (stored_cfg->defroute)            
-                    fprintf(fp, "DEFROUTE=%s\n",stored_cfg->defroute);
-                break;
-
-            case VLAN:
-                if (stored_cfg->vlan)                
-                    fprintf(fp, "VLAN=%s\n",stored_cfg->vlan);
-                break;
-
-            case MTU:
-                if (stored_cfg->mtu && strlen(stored_cfg->mtu) && strcmp(stored_cfg->mtu, "1500"))                 
-                    fprintf(fp, "MTU=%s\n",stored_cfg->mtu);
-                break;
-            case HWADDR:
-                if (stored_cfg->hwaddr)              
-                fprintf(fp, "HWADDR=%s\n",stored_cfg->hwaddr);
-                break;
-
-            case UUID:
-                if (stored_cfg->uuid)                
-                fprintf(fp, "UUID=%s\n",stored_cfg->uuid);
-                break;
-
-            case NETWORK:
-                if (stored_cfg->network)             
-                fprintf(fp, "NETWORK=%s\n",stored_cfg->network);
-                break;
-
-            case BROADCAST:
-                if (stored_cfg->broadcast)           
-                fprintf(fp, "BROADCAST=%s\n",stored_cfg->broadcast);
-                break;
-
-            case NAME:
-                if (stored_cfg->name)                
-                fprintf(fp, "NAME=%s\n",stored_cfg->name);
-                break;
-
-            case IPV6_AUTOCONF:
-                if (stored_cfg->ipv6_autoconf)       
-                fprintf(fp, "IPV6_AUTOCONF=%s\n",stored_cfg->ipv6_autoconf);
-                break;
-
-            case PROXY_METHOD:
-                if (stored_cfg->proxy_method)        
-                fprintf(fp, "PROXY_METHOD=%s\n",stored_cfg->proxy_method);
-                break;
-
-            case BROWSER_ONLY:
-                if (stored_cfg->browser_only)        
-                fprintf(fp, "BROWSER_ONLY=%s\n",stored_cfg->browser_only);
-                break;
-
-            case ARPING_WAIT:
-                if (stored_cfg->arping_wait)         
-                fprintf(fp, "ARPING_WAIT=%s\n", stored_cfg->arping_wait);
-                added_arp_wait = true;
-                break;
-
-            case UNKNOWN_OPT:
-                fprintf(fp, "%s", line);
-                break;
-
-            default:
-                sprintf(err_msg, "invalid opt: %s", opt_str);
-                return NSYNC_ERROR;
-        }
+    /** Write the file back from the lines it was parsed into */
+    bool add_arp_wait = info->arping_wait && stored_cfg->arping_wait &&
+                        !ifcfg_has_line(stored_cfg, ARPING_WAIT);
+    if (!centos_write_ifcfg(stored_cfg, fp, add_arp_wait)) {
+        fclose(fp);
+        return NSYNC_ERROR;
     }
-    if (info->arping_wait && !added_arp_wait && stored_cfg->arping_wait){
+    if (add_arp_wait){
         fprintf(fp, "ARPING_WAIT=%s\n", stored_cfg->arping_wait);
     }
-    
-    fclose(fp_old);
     fclose(fp);
 
     /** Overwrite existing with the tmp file */
-    char cpy_cmd[MAX_CMD_LEN];
-    sprintf(cpy_cmd, "mv %s %s",if_cfg_file, cfg_filepath);
-    if (system(cpy_cmd) == -1){
-            sprintf(err_msg, "command `%s` failed", cpy_cmd);
-            return NSYNC_ERROR;
-        }
+    if (rename(if_cfg_file, cfg_filepath) != 0){
+        sprintf(err_msg, "could not move %s to %s: %s", if_cfg_file, cfg_filepath, strerror(errno));
+        return NSYNC_ERROR;
+    }
 
     /** Write routes */
     char route_file_fmt[FILENAME_MAX];
@@ -808,12 +740,15 @@ nsync_state_t centos_overwrite_configs(net_sync_info_t *info)
     /** 
      * For each of the active routes, if there is a matching persistent
      * route add any whitespace and comments associated with it before
-     * writing the route. Otherwise just write the route.
+     * writing the route. Otherwise just write the route. A persistent
+     * route that matches is written as it was read.
      */
+    char route[ROUTE_TEXT_LEN];
     for (int j = 0; j < active_routes->num_route; j++) {
+        centos_route_t *active_rt = &active_routes->route_list[j];
         
         if (!CENTOS_PERSIST_ROUTES(info->next_to_sync)){
-            fprintf(fp, "%s\n", CENTOS_ACTIVE_ROUTES_I(j));
+            fprintf(fp, "%s\n", route_str(active_rt, route));
             continue;
         }
         
@@ -825,7 +760,10 @@ nsync_state_t centos_overwrite_configs(net_sync_info_t *info)
         if (comment) 
             fprintf(fp, "%s", comment);
 
-        fprintf(fp, "%s\n", CENTOS_ACTIVE_ROUTES_I(j));
+        centos_route_t *persist_rt = &CENTOS_PERSIST_ROUTES_ROUTE(info->next_to_sync, j);
+        if (route_eq(persist_rt, active_rt))
+            active_rt = persist_rt;
+        fprintf(fp, "%s\n", route_str(active_rt, route));
     }
         
     fclose(fp);
@@ -835,6 +773,7 @@ nsync_state_t centos_overwrite_configs(net_sync_info_t *info)
 
 /**
  * @brief Frees all heap allocated data in the provided net_sync_info struct.
+ * Parse results all live in the parse arena and are released with one reset.
  * 
  * @param info pointer to the struct containing all information relating to the nsync utility
  * @returns the final state of the utility -- NSYNC_SUCCESS
@@ -849,31 +788,14 @@ nsync_state_t centos_cleanup_and_free(net_sync_info_t *info)
     /** Free sys info */
     free(info->sys.os_str);
 
-    /** Free network config stuff */
-    for (int i = 0; i < MAX_NUM_IF; i++){
-        free(CENTOS_IF_LIST_I(i));
-        free_ifcfg_fields(CENTOS_STORED_IFCFG(i));
-        free(CENTOS_STORED_IFCFG(i));
-        free_ip_show_fields(CENTOS_ACTIVE_CFG(i));
-        free(CENTOS_ACTIVE_CFG(i));
-    }
-    free(CENTOS_IF_LIST);
-
-    for (int i = 0; i < MAX_ROUTES; i++){
-        free(CENTOS_ACTIVE_ROUTES_I(i));
-        CENTOS_ACTIVE_ROUTES_I(i) = NULL;
-    }
-    free(CENTOS_ACTIVE_ROUTES);
-
-    for (int i = 0; i < CENTOS_NUM_IF; i++) {
-        
-        free(CENTOS_MAPPED_I_ROUTES(i));
-        free(CENTOS_MAPPED_I(i));
-        free_route_config(CENTOS_PERSIST_ROUTES(i));
-        free(CENTOS_PERSIST_ROUTES(i));
-    }
-    free(CENTOS_MAPPED);
-    free(CENTOS_NET_CFG);
+    /** Everything parsed is released at once */
+    arena_reset(&info->arena);
+    intern_reset(&info->strings);
+    info->net_config = NULL;
+    free_snapshot();
+    free_dhcp();
+    route_devs_free();
+    exec_cache_free();
     
     return NSYNC_SUCCESS;
 }
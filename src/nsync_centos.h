@@ -27,7 +27,7 @@ extern cmd_list_t centos_cmd_list;
 /*                            NET CONFIGS                             */
 /**********************************************************************/
 typedef struct centos_network_config {
-    char **if_list;
+    const char **if_list;
     int num_if;
     
     centos_route_t *routes;
@@ -35,14 +35,25 @@ typedef struct centos_network_config {
 
     map_routes_if_t mapped_routes_by_if;
 
-    ifcfg_fields_t *stored_configs[MAX_NUM_IF];
+    ifcfg_fields_t **stored_configs;
 
-    ip_show_fields_t *active_configs[MAX_NUM_IF];
+    ip_show_fields_t **active_configs;
 
-    rt_cfg_t *persist_rts[MAX_NUM_IF];
+    rt_cfg_t **persist_rts;
+
+    uint64_t *if_diff;      // per interface, the IF_DIFF bits of the fields that differ
 
 }centos_net_cfg_t;
 
+/** Columns of the fields compared between active configurations and ifcfg files */
+typedef enum {
+    CENTOS_COL_NAME,
+    CENTOS_COL_MTU,
+    CENTOS_COL_PREFIX_LEN,
+    CENTOS_COL_INET,
+    CENTOS_NUM_COLS = CENTOS_COL_INET + IF_TABLE_ADDR_COLS
+} centos_col_t;
+
 
 /**********************************************************************/
 /*                         ACCESS MACROS                              */
@@ -58,10 +69,12 @@ typedef struct centos_network_config {
 #define CENTOS_ACTIVE_NUM_ROUTES                    CENTOS_NET_CFG->num_routes
 
 #define CENTOS_MAPPED                               CENTOS_NET_CFG->mapped_routes_by_if
-#define CENTOS_MAPPED_I(i)                          CENTOS_NET_CFG->mapped_routes_by_if[i]
-#define CENTOS_MAPPED_I_ROUTES(i)                   CENTOS_NET_CFG->mapped_routes_by_if[i]->route_list
-#define CENTOS_MAPPED_I_ROUTE_J(i,j)                CENTOS_NET_CFG->mapped_routes_by_if[i]->route_list[j]
-#define CENTOS_MAPPED_I_ROUTE_NUM(i)                CENTOS_NET_CFG->mapped_routes_by_if[i]->num_route
+#define CENTOS_MAPPED_I(i)                          (&CENTOS_NET_CFG->mapped_routes_by_if[i])
+#define CENTOS_MAPPED_I_ROUTES(i)                   CENTOS_NET_CFG->mapped_routes_by_if[i].route_list
+#define CENTOS_MAPPED_I_ROUTE_J(i,j)                CENTOS_NET_CFG->mapped_routes_by_if[i].route_list[j]
+#define CENTOS_MAPPED_I_ROUTE_NUM(i)                CENTOS_NET_CFG->mapped_routes_by_if[i].num_route
+
+#define CENTOS_IF_DIFF(i)                           CENTOS_NET_CFG->if_diff[i]
 
 #define CENTOS_STORED_IFCFG(i)                      CENTOS_NET_CFG->stored_configs[i]
 #define CENTOS_STORED_IFCFG_COMMENT(i)              CENTOS_NET_CFG->stored_configs[i]->comment
@@ -100,14 +113,13 @@ typedef struct centos_network_config {
 #define CENTOS_ACTIVE_CFG_INET(i)                   CENTOS_NET_CFG->active_configs[i]->inet
 #define CENTOS_ACTIVE_CFG_INET_MASK(i)              CENTOS_NET_CFG->active_configs[i]->inet_mask
 #define CENTOS_ACTIVE_CFG_INET6(i)                  CENTOS_NET_CFG->active_configs[i]->inet6
-#define CENTOS_ACTIVE_CFG_INET6_MASK(i)             CENTOS_NET_CFG->active_configs[i]->inet6_mask
 #define CENTOS_ACTIVE_CFG_DYNAMIC(i)                CENTOS_NET_CFG->active_configs[i]->dynamic
 
 #define CENTOS_PERSIST_ROUTES(i)                    CENTOS_NET_CFG->persist_rts[i]
 #define CENTOS_PERSIST_ROUTES_NUM_ROUTE(i)          CENTOS_NET_CFG->persist_rts[i]->num_routes
-#define CENTOS_PERSIST_ROUTES_ROUTE(i,j)            CENTOS_NET_CFG->persist_rts[i]->routes[j]
-#define CENTOS_PERSIST_ROUTES_COMMENT(i,j)          CENTOS_NET_CFG->persist_rts[i]->comments[j]
-#define CENTOS_PERSIST_ROUTES_GAP(i,j)              CENTOS_NET_CFG->persist_rts[i]->gaps[j]
+#define CENTOS_PERSIST_ROUTES_ROUTE(i,j)            CENTOS_NET_CFG->persist_rts[i]->lines[j].route
+#define CENTOS_PERSIST_ROUTES_COMMENT(i,j)          CENTOS_NET_CFG->persist_rts[i]->lines[j].comment
+#define CENTOS_PERSIST_ROUTES_GAP(i,j)              CENTOS_NET_CFG->persist_rts[i]->lines[j].gap
 
 /**********************************************************************/
 /*                           CENTOS 6, 7, 8                           */
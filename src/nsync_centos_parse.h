@@ -10,18 +10,14 @@
  
 #include "nsync_utils.h"
 #include "nsync_info.h"
+#include "nsync_route.h"
 
 /** GLOBAL ERROR BUFFER */
 extern char err_msg[ERR_LEN];
 
 /** MACRO CONSTANTS */
-#define MAX_NUM_IF 255
-#define MAX_ROUTES 100
 #define MAX_IF_NAME 100
 
-#define MAX_NUM_IP 100
-#define MAX_NUM_GW 100
-#define MAX_NUM_NM 100
 #define CFG_LINE_LEN 300
 
 #define MAX_OPT_LEN 100
@@ -34,7 +30,8 @@ extern char err_msg[ERR_LEN];
 /**********************************************************************/
 /** 
  * @enum ifcfg_opt_t 
- * @brief enumeration of the possible options that can be found in an ifcfg file
+ * @brief enumeration of the possible options that can be found in an ifcfg file.
+ * Their names are in nsync_keywords.def
 */
 typedef enum {
     COMMENT = 0,
@@ -64,12 +61,11 @@ typedef enum {
     PROXY_METHOD,
     BROWSER_ONLY,
     ARPING_WAIT,
+    PREFIX,
     NUM_OPT,
     UNKNOWN_OPT,
 } ifcfg_opt_t;
 
-extern char **ifcfg_opts;
-
 /** 
  * @enum addr_show_opts_t 
  * @brief enumeration of the possible fields of the active configuration
@@ -88,11 +84,8 @@ typedef enum {
 /**********************************************************************/
 /*                             STRUCTS                                */
 /**********************************************************************/
-/**
- * @struct route_data
- * @brief stores the 3 fields needed for a route: ADDRESS, GATEWAY, NETMASK
- */
-typedef char * centos_route_t;
+/** A route of the routing table or a route-<interface> file */
+typedef route_t centos_route_t;
 
 
 /** 
@@ -101,8 +94,9 @@ typedef char * centos_route_t;
  * network interfaces and the length of the list
  */
 typedef struct if_list_parsed{
-    char** if_list;
+    const char **if_list;   // interned names
     int num_if;
+    int cap_if;
 } if_list_parsed_t;
 
 
@@ -114,52 +108,71 @@ typedef struct if_list_parsed{
 typedef struct routes_parsed{
     centos_route_t*  route_list;
     int num_route;
+    int cap_route;
 } routes_parsed_t;
 
 
-typedef routes_parsed_t** map_routes_if_t;
+/** The routes of each interface, indexed like the interface list */
+typedef routes_parsed_t* map_routes_if_t;
+
+/** 
+ * @struct ifcfg_line
+ * @brief one line of an ifcfg-<interface> file as it was read, so the file
+ * can be written back without reading it again
+ */
+typedef struct ifcfg_line{
+    ifcfg_opt_t opt;
+    str_slice_t text;   // the whole line in file_buf, without its newline
+    str_slice_t val;    // the value within text, without quotes
+} ifcfg_line_t;
 
 /** 
  * @struct interface_config_fields
- * @brief Stores the values that might exist in the ifcfg-<interface> files
+ * @brief Stores the values that might exist in the ifcfg-<interface> files.
+ * Values are interned, so equal values share one string.
  */
 typedef struct interface_config_fields{
-    char *comment; // Stores any line starting with a # symbol
-    char *type;
-    char *device;
-    char *onboot;
-    char *bootproto;
-
-    char *ipaddr;
-    char *gateway;
-    char *netmask;
-    char *dns[2];
+    const char *type;
+    const char *device;
+    const char *onboot;
+    const char *bootproto;
+
+    const char *ipaddr;
+    const char *gateway;
+    const char *netmask;
+    const char *prefix;
+    const char *dns[2];
     
-    char *ipv4_failure_fatal;
-    char *ipv6addr;
-    char *ipv6_autoconf;
-    char *ipv6init;
-    char *ipv6_failure_fatal;
-    char *ipv6_addr_gen_mode;
-
-    char *nm_controlled;
-    char *userctl;
-    char *defroute;
-
-    char *vlan;
-    char *mtu;
-    char *hwaddr;
-    char *uuid;
-
-    char *network;
-    char *broadcast;
-
-    char *name;
-    char *proxy_method;
-    char *browser_only;
-    char *arping_wait;
-
-    char *unknown;
+    const char *ipv4_failure_fatal;
+    const char *ipv6addr;
+    const char *ipv6_autoconf;
+    const char *ipv6init;
+    const char *ipv6_failure_fatal;
+    const char *ipv6_addr_gen_mode;
+
+    const char *nm_controlled;
+    const char *userctl;
+    const char *defroute;
+
+    const char *vlan;
+    const char *mtu;
+    const char *hwaddr;
+    const char *uuid;
+
+    const char *network;
+    const char *broadcast;
+
+    const char *name;
+    const char *proxy_method;
+    const char *browser_only;
+    const char *arping_wait;
+
+    char *file_buf;     // the whole file as read, never modified
+    size_t file_len;
+    uint64_t changed;   // one bit per ifcfg_opt_t whose field was changed since parsing
+
+    int num_lines;
+    ifcfg_line_t lines[]; // every line of the file in order, comments and unknown lines included
 } ifcfg_fields_t;
 
 
@@ -169,22 +182,36 @@ typedef struct interface_config_fields{
  * in the output of the `ip addr show <interface>` command
  */
 typedef struct ip_addr_show_fields{
-    char *name;
-    char *mtu;
-    char *link;
-    char *inet;
-    char *inet_mask;
-    char *inet6;
-    char *inet6_mask;
+    const char *name;       // interned, like mtu and link
+    const char *mtu;
+    const char *link;
+    ip_addr_t inet;         // without its prefix length, which is inet_mask
+    ip_addr_t inet_mask;
+    ip_addr_t inet6;        // with its prefix length
     bool dynamic;
 }ip_show_fields_t;
 
 
+/**
+ * @struct route_cfg_line
+ * @brief one route of a route-<interface> file with the comments and
+ * blank lines that precede it
+ */
+typedef struct route_cfg_line {
+    centos_route_t route;
+    char *comment;
+    char *gap;
+} rt_cfg_line_t;
+
+/**
+ * @struct route_config
+ * @brief the routes of a route-<interface> file. The line after the last
+ * route holds only the trailing comments and blank lines.
+ */
 typedef struct route_config {
-    centos_route_t routes[MAX_ROUTES];
+    rt_cfg_line_t *lines;
     int num_routes;
-    char *comments[MAX_ROUTES];
-    char *gaps[MAX_ROUTES];
+    int cap_lines;
 }rt_cfg_t;
 
 /** 
@@ -192,9 +219,11 @@ typedef struct route_config {
  * @brief used to store function pointers to various parsing functions
  */
 typedef struct centos_parse_func {
+        bool (*collect)(cmd_list_t *cmds);
         if_list_parsed_t *(*parse_if_list)(const char *cmd);
         routes_parsed_t *(*parse_routes)(const char *cmd);
         map_routes_if_t (*map_routes_to_if)(routes_parsed_t *rp, if_list_parsed_t *ilp);
+        map_routes_if_t (*stream_routes)(const char *cmd, if_list_parsed_t *ilp);
         ifcfg_fields_t *(*parse_ifcfg)(const char *path);
         ip_show_fields_t *(*parse_ip_show)(const char *cmd);
         rt_cfg_t *(*parse_persist_routes)(const char *path);
@@ -219,24 +248,28 @@ routes_parsed_t *centos_parse_routes(const char *cmd);
 
 map_routes_if_t centos_map_routes_to_if(routes_parsed_t *rp, if_list_parsed_t *ilp);
 
+map_routes_if_t centos_stream_routes(const char *cmd, if_list_parsed_t *ilp);
+
 ifcfg_fields_t *centos_parse_ifcfg(const char *path);
 
 ip_show_fields_t *centos_parse_ip_show(const char *cmd);
 
 rt_cfg_t *centos_parse_route_cfg(const char *path);
 
+bool rt_cfg_reserve(rt_cfg_t *route_cfg, int num_lines);
+
 /**********************************************************************/
 /*                         GENERAL FUNCTIONS                          */
 /**********************************************************************/
 
 ifcfg_opt_t opt_str_to_enum(const char *str);
 
-/** Free Structs */
+ifcfg_opt_t ifcfg_split_line(str_slice_t line, str_slice_t *val);
 
-void free_ifcfg_fields(ifcfg_fields_t *free_cfg);
+bool ifcfg_set_field(ifcfg_fields_t *cfg_data, ifcfg_opt_t opt, const char *val);
 
-void free_ip_show_fields(ip_show_fields_t *free_ip_show);
+bool ifcfg_has_line(const ifcfg_fields_t *cfg_data, ifcfg_opt_t opt);
 
-void free_route_config(rt_cfg_t *free_rt_cfg);
+bool centos_write_ifcfg(ifcfg_fields_t *cfg_data, FILE *fp, bool more);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,954 @@
+/**
+ * @file nsync_collect.c
+ * File to store the snapshot of the active network state gathered by the
+ * native collectors and the parsers that map it onto the structs used by
+ * the CentOS and Ubuntu drivers.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <arpa/inet.h>
+#include <fnmatch.h>
+#include <net/if_arp.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
+#include "nsync_collect.h"
+#include "nsync_netlink.h"
+#include "nsync_ipjson.h"
+#include "nsync_procfs.h"
+#include "nsync_dhcp.h"
+#include "nsync_kwhash.h"
+
+/** Not exported by <net/if.h> */
+#ifndef IFF_LOWER_UP
+#define IFF_LOWER_UP 0x10000
+#endif
+
+/** Snapshot shared by all native collectors */
+net_snapshot_t net_snapshot;
+
+/** Links dumped once for the carrier lookups of the `ip` collector */
+static net_snapshot_t carrier_snapshot;
+static bool carrier_dumped;
+
+/**
+ * Interfaces chosen with --if and --type. Kinds that are created and
+ * destroyed with containers and VMs (container veths, tun/tap, overlay
+ * tunnels of CNI plugins) are excluded by default.
+ */
+if_select_t if_select = {
+    .exclude_kinds = { "veth", "tun", "vxlan", "geneve" },
+    .num_exclude_kinds = NUM_EPHEMERAL_KINDS,
+};
+
+/**
+ * Interfaces that exist but were left out of the run by the selection or
+ * a timeout, interned once each. Their persisted configuration must be
+ * kept as it is.
+ */
+static intern_table_t withheld;
+
+centos_parse_func_t centos_netlink_parsers = {
+    .collect                = &netlink_collect,
+    .parse_if_list          = &snapshot_parse_if_list,
+    .parse_routes           = &snapshot_parse_routes,
+    .map_routes_to_if       = &centos_map_routes_to_if,
+    .parse_ifcfg            = &centos_parse_ifcfg,
+    .parse_ip_show          = &snapshot_parse_ip_show,
+    .parse_persist_routes   = &centos_parse_route_cfg,
+};
+
+ubuntu_parse_func_t ubuntu_netlink_parsers = {
+    .collect                            = &netlink_collect,
+    .ubuntu_parse_active_interfaces     = &snapshot_parse_active_interfaces,
+    .ubuntu_parse_active_routes         = &snapshot_parse_active_routes,
+    .ubuntu_parse_persist_interfaces    = &ubuntu_parse_persist_interfaces,
+    .ubuntu_map_routes                  = &map_routes_to_if,
+};
+
+centos_parse_func_t centos_ipjson_parsers = {
+    .collect                = &ipjson_collect,
+    .parse_if_list          = &snapshot_parse_if_list,
+    .parse_routes           = &snapshot_parse_routes,
+    .map_routes_to_if       = &centos_map_routes_to_if,
+    .parse_ifcfg            = &centos_parse_ifcfg,
+    .parse_ip_show          = &snapshot_parse_ip_show,
+    .parse_persist_routes   = &centos_parse_route_cfg,
+};
+
+ubuntu_parse_func_t ubuntu_ipjson_parsers = {
+    .collect                            = &ipjson_collect,
+    .ubuntu_parse_active_interfaces     = &snapshot_parse_active_interfaces,
+    .ubuntu_parse_active_routes         = &snapshot_parse_active_routes,
+    .ubuntu_parse_persist_interfaces    = &ubuntu_parse_persist_interfaces,
+    .ubuntu_map_routes                  = &map_routes_to_if,
+};
+
+centos_parse_func_t centos_procfs_parsers = {
+    .collect                = &procfs_collect,
+    .parse_if_list          = &snapshot_parse_if_list,
+    .parse_routes           = &snapshot_parse_routes,
+    .map_routes_to_if       = &centos_map_routes_to_if,
+    .parse_ifcfg            = &centos_parse_ifcfg,
+    .parse_ip_show          = &snapshot_parse_ip_show,
+    .parse_persist_routes   = &centos_parse_route_cfg,
+};
+
+ubuntu_parse_func_t ubuntu_procfs_parsers = {
+    .collect                            = &procfs_collect,
+    .ubuntu_parse_active_interfaces     = &snapshot_parse_active_interfaces,
+    .ubuntu_parse_active_routes         = &snapshot_parse_active_routes,
+    .ubuntu_parse_persist_interfaces    = &ubuntu_parse_persist_interfaces,
+    .ubuntu_map_routes                  = &map_routes_to_if,
+};
+
+/**
+ * The native collectors gather everything in a single pass, so the
+ * "commands" only name the dump that backs each field.
+ */
+cmd_list_t netlink_cmd_list = {
+    .get_OS = "",
+    .get_if_list = "RTM_GETLINK",
+    .get_addrs = "RTM_GETADDR",
+    .get_active_if_cfg = "%s",
+    .get_routes = "RTM_GETROUTE",
+};
+
+/** One `ip -json` process per object type, run once at collection */
+cmd_list_t ipjson_cmd_list = {
+    .get_OS = "",
+    .get_if_list = "ip -json -details link show",
+    .get_addrs = "ip -json -details addr show",
+    .get_active_if_cfg = "%s",
+    .get_routes = "ip -json -details route show",
+};
+
+cmd_list_t procfs_cmd_list = {
+    .get_OS = "",
+    .get_if_list = SYSFS_NET_DIR,
+    .get_addrs = PROCFS_NET_DIR "/if_inet6",
+    .get_active_if_cfg = "%s",
+    .get_routes = PROCFS_NET_DIR "/route",
+};
+
+/** Names `ip` uses for the link types it knows about */
+static const struct {
+    unsigned short type;
+    const char *name;
+} link_type_names[] = {
+    { ARPHRD_ETHER,         "ether" },
+    { ARPHRD_LOOPBACK,      "loopback" },
+    { ARPHRD_NONE,          "none" },
+    { ARPHRD_INFINIBAND,    "infiniband" },
+    { ARPHRD_TUNNEL,        "ipip" },
+    { ARPHRD_TUNNEL6,       "tunnel6" },
+    { ARPHRD_SIT,           "sit" },
+    { ARPHRD_IPGRE,         "gre" },
+    { ARPHRD_PPP,           "ppp" },
+    { ARPHRD_IEEE80211,     "ieee802.11" },
+    { ARPHRD_VOID,          "void" },
+};
+
+/**
+ * @brief Grows one of the snapshot's arrays so that another element fits
+ *
+ * @param arr pointer to the array
+ * @param num number of elements in use
+ * @param cap pointer to the number of elements allocated
+ * @param size size of a single element
+ * @returns a pointer to a zeroed element at the end of the array, or NULL
+ * if memory could not be allocated
+ */
+static void *snapshot_grow(void **arr, int num, int *cap, size_t size)
+{
+    if (num == *cap) {
+        int new_cap = *cap ? *cap * 2 : 64;
+        void *grown = realloc(*arr, new_cap * size);
+        MEM_CHECK(grown, NULL);
+        *arr = grown;
+        *cap = new_cap;
+    }
+    void *elem = (char *)*arr + num * size;
+    memset(elem, 0, size);
+    return elem;
+}
+
+/**
+ * @brief Appends an empty link to the snapshot
+ * @param snap the snapshot
+ * @returns a pointer to the new link, or NULL on failure
+ */
+net_link_t *snapshot_add_link(net_snapshot_t *snap)
+{
+    net_link_t *link = snapshot_grow((void **)&snap->links, snap->num_links, &snap->cap_links, sizeof(net_link_t));
+    if (!link) return NULL;
+    snap->num_links++;
+
+    /** The index no longer covers every link */
+    free(snap->by_index);
+    free(snap->by_name);
+    snap->by_index = snap->by_name = NULL;
+    snap->num_slots = 0;
+
+    link->carrier = -1;
+    return link;
+}
+
+/**
+ * @brief Appends an empty address to the snapshot
+ * @param snap the snapshot
+ * @returns a pointer to the new address, or NULL on failure
+ */
+net_addr_t *snapshot_add_addr(net_snapshot_t *snap)
+{
+    net_addr_t *addr = snapshot_grow((void **)&snap->addrs, snap->num_addrs, &snap->cap_addrs, sizeof(net_addr_t));
+    if (!addr) return NULL;
+    snap->num_addrs++;
+    addr->valid_lft = INFINITY_LIFE_TIME;
+    return addr;
+}
+
+/**
+ * @brief Appends an empty route to the snapshot
+ * @param snap the snapshot
+ * @returns a pointer to the new route, or NULL on failure
+ */
+net_route_t *snapshot_add_route(net_snapshot_t *snap)
+{
+    net_route_t *rt = snapshot_grow((void **)&snap->routes, snap->num_routes, &snap->cap_routes, sizeof(net_route_t));
+    if (!rt) return NULL;
+    snap->num_routes++;
+    rt->table = RT_TABLE_MAIN;
+    rt->type = RTN_UNICAST;
+    return rt;
+}
+
+/**
+ * @brief Finds the slot of an interface index in the link index
+ * @param snap the snapshot, with its links indexed
+ * @param ifindex the interface index
+ * @returns the slot holding the link with that index, or the empty slot
+ * it would go in
+ */
+static int *link_index_slot(const net_snapshot_t *snap, int ifindex)
+{
+    int mask = snap->num_slots - 1;
+    int s = kw_hash((const char *)&ifindex, sizeof(ifindex), 0) & mask;
+    for (;; s = (s + 1) & mask) {
+        int pos = snap->by_index[s];
+        if (pos == 0 || snap->links[pos - 1].ifindex == ifindex)
+            return &snap->by_index[s];
+    }
+}
+
+/**
+ * @brief Finds the slot of an interface name in the link index
+ * @param snap the snapshot, with its links indexed
+ * @param name the interface name
+ * @returns the slot holding the link with that name, or the empty slot it
+ * would go in
+ */
+static int *link_name_slot(const net_snapshot_t *snap, const char *name)
+{
+    int mask = snap->num_slots - 1;
+    int s = kw_hash(name, strlen(name), 0) & mask;
+    for (;; s = (s + 1) & mask) {
+        int pos = snap->by_name[s];
+        if (pos == 0 || strcmp(snap->links[pos - 1].name, name) == 0)
+            return &snap->by_name[s];
+    }
+}
+
+/**
+ * @brief Indexes the links of a snapshot by interface index and by name.
+ * Collectors index the links once they are read, so that each address and
+ * route finds its link without a scan. Adding a link drops the index.
+ * @param snap the snapshot
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+bool snapshot_index_links(net_snapshot_t *snap)
+{
+    int num_slots = 64;
+    while (num_slots < 2 * snap->num_links)
+        num_slots *= 2;
+
+    int *by_index = calloc(num_slots, sizeof(int));
+    int *by_name = calloc(num_slots, sizeof(int));
+    if (!by_index || !by_name) {
+        free(by_index);
+        free(by_name);
+        sprintf(err_msg, "could not allocate memory");
+        return false;
+    }
+    free(snap->by_index);
+    free(snap->by_name);
+    snap->by_index = by_index;
+    snap->by_name = by_name;
+    snap->num_slots = num_slots;
+
+    /** The first of two links with the same index or name is the one found */
+    for (int i = 0; i < snap->num_links; i++) {
+        int *slot = link_index_slot(snap, snap->links[i].ifindex);
+        if (!*slot)
+            *slot = i + 1;
+        slot = link_name_slot(snap, snap->links[i].name);
+        if (!*slot)
+            *slot = i + 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Looks up a link of the snapshot by name
+ * @param snap the snapshot
+ * @param name the interface name
+ * @returns the link, or NULL if there is no link with that name
+ */
+const net_link_t *snapshot_find_link(const net_snapshot_t *snap, const char *name)
+{
+    if (snap->num_slots) {
+        int pos = *link_name_slot(snap, name);
+        return pos ? &snap->links[pos - 1] : NULL;
+    }
+
+    /** Links being collected are not indexed yet */
+    for (int i = 0; i < snap->num_links; i++) {
+        if (strcmp(snap->links[i].name, name) == 0)
+            return &snap->links[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Looks up a link of the snapshot by interface index
+ * @param snap the snapshot
+ * @param ifindex the interface index
+ * @returns the link, or NULL if there is no link with that index
+ */
+const net_link_t *snapshot_link_by_index(const net_snapshot_t *snap, int ifindex)
+{
+    if (snap->num_slots) {
+        int pos = *link_index_slot(snap, ifindex);
+        return pos ? &snap->links[pos - 1] : NULL;
+    }
+
+    for (int i = 0; i < snap->num_links; i++) {
+        if (snap->links[i].ifindex == ifindex)
+            return &snap->links[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Determines if a link has carrier (the equivalent of ethtool's
+ * "Link detected: yes")
+ * @param link the link
+ * @returns true if the link is up and has carrier
+ */
+bool snapshot_link_is_up(const net_link_t *link)
+{
+    if (!(link->flags & IFF_UP))
+        return false;
+    if (link->carrier >= 0)
+        return link->carrier == 1;
+    return (link->flags & IFF_LOWER_UP) != 0;
+}
+
+/**
+ * @brief Gets the links to answer lookups about single interfaces from:
+ * the snapshot of a native collector when one was taken, otherwise all
+ * links dumped once on the first lookup
+ * @returns the snapshot, or NULL if netlink is unavailable
+ */
+static const net_snapshot_t *link_snapshot(void)
+{
+    if (net_snapshot.collected)
+        return &net_snapshot;
+
+    if (!carrier_dumped) {
+        carrier_dumped = true;
+        netlink_collect_links(&carrier_snapshot);
+    }
+    return carrier_snapshot.collected ? &carrier_snapshot : NULL;
+}
+
+/**
+ * @brief Determines if an interface has carrier. Falls back to sysfs when
+ * netlink is unavailable.
+ *
+ * @param name the name of the interface
+ * @returns true if the interface is up and has carrier
+ */
+bool link_has_carrier(const char *name)
+{
+    const net_snapshot_t *snap = link_snapshot();
+    if (!snap)
+        return sysfs_link_has_carrier(name);
+
+    const net_link_t *link = snapshot_find_link(snap, name);
+    return link && snapshot_link_is_up(link);
+}
+
+/**
+ * @brief Determines if an address was handed out dynamically. Addresses
+ * configured by hand are permanent; leased ones carry a finite lifetime.
+ * @param addr the address
+ * @returns true if the address is not permanent and will expire
+ */
+bool snapshot_addr_is_dynamic(const net_addr_t *addr)
+{
+    return !(addr->flags & IFA_F_PERMANENT) && addr->valid_lft != INFINITY_LIFE_TIME;
+}
+
+/**
+ * @brief Gets the name `ip` uses for a link type
+ * @param type the ARPHRD_* type of the link
+ * @param buf buffer used for unnamed types
+ * @param len the size of buf
+ * @returns the name of the link type
+ */
+static const char *link_type_name(unsigned short type, char *buf, size_t len)
+{
+    for (size_t i = 0; i < sizeof(link_type_names) / sizeof(link_type_names[0]); i++) {
+        if (link_type_names[i].type == type)
+            return link_type_names[i].name;
+    }
+    snprintf(buf, len, "[%u]", type);
+    return buf;
+}
+
+/**
+ * @brief Adds a value to one of the lists of an if_select_t
+ * @param list the list
+ * @param num the number of values in the list
+ * @param val the value, which must outlive the selection
+ * @returns false if the list is full
+ */
+static bool if_select_add(const char **list, int *num, const char *val)
+{
+    if (*num >= MAX_IF_SELECT)
+        return false;
+    list[(*num)++] = val;
+    return true;
+}
+
+/**
+ * @brief Selects the interfaces whose names match a glob
+ * @param glob the glob, as understood by fnmatch(3)
+ * @returns false if too many globs were given
+ */
+bool if_select_glob(const char *glob)
+{
+    return if_select_add(if_select.globs, &if_select.num_globs, glob);
+}
+
+/**
+ * @brief Selects the interfaces of a type: a link type as `ip` names it
+ * (ether, loopback, ...) or a link kind (vlan, bond, ...)
+ * @param type the type
+ * @returns false if too many types were given
+ */
+bool if_select_type(const char *type)
+{
+    return if_select_add(if_select.types, &if_select.num_types, type);
+}
+
+/**
+ * @brief Includes links of a kind that would otherwise be excluded
+ * @param kind the kind, or a glob of kinds ("*" includes everything)
+ * @returns false if too many kinds were given
+ */
+bool if_select_include(const char *kind)
+{
+    return if_select_add(if_select.include_kinds, &if_select.num_include_kinds, kind);
+}
+
+/**
+ * @brief Excludes links of a kind
+ * @param kind the kind, or a glob of kinds
+ * @returns false if too many kinds were given
+ */
+bool if_select_exclude(const char *kind)
+{
+    return if_select_add(if_select.exclude_kinds, &if_select.num_exclude_kinds, kind);
+}
+
+/**
+ * @brief Determines if a list of globs matches a string
+ */
+static bool glob_list_match(const char *const *globs, int num, const char *str)
+{
+    for (int i = 0; i < num; i++) {
+        if (fnmatch(globs[i], str, 0) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Determines if links of a kind are left out of every run. Devices
+ * backed by hardware have no kind and are never excluded.
+ * @param kind the kind (IFLA_INFO_KIND)
+ * @returns true if the kind is excluded and not included again
+ */
+bool link_kind_excluded(const char *kind)
+{
+    if (!kind[0])
+        return false;
+    return glob_list_match(if_select.exclude_kinds, if_select.num_exclude_kinds, kind)
+        && !glob_list_match(if_select.include_kinds, if_select.num_include_kinds, kind)
+        && !glob_list_match(if_select.types, if_select.num_types, kind);
+}
+
+/**
+ * @brief Determines if the name of an interface matches the selection. This
+ * is cheap and is checked before anything else is looked up.
+ * @param name the name of the interface
+ * @returns true if no globs were given or one of them matches
+ */
+bool if_name_selected(const char *name)
+{
+    return !if_select.num_globs || glob_list_match(if_select.globs, if_select.num_globs, name);
+}
+
+/**
+ * @brief Determines if a link matches the selection, by name and by type
+ * @param link the link
+ * @returns true if the link is selected
+ */
+bool snapshot_link_selected(const net_link_t *link)
+{
+    if (!if_name_selected(link->name) || link_kind_excluded(link->kind))
+        return false;
+    if (!if_select.num_types)
+        return true;
+
+    char buf[16];
+    const char *type = link_type_name(link->type, buf, sizeof(buf));
+    for (int i = 0; i < if_select.num_types; i++) {
+        if (strcmp(if_select.types[i], type) == 0 || strcmp(if_select.types[i], link->kind) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Determines if an interface matches the selection, looking up its
+ * type and kind in the link dump, or in sysfs if netlink is unavailable
+ * @param name the name of the interface
+ * @returns true if the interface is selected
+ */
+bool if_is_selected(const char *name)
+{
+    if (!if_name_selected(name))
+        return false;
+
+    const net_snapshot_t *snap = link_snapshot();
+    if (snap) {
+        const net_link_t *link = snapshot_find_link(snap, name);
+        return link && snapshot_link_selected(link);
+    }
+
+    net_link_t link;
+    return sysfs_read_link_info(name, &link) && snapshot_link_selected(&link);
+}
+
+/**
+ * @brief Leaves an interface out of the run, once however often it is
+ * met. Drivers that rewrite shared files write its persisted
+ * configuration back unchanged.
+ * @param name the name of the interface
+ * @returns false if memory could not be allocated
+ */
+bool if_withhold(const char *name)
+{
+    /** a dump that is run again meets the same interfaces again, they are kept once */
+    return intern(&withheld, parse_arena, slice_make(name)) != NULL;
+}
+
+/**
+ * @brief Determines if the run leaves an interface alone: it does not
+ * match --if, or it was withheld because of its kind or type or because
+ * its details timed out. Interfaces that are simply gone are not withheld.
+ * @param name the name of the interface
+ * @returns true if the interface's persisted configuration must be kept
+ */
+bool if_is_withheld(const char *name)
+{
+    return !if_name_selected(name) || intern_find(&withheld, slice_make(name)) != NULL;
+}
+
+/**
+ * @brief Drops the links that are not selected from a snapshot, along with
+ * their addresses and routes, so that nothing downstream works on them.
+ * The links left are indexed, and each notes its first address of each
+ * family, so their details are read without a scan.
+ * @param snap the snapshot
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+bool snapshot_select(net_snapshot_t *snap)
+{
+    int num = 0;
+    for (int i = 0; i < snap->num_links; i++) {
+        net_link_t *link = &snap->links[i];
+        if (!snapshot_link_selected(link)) {
+            if (!if_withhold(link->name))
+                return false;
+            continue;
+        }
+        link->inet = link->inet6 = 0;
+        link->leased = false;
+        snap->links[num++] = *link;
+    }
+    snap->num_links = num;
+    if (!snapshot_index_links(snap))
+        return false;
+
+    num = 0;
+    for (int i = 0; i < snap->num_addrs; i++) {
+        const net_addr_t *addr = &snap->addrs[i];
+        int pos = *link_index_slot(snap, addr->ifindex);
+        if (!pos)
+            continue;
+
+        net_link_t *link = &snap->links[pos - 1];
+        if (addr->family == AF_INET) {
+            if (!link->inet)
+                link->inet = num + 1;
+            link->leased |= snapshot_addr_is_dynamic(addr);
+        }
+        else if (addr->family == AF_INET6 && !link->inet6)
+            link->inet6 = num + 1;
+        snap->addrs[num++] = *addr;
+    }
+    snap->num_addrs = num;
+
+    /** routes without a device (blackhole, unreachable, ...) belong to no interface */
+    num = 0;
+    for (int i = 0; i < snap->num_routes; i++) {
+        if (!snap->routes[i].oif || *link_index_slot(snap, snap->routes[i].oif))
+            snap->routes[num++] = snap->routes[i];
+    }
+    snap->num_routes = num;
+    return true;
+}
+
+/**
+ * @brief Formats a hardware address as colon-separated hex bytes
+ * @param link the link whose address is formatted
+ * @param buf the output buffer
+ * @param len the size of buf
+ * @returns buf
+ */
+static char *format_hwaddr(const net_link_t *link, char *buf, size_t len)
+{
+    size_t off = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < link->hwaddr_len && off + 3 < len; i++)
+        off += snprintf(&buf[off], len - off, i ? ":%02x" : "%02x", link->hwaddr[i]);
+    return buf;
+}
+
+/**
+ * @brief Looks up a link type by the name `ip` uses for it
+ * @param name the name, e.g. "ether"
+ * @returns the ARPHRD_* type, or ARPHRD_VOID if the name is unknown
+ */
+unsigned short snapshot_link_type_from_name(const char *name)
+{
+    for (size_t i = 0; i < sizeof(link_type_names) / sizeof(link_type_names[0]); i++) {
+        if (strcmp(link_type_names[i].name, name) == 0)
+            return link_type_names[i].type;
+    }
+    if (name[0] == '[')
+        return strtoul(&name[1], NULL, 10);
+    return ARPHRD_VOID;
+}
+
+/**
+ * @brief Packs an IPv4 route of the snapshot into a route record
+ *
+ * @param snap the snapshot the route belongs to (to resolve device names)
+ * @param rt the route to pack
+ * @param out receives the record
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+bool snapshot_route_record(const net_snapshot_t *snap, const net_route_t *rt, route_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->family = AF_INET;
+    out->dst_len = rt->dst_len;
+    memcpy(&out->dst, rt->dst, sizeof(out->dst));
+    out->table = rt->table;
+    out->proto = rt->protocol;
+    out->scope = rt->scope;
+    out->type = rt->type;
+    out->flags = rt->flags & (RTNH_F_DEAD | RTNH_F_PERVASIVE | RTNH_F_ONLINK | RTNH_F_LINKDOWN);
+
+    if (rt->has_gw) {
+        memcpy(&out->gw, rt->gw, sizeof(out->gw));
+        out->has |= ROUTE_HAS_GW;
+    }
+    if (rt->has_prefsrc) {
+        memcpy(&out->src, rt->prefsrc, sizeof(out->src));
+        out->has |= ROUTE_HAS_SRC;
+    }
+    if (rt->has_priority) {
+        out->metric = rt->priority;
+        out->has |= ROUTE_HAS_METRIC;
+    }
+
+    if (rt->oif) {
+        char name[IF_NAMESIZE + 16];
+        const net_link_t *link = snapshot_link_by_index(snap, rt->oif);
+        if (link)
+            safe_strncpy(name, link->name, sizeof(name));
+        else
+            snprintf(name, sizeof(name), "if%d", rt->oif);
+        out->oif = route_dev_id(slice_make(name));
+        if (out->oif < 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Frees all data held by the shared snapshot
+ */
+void free_snapshot(void)
+{
+    free(net_snapshot.links);
+    free(net_snapshot.addrs);
+    free(net_snapshot.routes);
+    free(net_snapshot.by_index);
+    free(net_snapshot.by_name);
+    memset(&net_snapshot, 0, sizeof(net_snapshot));
+
+    free(carrier_snapshot.links);
+    free(carrier_snapshot.by_index);
+    free(carrier_snapshot.by_name);
+    memset(&carrier_snapshot, 0, sizeof(carrier_snapshot));
+    carrier_dumped = false;
+
+    /** the names live in the arena, which is reset with the snapshot */
+    intern_reset(&withheld);
+}
+
+/**
+ * @brief Finds the first address of the given family on an interface, as
+ * noted by snapshot_select
+ * @param link the interface
+ * @param family AF_INET or AF_INET6
+ * @returns the address, or NULL if the interface has none
+ */
+static const net_addr_t *snapshot_first_addr(const net_link_t *link, unsigned char family)
+{
+    int pos = family == AF_INET ? link->inet : link->inet6;
+    return pos ? &net_snapshot.addrs[pos - 1] : NULL;
+}
+
+/**
+ * @brief Determines if an interface gets its address from DHCP, either
+ * because one of its IPv4 addresses was leased or because a DHCP client
+ * or lease was found for it
+ * @param link the interface
+ * @returns true if the interface is dynamic
+ */
+static bool snapshot_if_is_dynamic(const net_link_t *link)
+{
+    return link->leased || dhcp_if_is_dynamic(link->name);
+}
+
+/**
+ * @brief Builds the list of interfaces with carrier from the snapshot
+ *
+ * @param cmd unused, the snapshot has already been collected
+ * @returns a pointer to an if_list_parsed struct containing the
+ * parsed information
+ */
+if_list_parsed_t *snapshot_parse_if_list(const char *cmd)
+{
+    (void) cmd;
+
+    if_list_parsed_t *parsed_list = arena_alloc(parse_arena, sizeof(if_list_parsed_t));
+    MEM_CHECK(parsed_list, NULL);
+
+    for (int i = 0; i < net_snapshot.num_links; i++) {
+        const net_link_t *link = &net_snapshot.links[i];
+        if (!snapshot_link_is_up(link))
+            continue;
+
+        const char **slot = ARRAY_PUSH(parse_arena, parsed_list->if_list, parsed_list->num_if, parsed_list->cap_if);
+        if (!slot)
+            return NULL;
+        *slot = slice_intern(slice_make(link->name));
+        MEM_CHECK(*slot, NULL);
+    }
+
+    return parsed_list;
+}
+
+/**
+ * @brief Renders the IPv4 routes of the snapshot in `ip route` form. Routes
+ * created by the kernel are ignored, just as in centos_parse_routes.
+ *
+ * @param cmd unused, the snapshot has already been collected
+ * @returns a pointer to an routes_parsed struct containing the
+ * parsed information
+ */
+routes_parsed_t *snapshot_parse_routes(const char *cmd)
+{
+    (void) cmd;
+
+    routes_parsed_t *parsed_routes = arena_alloc(parse_arena, sizeof(routes_parsed_t));
+    MEM_CHECK(parsed_routes, NULL);
+
+    for (int i = 0; i < net_snapshot.num_routes; i++) {
+        const net_route_t *rt = &net_snapshot.routes[i];
+        if (rt->family != AF_INET || rt->protocol == RTPROT_KERNEL)
+            continue;
+
+        centos_route_t *slot = ARRAY_PUSH(parse_arena, parsed_routes->route_list, parsed_routes->num_route, parsed_routes->cap_route);
+        if (!slot || !snapshot_route_record(&net_snapshot, rt, slot))
+            return NULL;
+    }
+
+    return parsed_routes;
+}
+
+/**
+ * @brief Fills the active configuration of an interface from the snapshot
+ *
+ * @param name the name of the interface
+ * @returns a pointer to an ip_show_fields_t struct. If a field is not set
+ * in the active config, then it is left empty (NULL) in the struct.
+ */
+ip_show_fields_t *snapshot_parse_ip_show(const char *name)
+{
+    ip_show_fields_t *addr_show_data = arena_alloc(parse_arena, sizeof(ip_show_fields_t));
+    MEM_CHECK(addr_show_data, fatal_err_ptr);
+
+    addr_show_data->name = slice_intern(slice_make(name));
+    MEM_CHECK(addr_show_data->name, fatal_err_ptr);
+
+    const net_link_t *link = snapshot_find_link(&net_snapshot, name);
+    if (!link)
+        return addr_show_data;
+
+    char val[MAX_VAL_LEN];
+
+    snprintf(val, sizeof(val), "%u", link->mtu);
+    addr_show_data->mtu = slice_intern(slice_make(val));
+    MEM_CHECK(addr_show_data->mtu, fatal_err_ptr);
+
+    addr_show_data->link = slice_intern(slice_make(link_type_name(link->type, val, sizeof(val))));
+    MEM_CHECK(addr_show_data->link, fatal_err_ptr);
+
+    const net_addr_t *inet = snapshot_first_addr(link, AF_INET);
+    if (inet) {
+        ip_addr_set(&addr_show_data->inet, AF_INET, inet->addr, IP_NO_PREFIX);
+        ip_addr_netmask(inet->prefixlen, &addr_show_data->inet_mask);
+    }
+
+    const net_addr_t *inet6 = snapshot_first_addr(link, AF_INET6);
+    if (inet6)
+        ip_addr_set(&addr_show_data->inet6, AF_INET6, inet6->addr, inet6->prefixlen);
+
+    addr_show_data->dynamic = snapshot_if_is_dynamic(link);
+
+    return addr_show_data;
+}
+
+/**
+ * @brief Builds the details of all active interfaces from the snapshot
+ *
+ * @param if_list_cmd unused, the snapshot has already been collected
+ * @param if_name_fmt unused, the snapshot has already been collected
+ * @returns a pointer to an if_data_t struct containing all of the information
+ * about the active interfaces
+ */
+if_data_t *snapshot_parse_active_interfaces(const char *if_list_cmd, const char *if_name_fmt)
+{
+    (void) if_list_cmd;
+    (void) if_name_fmt;
+
+    if_data_t *ifaces = arena_alloc(parse_arena, sizeof(if_data_t));
+    MEM_CHECK(ifaces, NULL);
+
+    char val[MAX_UBUNTU_IF_VAL];
+
+    for (int l = 0; l < net_snapshot.num_links; l++) {
+        const net_link_t *link = &net_snapshot.links[l];
+        if (!snapshot_link_is_up(link))
+            continue;
+
+        interface_t *if_ = arena_alloc(parse_arena, sizeof(interface_t));
+        MEM_CHECK(if_, NULL);
+
+        if (!if_data_reserve(ifaces, ifaces->num_if + 1))
+            return NULL;
+        if_->name = slice_intern(slice_make(link->name));
+        MEM_CHECK(if_->name, NULL);
+        ifaces->if_name_list[ifaces->num_if] = if_->name;
+
+        /** Ethernet links are described by how they get their address */
+        const char *linktype = link_type_name(link->type, val, sizeof(val));
+        if (link->type == ARPHRD_ETHER)
+            linktype = snapshot_if_is_dynamic(link) ? "dhcp" : "static";
+        if_->linktype = slice_intern(slice_make(linktype));
+        MEM_CHECK(if_->linktype, NULL);
+
+        const net_addr_t *inet = snapshot_first_addr(link, AF_INET);
+        if (inet) {
+            ip_addr_set(&if_->address, AF_INET, inet->addr, IP_NO_PREFIX);
+            ip_addr_netmask(inet->prefixlen, &if_->netmask);
+            if_->auto_opt = true;
+
+            /** `ip addr` prints "brd <addr> scope <scope>", the scope whether or not there is a broadcast */
+            if (inet->has_brd)
+                ip_addr_set(&if_->broadcast, AF_INET, inet->brd, IP_NO_PREFIX);
+            if_->scope = slice_intern(slice_make(route_scope_name(inet->scope, val, sizeof(val))));
+            MEM_CHECK(if_->scope, NULL);
+        }
+
+        snprintf(val, sizeof(val), "%u", link->mtu);
+        if_->mtu = slice_intern(slice_make(val));
+        MEM_CHECK(if_->mtu, NULL);
+
+        if (link->hwaddr_len) {
+            if_->hwaddress = slice_intern(slice_make(format_hwaddr(link, val, sizeof(val))));
+            MEM_CHECK(if_->hwaddress, NULL);
+        }
+
+        ifaces->interfaces[ifaces->num_if++] = if_;
+    }
+
+    return ifaces;
+}
+
+/**
+ * @brief Renders the IPv4 routes of the snapshot in `ip route` form. Routes
+ * created by the kernel are ignored, just as in ubuntu_parse_active_routes.
+ *
+ * @param cmd unused, the snapshot has already been collected
+ * @returns a pointer to a route_list_t struct containing all of the active routes
+ */
+route_list_t *snapshot_parse_active_routes(const char *cmd)
+{
+    (void) cmd;
+
+    route_list_t *route_lst = arena_alloc(parse_arena, sizeof(route_list_t));
+    MEM_CHECK(route_lst, NULL);
+
+    for (int i = 0; i < net_snapshot.num_routes; i++) {
+        const net_route_t *rt = &net_snapshot.routes[i];
+        if (rt->family != AF_INET || rt->protocol == RTPROT_KERNEL)
+            continue;
+
+        ubuntu_route_t *slot = ARRAY_PUSH(parse_arena, route_lst->routes, route_lst->num_routes, route_lst->cap_routes);
+        if (!slot || !snapshot_route_record(&net_snapshot, rt, slot))
+            return NULL;
+    }
+
+    return route_lst;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file nsync_collect.h
+ * Stores the snapshot of the active network state that the native
+ * collectors build, and the functions that map it onto the parsed structs
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_COLLECT_H
+#define NSYNC_COLLECT_H
+
+#include <stdint.h>
+#include <net/if.h>
+#include "nsync_utils.h"
+#include "nsync_info.h"
+#include "nsync_centos_parse.h"
+#include "nsync_ubuntu_parse.h"
+#include "nsync_route.h"
+
+/** GLOBAL ERROR BUFFER */
+extern char err_msg[ERR_LEN];
+
+/**********************************************************************/
+/*                             CONSTANTS                              */
+/**********************************************************************/
+#define MAX_HWADDR_LEN 32
+#define MAX_KIND_LEN 32
+#define MAX_IF_SELECT 16
+#define NUM_EPHEMERAL_KINDS 4
+
+/** Lifetime the kernel reports for addresses that never expire */
+#define INFINITY_LIFE_TIME 0xFFFFFFFFU
+
+/**********************************************************************/
+/*                             STRUCTS                                */
+/**********************************************************************/
+/**
+ * @struct net_link
+ * @brief a single network interface as reported by the kernel
+ */
+typedef struct net_link {
+    int ifindex;
+    char name[IF_NAMESIZE];
+    unsigned int flags;
+    unsigned int mtu;
+    unsigned char operstate;
+    int carrier;                    // -1 if the kernel did not report it
+    unsigned short type;            // ARPHRD_* value
+    unsigned char hwaddr[MAX_HWADDR_LEN];
+    int hwaddr_len;
+    char kind[MAX_KIND_LEN];        // IFLA_INFO_KIND, empty for physical devices
+    int inet;                       // position + 1 of its first IPv4 address, 0 for none
+    int inet6;                      // position + 1 of its first IPv6 address, 0 for none
+    bool leased;                    // one of its IPv4 addresses is dynamic
+} net_link_t;
+
+/**
+ * @struct net_addr
+ * @brief a single address assigned to an interface
+ */
+typedef struct net_addr {
+    int ifindex;
+    unsigned char family;
+    unsigned char prefixlen;
+    unsigned char scope;
+    unsigned int flags;             // IFA_F_* flags
+    unsigned int valid_lft;         // seconds, INFINITY_LIFE_TIME if static
+    unsigned char addr[16];
+    unsigned char brd[16];
+    bool has_brd;
+} net_addr_t;
+
+/**
+ * @struct net_route
+ * @brief a single route of the main routing table
+ */
+typedef struct net_route {
+    unsigned char family;
+    unsigned char dst_len;
+    unsigned char protocol;
+    unsigned char scope;
+    unsigned char type;
+    unsigned int flags;             // RTNH_F_* flags
+    unsigned int table;
+    int oif;
+    unsigned int priority;
+    bool has_priority;
+    unsigned char dst[16];
+    unsigned char gw[16];
+    bool has_gw;
+    unsigned char prefsrc[16];
+    bool has_prefsrc;
+} net_route_t;
+
+/**
+ * @struct if_select
+ * @brief the interfaces to sync, chosen with --if and --type. Every
+ * interface is selected when both lists are empty. Links of an excluded
+ * kind are never selected unless the kind is also included (--include,
+ * or named with --type).
+ */
+typedef struct if_select {
+    const char *globs[MAX_IF_SELECT];
+    int num_globs;
+    const char *types[MAX_IF_SELECT];
+    int num_types;
+    const char *include_kinds[MAX_IF_SELECT];
+    int num_include_kinds;
+    const char *exclude_kinds[MAX_IF_SELECT];
+    int num_exclude_kinds;
+} if_select_t;
+
+/**
+ * @struct net_snapshot
+ * @brief everything a collector gathered about the active network
+ * configuration in a single pass
+ */
+typedef struct net_snapshot {
+    net_link_t *links;
+    int num_links;
+    int cap_links;
+
+    net_addr_t *addrs;
+    int num_addrs;
+    int cap_addrs;
+
+    net_route_t *routes;
+    int num_routes;
+    int cap_routes;
+
+    int *by_index;                  // position + 1 of the link in each slot, hashed by ifindex; 0 for empty
+    int *by_name;                   // the same, hashed by name
+    int num_slots;                  // a power of two, 0 while the links are not indexed
+
+    bool collected;
+} net_snapshot_t;
+
+/** The snapshot shared by all native collectors */
+extern net_snapshot_t net_snapshot;
+
+/** The interfaces to sync */
+extern if_select_t if_select;
+
+/** Parser tables for the native collectors */
+extern centos_parse_func_t centos_netlink_parsers;
+extern ubuntu_parse_func_t ubuntu_netlink_parsers;
+extern centos_parse_func_t centos_ipjson_parsers;
+extern ubuntu_parse_func_t ubuntu_ipjson_parsers;
+extern centos_parse_func_t centos_procfs_parsers;
+extern ubuntu_parse_func_t ubuntu_procfs_parsers;
+
+/** Command tables for the native collectors */
+extern cmd_list_t netlink_cmd_list;
+extern cmd_list_t ipjson_cmd_list;
+extern cmd_list_t procfs_cmd_list;
+
+/**********************************************************************/
+/*                            SNAPSHOT                                */
+/**********************************************************************/
+
+net_link_t *snapshot_add_link(net_snapshot_t *snap);
+
+net_addr_t *snapshot_add_addr(net_snapshot_t *snap);
+
+net_route_t *snapshot_add_route(net_snapshot_t *snap);
+
+bool snapshot_index_links(net_snapshot_t *snap);
+
+const net_link_t *snapshot_find_link(const net_snapshot_t *snap, const char *name);
+
+const net_link_t *snapshot_link_by_index(const net_snapshot_t *snap, int ifindex);
+
+bool snapshot_link_is_up(const net_link_t *link);
+
+bool link_has_carrier(const char *name);
+
+bool snapshot_addr_is_dynamic(const net_addr_t *addr);
+
+unsigned short snapshot_link_type_from_name(const char *name);
+
+bool if_select_glob(const char *glob);
+
+bool if_select_type(const char *type);
+
+bool if_select_include(const char *kind);
+
+bool if_select_exclude(const char *kind);
+
+bool link_kind_excluded(const char *kind);
+
+bool if_name_selected(const char *name);
+
+bool snapshot_link_selected(const net_link_t *link);
+
+bool if_is_selected(const char *name);
+
+bool if_withhold(const char *name);
+
+bool if_is_withheld(const char *name);
+
+bool snapshot_select(net_snapshot_t *snap);
+
+bool snapshot_route_record(const net_snapshot_t *snap, const net_route_t *rt, route_t *out);
+
+void free_snapshot(void);
+
+/**********************************************************************/
+/*                             PARSERS                                */
+/**********************************************************************/
+
+if_list_parsed_t *snapshot_parse_if_list(const char *cmd);
+
+routes_parsed_t *snapshot_parse_routes(const char *cmd);
+
+ip_show_fields_t *snapshot_parse_ip_show(const char *name);
+
+if_data_t *snapshot_parse_active_interfaces(const char *if_list_cmd, const char *if_name_fmt);
+
+route_list_t *snapshot_parse_active_routes(const char *cmd);
+
+#endif
@@ -0,0 +1,396 @@
+/**
+ * @file nsync_dhcp.c
+ * Determines which interfaces get their address from DHCP. Running clients
+ * are found with one scan of /proc/<pid>/cmdline, and leases that have not
+ * expired are read from the lease directories of dhclient, NetworkManager
+ * and systemd-networkd. The result is built once on first lookup.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include "nsync_dhcp.h"
+
+/** Interfaces found to be configured by DHCP */
+static dhcp_ifs_t dhcp_ifs;
+
+static const char *const dhclient_value_opts[] = {
+    "-cf", "-lf", "-pf", "-sf", "-df", "-s", "-g", "-p", "-e", "-H", "-F", "-V",
+    "--decline-wait-time", "--dad-wait-time", "--prefix-len-hint", "--address-prefix-len",
+    NULL,
+};
+
+static const char *const dhcpcd_value_opts[] = {
+    "-c", "-e", "-F", "-f", "-h", "-I", "-i", "-l", "-m", "-O", "-o", "-Q",
+    "-r", "-S", "-s", "-t", "-u", "-v", "-y", "-z", "-C",
+    NULL,
+};
+
+static const char *const udhcpc_value_opts[] = {
+    "-p", "-s", "-H", "-h", "-V", "-x", "-O", "-r", "-T", "-t", "-A", "-F", "-c", "-C",
+    NULL,
+};
+
+/** DHCP clients that name their interfaces on the command line */
+static const dhcp_client_t dhcp_clients[] = {
+    { "dhclient",   dhclient_value_opts,    NULL,   true },
+    { "dhcpcd",     dhcpcd_value_opts,      NULL,   true },
+    { "udhcpc",     udhcpc_value_opts,      "-i",   false },
+};
+
+/** Directories holding dhclient style and NetworkManager leases */
+static const char *lease_dirs[] = {
+    "/var/lib/dhcp",
+    "/var/lib/dhclient",
+    "/var/lib/NetworkManager",
+};
+
+/**
+ * @brief Records an interface as configured by DHCP
+ * @param name the name of the interface
+ * @returns false if memory could not be allocated
+ */
+static bool dhcp_add(const char *name)
+{
+    if (!name[0] || strlen(name) >= IF_NAMESIZE)
+        return true;
+
+    for (int i = 0; i < dhcp_ifs.num; i++) {
+        if (strcmp(dhcp_ifs.names[i], name) == 0)
+            return true;
+    }
+
+    if (dhcp_ifs.num == dhcp_ifs.cap) {
+        int new_cap = dhcp_ifs.cap ? dhcp_ifs.cap * 2 : 16;
+        void *grown = realloc(dhcp_ifs.names, new_cap * sizeof(dhcp_ifs.names[0]));
+        MEM_CHECK(grown, false);
+        dhcp_ifs.names = grown;
+        dhcp_ifs.cap = new_cap;
+    }
+    safe_strncpy(dhcp_ifs.names[dhcp_ifs.num++], name, IF_NAMESIZE);
+    return true;
+}
+
+/**
+ * @brief Determines if an option of a DHCP client takes the next argument
+ * as its value
+ */
+static bool dhcp_opt_takes_value(const dhcp_client_t *client, const char *opt)
+{
+    for (int i = 0; client->value_opts[i]; i++) {
+        if (strcmp(client->value_opts[i], opt) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Records the interfaces named on the command line of a DHCP client.
+ * Arguments are compared whole, so eth1 never matches eth10.
+ *
+ * @param client the client
+ * @param args the arguments after the program name, NUL separated
+ * @param end the end of args
+ * @returns false if memory could not be allocated
+ */
+static bool dhcp_add_client_ifs(const dhcp_client_t *client, const char *args, const char *end)
+{
+    bool is_value = false, is_if = false;
+
+    for (const char *arg = args; arg < end; arg += strlen(arg) + 1) {
+        if (is_if) {
+            if (!dhcp_add(arg))
+                return false;
+        }
+        else if (is_value) {
+            /** value of an option, not an interface */
+        }
+        else if (arg[0] == '-') {
+            size_t opt_len = client->if_opt ? strlen(client->if_opt) : 0;
+            if (client->if_opt && strncmp(arg, client->if_opt, opt_len) == 0 && arg[opt_len]) {
+                if (!dhcp_add(&arg[opt_len]))
+                    return false;
+            }
+            else if (client->if_opt && strcmp(arg, client->if_opt) == 0) {
+                is_if = true;
+                continue;
+            }
+            else if (dhcp_opt_takes_value(client, arg)) {
+                is_value = true;
+                continue;
+            }
+        }
+        else if (client->bare_ifs && !dhcp_add(arg))
+            return false;
+
+        is_value = is_if = false;
+    }
+    return true;
+}
+
+/**
+ * @brief Scans the command line of every process once for DHCP clients
+ * @returns false if memory could not be allocated
+ */
+static bool dhcp_scan_procs(void)
+{
+    DIR *proc = opendir("/proc");
+    if (!proc)
+        return true;
+
+    char *buf = malloc(DHCP_CMDLINE_LEN);
+    if (!buf) {
+        sprintf(err_msg, "could not allocate memory");
+        closedir(proc);
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent *ent;
+    while (ok && (ent = readdir(proc)) != NULL) {
+        if (!isdigit((unsigned char)ent->d_name[0]))
+            continue;
+
+        char path[NAME_MAX + 16];
+        snprintf(path, sizeof(path), "%s/cmdline", ent->d_name);
+        int fd = openat(dirfd(proc), path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        ssize_t n = read(fd, buf, DHCP_CMDLINE_LEN - 1);
+        close(fd);
+        if (n <= 0)
+            continue;
+        buf[n] = '\0';
+
+        const char *prog = strrchr(buf, '/');
+        prog = prog ? prog + 1 : buf;
+
+        for (size_t i = 0; i < sizeof(dhcp_clients) / sizeof(dhcp_clients[0]); i++) {
+            if (strcmp(prog, dhcp_clients[i].name) == 0) {
+                ok = dhcp_add_client_ifs(&dhcp_clients[i], buf + strlen(buf) + 1, buf + n);
+                break;
+            }
+        }
+    }
+
+    free(buf);
+    closedir(proc);
+    return ok;
+}
+
+/**
+ * @brief Parses the expiry of a dhclient lease, either
+ * "expire <weekday> <yyyy/mm/dd> <hh:mm:ss>;" in UTC, "expire epoch <secs>;"
+ * or "expire never;"
+ *
+ * @param val the text after "expire"
+ * @param now the current time
+ * @returns true if the lease has not expired
+ */
+static bool dhcp_expire_valid(const char *val, time_t now)
+{
+    long long epoch;
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+
+    if (strncmp(val, "never", 5) == 0)
+        return true;
+    if (sscanf(val, "epoch %lld", &epoch) == 1)
+        return epoch > now;
+    if (sscanf(val, "%*d %d/%d/%d %d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+               &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 6) {
+        tm.tm_year -= 1900;
+        tm.tm_mon -= 1;
+        return timegm(&tm) > now;
+    }
+    return false;
+}
+
+/**
+ * @brief Reads a lease file. dhclient style files hold blocks naming their
+ * interface and expiry. Key=value files (systemd-networkd and the internal
+ * client of NetworkManager) hold a LIFETIME relative to when they were
+ * written; their interface is given by the caller.
+ *
+ * @param dirfd the directory of the file
+ * @param file the name of the file
+ * @param if_name the interface of a key=value lease, or NULL
+ * @param now the current time
+ * @returns false if memory could not be allocated
+ */
+static bool dhcp_read_lease(int dirfd, const char *file, const char *if_name, time_t now)
+{
+    int fd = openat(dirfd, file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return true;
+
+    struct stat st;
+    FILE *fp = fstat(fd, &st) == 0 ? fdopen(fd, "r") : NULL;
+    if (!fp) {
+        close(fd);
+        return true;
+    }
+
+    char line[DHCP_LINE_LEN];
+    char lease_if[IF_NAMESIZE] = "";
+    bool valid = false, keyval = false;
+    long long lifetime = -1;
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), fp)) {
+        char *l = trim(line, NULL);
+
+        if (strncmp(l, "LIFETIME=", 9) == 0) {
+            keyval = true;
+            lifetime = strtoll(&l[9], NULL, 10);
+        }
+        else if (strncmp(l, "ADDRESS=", 8) == 0)
+            keyval = true;
+        else if (strncmp(l, "interface ", 10) == 0) {
+            char *name = trim(&l[10], "\";");
+            safe_strncpy(lease_if, name, IF_NAMESIZE);
+        }
+        else if (strncmp(l, "expire ", 7) == 0)
+            valid = dhcp_expire_valid(&l[7], now);
+        else if (l[0] == '}') {
+            if (valid && lease_if[0])
+                ok = dhcp_add(lease_if);
+            valid = false;
+            lease_if[0] = '\0';
+        }
+    }
+    fclose(fp);
+
+    if (ok && keyval && if_name && (lifetime < 0 || st.st_mtime + lifetime > now))
+        ok = dhcp_add(if_name);
+    return ok;
+}
+
+/**
+ * @brief Reads the leases of systemd-networkd, which are named by the
+ * index of their interface
+ * @param now the current time
+ * @returns false if memory could not be allocated
+ */
+static bool dhcp_scan_networkd(time_t now)
+{
+    DIR *dir = opendir(NETWORKD_LEASE_DIR);
+    if (!dir)
+        return true;
+
+    bool ok = true;
+    struct dirent *ent;
+    while (ok && (ent = readdir(dir)) != NULL) {
+        char if_name[IF_NAMESIZE];
+        if (!isdigit((unsigned char)ent->d_name[0]))
+            continue;
+        if (!if_indextoname(strtoul(ent->d_name, NULL, 10), if_name))
+            continue;
+        ok = dhcp_read_lease(dirfd(dir), ent->d_name, if_name, now);
+    }
+
+    closedir(dir);
+    return ok;
+}
+
+/**
+ * @brief Determines if a string ends with the given suffix
+ */
+static bool has_suffix(const char *str, const char *suffix)
+{
+    size_t len = strlen(str), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(&str[len - suffix_len], suffix) == 0;
+}
+
+/**
+ * @brief Reads the lease files of dhclient and NetworkManager. NetworkManager
+ * names its leases <client>-<connection uuid>-<interface>.lease.
+ * @param now the current time
+ * @returns false if memory could not be allocated
+ */
+static bool dhcp_scan_lease_dirs(time_t now)
+{
+    bool ok = true;
+
+    for (size_t d = 0; ok && d < sizeof(lease_dirs) / sizeof(lease_dirs[0]); d++) {
+        DIR *dir = opendir(lease_dirs[d]);
+        if (!dir)
+            continue;
+
+        struct dirent *ent;
+        while (ok && (ent = readdir(dir)) != NULL) {
+            const char *name = ent->d_name;
+            if (!has_suffix(name, ".lease") && !has_suffix(name, ".leases"))
+                continue;
+
+            /** only NetworkManager's own key=value leases need the name */
+            char if_name[IF_NAMESIZE] = "";
+            const char *dash = strchr(name, '-');
+            if (dash && strlen(dash) > 38 && dash[37] == '-') {
+                safe_strncpy(if_name, &dash[38], IF_NAMESIZE);
+                char *dot = strrchr(if_name, '.');
+                if (dot) *dot = '\0';
+            }
+            ok = dhcp_read_lease(dirfd(dir), name, if_name[0] ? if_name : NULL, now);
+        }
+        closedir(dir);
+    }
+    return ok;
+}
+
+/**
+ * @brief Determines if an interface is configured by DHCP, either because
+ * a DHCP client is running for it or because it holds a lease that has
+ * not expired. All sources are read once, on the first call.
+ *
+ * @param name the name of the interface
+ * @returns true if the interface gets its address from DHCP
+ */
+bool dhcp_if_is_dynamic(const char *name)
+{
+    if (!dhcp_ifs.scanned) {
+        time_t now = time(NULL);
+        dhcp_ifs.scanned = true;
+        if (!dhcp_scan_procs() || !dhcp_scan_networkd(now) || !dhcp_scan_lease_dirs(now))
+            fprintf(stderr, "%sCould not determine DHCP interfaces: %s%s\n", KYEL, err_msg, KNRM);
+    }
+
+    for (int i = 0; i < dhcp_ifs.num; i++) {
+        if (strcmp(dhcp_ifs.names[i], name) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Determines if the IPv4 address in the output of `ip addr show <if>`
+ * was leased. `ip` marks such addresses "dynamic" on their own line, which
+ * is followed by their lifetimes.
+ *
+ * @param out the output of the command
+ * @returns true if the first IPv4 address is dynamic
+ */
+bool dhcp_ip_show_is_dynamic(const char *out)
+{
+    const char *inet = strstr(out, "inet ");
+    if (!inet)
+        return false;
+
+    const char *end = strstr(inet, "valid_lft");
+    for (const char *dyn = strstr(inet, " dynamic"); dyn && (!end || dyn < end); dyn = strstr(dyn + 1, " dynamic")) {
+        if (isspace((unsigned char)dyn[8]))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Frees the interfaces found by the DHCP scan
+ */
+void free_dhcp(void)
+{
+    free(dhcp_ifs.names);
+    memset(&dhcp_ifs, 0, sizeof(dhcp_ifs));
+}
@@ -0,0 +1,58 @@
+/**
+ * @file nsync_dhcp.h
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_DHCP_H
+#define NSYNC_DHCP_H
+
+#include <net/if.h>
+#include "nsync_utils.h"
+
+/** GLOBAL ERROR BUFFER */
+extern char err_msg[ERR_LEN];
+
+/**********************************************************************/
+/*                             CONSTANTS                              */
+/**********************************************************************/
+#define DHCP_CMDLINE_LEN 4096
+#define DHCP_LINE_LEN 512
+
+#define NETWORKD_LEASE_DIR "/run/systemd/netif/leases"
+
+/**********************************************************************/
+/*                             STRUCTS                                */
+/**********************************************************************/
+/**
+ * @struct dhcp_client
+ * @brief how to find the interfaces on the command line of a DHCP client
+ */
+typedef struct dhcp_client {
+    const char *name;
+    const char *const *value_opts;  // options whose value is the next argument
+    const char *if_opt;             // option whose value is the interface, if any
+    bool bare_ifs;                  // plain arguments are interfaces
+} dhcp_client_t;
+
+/**
+ * @struct dhcp_ifs
+ * @brief the interfaces found to be configured by DHCP, built once per run
+ */
+typedef struct dhcp_ifs {
+    char (*names)[IF_NAMESIZE];
+    int num;
+    int cap;
+    bool scanned;
+} dhcp_ifs_t;
+
+/**********************************************************************/
+/*                            FUNCTIONS                               */
+/**********************************************************************/
+
+bool dhcp_if_is_dynamic(const char *name);
+
+bool dhcp_ip_show_is_dynamic(const char *out);
+
+void free_dhcp(void);
+
+#endif
@@ -20,11 +20,15 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    parse_arena = &nsync_info->arena;
+    parse_strings = &nsync_info->strings;
+
     nsync_info->CURR_STATE = NSYNC_START;
     nsync_info->sys.os = INVALID_OS;
     nsync_info->arping_wait = true;
 
     sprintf(err_msg, "unknown error");
+    int run_budget_ms = 0;
 
     // Parse CMD Line args
     for (int i = 1; i < argc; i++) {
@@ -55,11 +59,78 @@ int main(int argc, char *argv[])
                 return 1;
             }
         }
+        else if (strcmp(argv[i],"-c") == 0){
+            if (i+1 < argc && (nsync_info->collector = collector_from_name(argv[i+1])) != INVALID_COLLECT) {
+                i++;
+            }
+            else {
+                fprintf(stderr, "nsync: -c flag must be followed by one of: netlink, ip, ip-json, procfs\n");
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i],"-j") == 0){
+            char *end = NULL;
+            long jobs = (i+1 < argc) ? strtol(argv[i+1], &end, 10) : -1;
+            if (end == NULL || end == argv[i+1] || *end != '\0' || jobs < 1 || jobs > EXEC_MAX_JOBS) {
+                fprintf(stderr, "nsync: -j flag must be followed by the number of commands to run at once, from 1 to %d\n",
+                        EXEC_MAX_JOBS);
+                return 1;
+            }
+            exec_max_jobs = jobs;
+            i++;
+        }
+        else if (strcmp(argv[i],"-t") == 0 || strcmp(argv[i],"-T") == 0){
+            char *end = NULL;
+            double secs = (i+1 < argc) ? strtod(argv[i+1], &end) : -1;
+            if (end == NULL || end == argv[i+1] || *end != '\0' || !(secs >= 0 && secs <= EXEC_MAX_SECS)) {
+                fprintf(stderr, "nsync: %s flag must be followed by a number of seconds up to %d (0 for no limit)\n",
+                        argv[i], EXEC_MAX_SECS);
+                return 1;
+            }
+            /** A limit shorter than a ms still limits */
+            int ms = secs > 0 && secs < 0.001 ? 1 : (int)(secs * 1000);
+            if (argv[i++][1] == 't') exec_timeout_ms = ms;
+            else run_budget_ms = ms;
+        }
+        else if (strcmp(argv[i],"--if") == 0 || strcmp(argv[i],"--type") == 0){
+            bool is_glob = strcmp(argv[i],"--if") == 0;
+            if (i+1 >= argc) {
+                fprintf(stderr, "nsync: %s flag must be followed by %s\n", argv[i],
+                        is_glob ? "an interface name or glob" : "an interface type");
+                return 1;
+            }
+            if (!(is_glob ? if_select_glob(argv[i+1]) : if_select_type(argv[i+1]))) {
+                fprintf(stderr, "nsync: %s may be given at most %d times\n", argv[i], MAX_IF_SELECT);
+                return 1;
+            }
+            i++;
+        }
+        else if (strcmp(argv[i],"--include") == 0 || strcmp(argv[i],"--exclude") == 0){
+            bool include = strcmp(argv[i],"--include") == 0;
+            if (i+1 >= argc) {
+                fprintf(stderr, "nsync: %s flag must be followed by an interface kind\n", argv[i]);
+                return 1;
+            }
+            if (!(include ? if_select_include(argv[i+1]) : if_select_exclude(argv[i+1]))) {
+                fprintf(stderr, "nsync: %s may be given at most %d times\n", argv[i],
+                        include ? MAX_IF_SELECT : MAX_IF_SELECT - NUM_EPHEMERAL_KINDS);
+                return 1;
+            }
+            i++;
+        }
         else if (strcmp(argv[i],"-h") == 0){
-            printf("\nUsage: %s [-h] [-v] [-b </path/to/backup/>] \n\n"
+            printf("\nUsage: %s [-h] [-v] [-a] [-c <collector>] [-j <jobs>] [-t <secs>] [-T <secs>] [--if <glob>] [--type <type>] [--include <kind>] [--exclude <kind>] [-b </path/to/backup/>] \n\n"
                         "\t-h -- prints this usage\n"
 	                    "\t-v -- runs nsync in verbose mode\n"
                         "\t-a -- toggles the arping wait value off in config files (not useful for all OS)\n"
+                        "\t-c -- sets how the active config is collected: netlink (default), ip, ip-json or procfs\n"
+                        "\t-j -- sets how many external commands may run at once (default 8)\n"
+                        "\t-t -- sets how long a single command may run before it is stopped (default 10s)\n"
+                        "\t-T -- sets how long the whole run may take (default no limit)\n"
+                        "\t--if -- only syncs the interfaces whose names match the glob (may be repeated)\n"
+                        "\t--type -- only syncs interfaces of the type, e.g. ether, vlan or bond (may be repeated)\n"
+                        "\t--include -- syncs interfaces of a kind excluded by default: veth, tun, vxlan, geneve, or * for all\n"
+                        "\t--exclude -- never syncs interfaces of the kind, e.g. bridge (may be repeated)\n"
 	                    "\t-b -- sets backup location to the <path/to/backup> that follows\n\n", argv[0]);
             return 0;
         }
@@ -69,6 +140,7 @@ int main(int argc, char *argv[])
         }
     }
     
+    exec_set_budget(run_budget_ms);
     int ret_val = driver(nsync_info);
     if (ret_val == 0) free(nsync_info);
     return ret_val;
@@ -173,6 +245,20 @@ bool supported_os(net_sync_info_t *info, char *os)
     return false;
 }
 
+/**
+ * @brief Looks up the collector with the given name
+ * @param name the name of the collector as given on the command line
+ * @returns the collector, or INVALID_COLLECT if there is none with that name
+ */
+collect_enum_t collector_from_name(const char *name)
+{
+    for (int i = 0; i < NUM_COLLECT; i++) {
+        if (strncmp(name, collector_name[i], MAX_OS_LEN) == 0)
+            return i;
+    }
+    return INVALID_COLLECT;
+}
+
 /**
  * @brief Determines the OS of the system and checks that it is supported
  * @param info A struct containing all of the info related to the network configuration
@@ -180,18 +266,16 @@ bool supported_os(net_sync_info_t *info, char *os)
  */
 nsync_state_t check_OS(net_sync_info_t *info)
 {
-    if(info->verbose) system("clear;");
+    if(info->verbose) exec_argv((char *[]){ "clear", NULL }, NULL);
     
     char *os = calloc(MAX_OS_LEN, sizeof(char));
     MEM_CHECK(os, NSYNC_ERROR);
 
     /** Check for Centos */
     if (file_exists("/etc/centos-release")){
-        char cmd[MAX_CMD_LEN];
-        sprintf(cmd, "cat %s", "/etc/centos-release");
-        FILE *fp = popen(cmd, "r");
+        FILE *fp = fopen("/etc/centos-release", "r");
         if (fp == NULL){
-            sprintf(err_msg, "Could not run command: %s", cmd);
+            sprintf(err_msg, "Could not open file: %s", "/etc/centos-release");
             return NSYNC_ERROR;
         }
         
@@ -205,16 +289,14 @@ nsync_state_t check_OS(net_sync_info_t *info)
             os[strlen(os)] = '_';
             os[strlen(os)] = os_release[strlen(os_release)-1];
         }
-        pclose(fp);
+        fclose(fp);
 
     }
     /** Check for Ubuntu */
     else if (file_exists("/etc/lsb-release")){  
-        char cmd[MAX_CMD_LEN];
-        sprintf(cmd, "cat %s", "/etc/lsb-release");
-        FILE *fp = popen(cmd, "r");
+        FILE *fp = fopen("/etc/lsb-release", "r");
         if (fp == NULL){
-            sprintf(err_msg, "Could not run command: %s", cmd);
+            sprintf(err_msg, "Could not open file: %s", "/etc/lsb-release");
             return NSYNC_ERROR;
         }
         char distr_id[MAX_OS_LEN];
@@ -233,7 +315,7 @@ nsync_state_t check_OS(net_sync_info_t *info)
             sprintf(err_msg, "Could not parse lsb-release file");
             return NSYNC_ERROR;
         }
-        pclose(fp);
+        fclose(fp);
     }
     else {
         sprintf(err_msg, "unsupported OS");
@@ -248,8 +330,8 @@ nsync_state_t check_OS(net_sync_info_t *info)
     }
 
     /** If the OS is valid then set the commands, files, etc. for that OS */
-    info->cmd_list = os_cmd[info->sys.os];
-    info->parsers = os_parse[info->sys.os];
+    info->cmd_list = os_cmd[info->collector][info->sys.os];
+    info->parsers = os_parse[info->collector][info->sys.os];
     info->cfg_file_loc = cfg_locations[info->sys.os];
     info->cfg_file = ifcfg_if_file_fmt[info->sys.os];
     info->route_file = route_if_file_fmt[info->sys.os];
@@ -8,6 +8,7 @@
 #include "nsync_info.h"
 #include "nsync_centos.h"
 #include "nsync_ubuntu.h"
+#include "nsync_collect.h"
 #include "nsync_utils.h"
 
 extern char err_msg[ERR_LEN];
@@ -30,18 +31,50 @@ const char os_name[NUM_OS + 2][MAX_OS_LEN] =
 
 
 /**********************************************************************/
-/*                           PARSING                                  */
+/*                            COLLECTORS                              */
 /**********************************************************************/
-
-void *os_parse[NUM_OS] = 
+const char collector_name[NUM_COLLECT][MAX_OS_LEN] =
 {
-    [CENTOS_6]      =   &centos_parsers,
+    [COLLECT_NETLINK]   =   "netlink",
+    [COLLECT_IP]        =   "ip",
+    [COLLECT_IP_JSON]   =   "ip-json",
+    [COLLECT_PROCFS]    =   "procfs",
+};
 
-    [CENTOS_7]      =   &centos_parsers,
 
-    [CENTOS_8]      =   &centos_parsers,
+/**********************************************************************/
+/*                           PARSING                                  */
+/**********************************************************************/
 
-    [UBUNTU_1604]   =   &ubuntu_parsers,
+void *os_parse[NUM_COLLECT][NUM_OS] = 
+{
+    [COLLECT_NETLINK] = {
+        [CENTOS_6]      =   &centos_netlink_parsers,
+        [CENTOS_7]      =   &centos_netlink_parsers,
+        [CENTOS_8]      =   &centos_netlink_parsers,
+        [UBUNTU_1604]   =   &ubuntu_netlink_parsers,
+    },
+
+    [COLLECT_IP] = {
+        [CENTOS_6]      =   &centos_parsers,
+        [CENTOS_7]      =   &centos_parsers,
+        [CENTOS_8]      =   &centos_parsers,
+        [UBUNTU_1604]   =   &ubuntu_parsers,
+    },
+
+    [COLLECT_IP_JSON] = {
+        [CENTOS_6]      =   &centos_ipjson_parsers,
+        [CENTOS_7]      =   &centos_ipjson_parsers,
+        [CENTOS_8]      =   &centos_ipjson_parsers,
+        [UBUNTU_1604]   =   &ubuntu_ipjson_parsers,
+    },
+
+    [COLLECT_PROCFS] = {
+        [CENTOS_6]      =   &centos_procfs_parsers,
+        [CENTOS_7]      =   &centos_procfs_parsers,
+        [CENTOS_8]      =   &centos_procfs_parsers,
+        [UBUNTU_1604]   =   &ubuntu_procfs_parsers,
+    },
 };
 
 /**********************************************************************/
@@ -60,11 +93,34 @@ state_func_t *os_state_funcs[NUM_OS] =
 /**********************************************************************/
 /*                             COMMANDS                               */
 /**********************************************************************/
-cmd_list_t *os_cmd[NUM_OS] = {
-    [CENTOS_6]      =   &centos_cmd_list,
-    [CENTOS_7]      =   &centos_cmd_list,
-    [CENTOS_8]      =   &centos_cmd_list,
-    [UBUNTU_1604]   =   &ubuntu_cmd_list,
+cmd_list_t *os_cmd[NUM_COLLECT][NUM_OS] = {
+    [COLLECT_NETLINK] = {
+        [CENTOS_6]      =   &netlink_cmd_list,
+        [CENTOS_7]      =   &netlink_cmd_list,
+        [CENTOS_8]      =   &netlink_cmd_list,
+        [UBUNTU_1604]   =   &netlink_cmd_list,
+    },
+
+    [COLLECT_IP] = {
+        [CENTOS_6]      =   &centos_cmd_list,
+        [CENTOS_7]      =   &centos_cmd_list,
+        [CENTOS_8]      =   &centos_cmd_list,
+        [UBUNTU_1604]   =   &ubuntu_cmd_list,
+    },
+
+    [COLLECT_IP_JSON] = {
+        [CENTOS_6]      =   &ipjson_cmd_list,
+        [CENTOS_7]      =   &ipjson_cmd_list,
+        [CENTOS_8]      =   &ipjson_cmd_list,
+        [UBUNTU_1604]   =   &ipjson_cmd_list,
+    },
+
+    [COLLECT_PROCFS] = {
+        [CENTOS_6]      =   &procfs_cmd_list,
+        [CENTOS_7]      =   &procfs_cmd_list,
+        [CENTOS_8]      =   &procfs_cmd_list,
+        [UBUNTU_1604]   =   &procfs_cmd_list,
+    },
 };
 
 
@@ -126,3 +182,10 @@ nsync_state_t check_OS(net_sync_info_t *info);
  */
 bool supported_os(net_sync_info_t *info, char *os);
 
+/**
+ * @brief Looks up the collector with the given name
+ * @param name the name of the collector as given on the command line
+ * @returns the collector, or INVALID_COLLECT if there is none with that name
+ */
+collect_enum_t collector_from_name(const char *name);
+
@@ -14,13 +14,8 @@
 #define MAX_CMD_LEN FILENAME_MAX*2
 
 /** MACRO CONSTANTS */
-#define MAX_NUM_IF 255
-#define MAX_ROUTES 100
 #define MAX_IF_NAME 100
 
-#define MAX_NUM_IP 100
-#define MAX_NUM_GW 100
-#define MAX_NUM_NM 100
 
 extern char err_msg[ERR_LEN];
 
@@ -77,12 +72,25 @@ typedef enum {
     INVALID_OS,
 } os_enum_t;
 
+/**********************************************************************/
+/*                            COLLECTORS                              */
+/**********************************************************************/
+typedef enum {
+    COLLECT_NETLINK = 0,
+    COLLECT_IP,
+    COLLECT_IP_JSON,
+    COLLECT_PROCFS,
+    NUM_COLLECT,
+    INVALID_COLLECT,
+} collect_enum_t;
+
 /**********************************************************************/
 /*                             COMMANDS                               */
 /**********************************************************************/
 typedef struct command_list {
         char get_OS[MAX_CMD_LEN];
         char get_if_list[MAX_CMD_LEN];
+        char get_addrs[MAX_CMD_LEN];
         char get_active_if_cfg[MAX_CMD_LEN];
         char get_routes[MAX_CMD_LEN];
 } cmd_list_t;
@@ -98,6 +106,7 @@ struct net_sync_info {
         nsync_state_t os;
     } sys;
 
+    collect_enum_t collector;
     cmd_list_t *cmd_list;
 
     struct backup_data {
@@ -111,8 +120,10 @@ struct net_sync_info {
     bool verbose;
 
     void *net_config;
+    arena_t arena;          // holds everything parsed, released at once when done
+    intern_table_t strings; // names and values parsed, one copy of each, in the arena
 
-    bool synced[MAX_NUM_IF];
+    bitset_t synced;    // one bit per interface, sized when the configs are read
     int next_to_sync;
 
     void *parsers;
@@ -0,0 +1,407 @@
+/**
+ * @file nsync_ipjson.c
+ * Collector for hosts that keep using iproute2. Runs `ip -json -details`
+ * once each for links, addresses and routes and streams the output through
+ * the JSON reader into the shared snapshot, so the amount of output is not
+ * limited and only three processes are started regardless of the number
+ * of interfaces.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <arpa/inet.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
+#include "nsync_ipjson.h"
+
+/** Not exported by <net/if.h> */
+#ifndef IFF_LOWER_UP
+#define IFF_LOWER_UP 0x10000
+#endif
+#ifndef IFF_DORMANT
+#define IFF_DORMANT 0x20000
+#endif
+
+/** Names `ip` prints in the "flags" list of a link */
+static const struct {
+    const char *name;
+    unsigned int flag;
+} link_flag_names[] = {
+    { "UP",             IFF_UP },
+    { "BROADCAST",      IFF_BROADCAST },
+    { "DEBUG",          IFF_DEBUG },
+    { "LOOPBACK",       IFF_LOOPBACK },
+    { "POINTOPOINT",    IFF_POINTOPOINT },
+    { "NOTRAILERS",     IFF_NOTRAILERS },
+    { "RUNNING",        IFF_RUNNING },
+    { "NOARP",          IFF_NOARP },
+    { "PROMISC",        IFF_PROMISC },
+    { "ALLMULTI",       IFF_ALLMULTI },
+    { "MASTER",         IFF_MASTER },
+    { "SLAVE",          IFF_SLAVE },
+    { "MULTICAST",      IFF_MULTICAST },
+    { "PORTSEL",        IFF_PORTSEL },
+    { "AUTOMEDIA",      IFF_AUTOMEDIA },
+    { "DYNAMIC",        IFF_DYNAMIC },
+    { "LOWER_UP",       IFF_LOWER_UP },
+    { "DORMANT",        IFF_DORMANT },
+};
+
+/** Names `ip` prints for operational states, indexed by IF_OPER_* */
+static const char *operstate_names[] = {
+    "UNKNOWN", "NOTPRESENT", "DOWN", "LOWERLAYERDOWN", "TESTING", "DORMANT", "UP",
+};
+
+/**
+ * @brief Parses an address printed by `ip`, guessing the family from its form
+ * @param val the address
+ * @param dst 16 byte buffer for the address
+ * @returns AF_INET or AF_INET6, or 0 if val is not an address
+ */
+static unsigned char ipjson_parse_addr(const char *val, unsigned char *dst)
+{
+    unsigned char family = strchr(val, ':') ? AF_INET6 : AF_INET;
+    if (inet_pton(family, val, dst) != 1)
+        return 0;
+    return family;
+}
+
+/**
+ * @brief Parses the hardware address of a link. Tunnels print their
+ * endpoint as an IP address instead of colon separated bytes.
+ * @param link the link to store the address in
+ * @param val the address
+ */
+static void ipjson_parse_hwaddr(net_link_t *link, const char *val)
+{
+    unsigned char family = ipjson_parse_addr(val, link->hwaddr);
+    if (family) {
+        link->hwaddr_len = family == AF_INET ? 4 : 16;
+        return;
+    }
+
+    int len = 0;
+    const char *p = val;
+    while (len < MAX_HWADDR_LEN && isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1])) {
+        link->hwaddr[len++] = strtoul((char[3]){ p[0], p[1], '\0' }, NULL, 16);
+        p += 2;
+        if (*p != ':')
+            break;
+        p++;
+    }
+    link->hwaddr_len = len;
+}
+
+/**
+ * @brief Handles an event of the `ip -json link show` listing
+ *
+ * @param ctx the listing state
+ * @param ev the event
+ * @param val the text of the event, if any
+ * @param depth the depth the event happened at
+ * @returns false if memory could not be allocated
+ */
+static bool ipjson_link_event(ipjson_ctx_t *ctx, json_event_t ev, const char *val, int depth)
+{
+    if (ev == JSON_OBJ_START && depth == 2) {
+        ctx->link = snapshot_add_link(&net_snapshot);
+        return ctx->link != NULL;
+    }
+    if (!ctx->link || !val)
+        return true;
+
+    net_link_t *link = ctx->link;
+    const char *key = ctx->key[depth];
+
+    if (depth == 2) {
+        if (strcmp(key, "ifindex") == 0)
+            link->ifindex = atoi(val);
+        else if (strcmp(key, "ifname") == 0)
+            safe_strncpy(link->name, val, IF_NAMESIZE);
+        else if (strcmp(key, "mtu") == 0)
+            link->mtu = strtoul(val, NULL, 10);
+        else if (strcmp(key, "link_type") == 0)
+            link->type = snapshot_link_type_from_name(val);
+        else if (strcmp(key, "address") == 0)
+            ipjson_parse_hwaddr(link, val);
+        else if (strcmp(key, "operstate") == 0) {
+            for (size_t i = 0; i < sizeof(operstate_names) / sizeof(operstate_names[0]); i++) {
+                if (strcmp(operstate_names[i], val) == 0)
+                    link->operstate = i;
+            }
+        }
+    }
+    else if (depth == 3 && strcmp(ctx->key[2], "flags") == 0) {
+        /** `ip` reports a link that is up without carrier as NO-CARRIER */
+        if (strcmp(val, "NO-CARRIER") == 0)
+            link->carrier = 0;
+        for (size_t i = 0; i < sizeof(link_flag_names) / sizeof(link_flag_names[0]); i++) {
+            if (strcmp(link_flag_names[i].name, val) == 0)
+                link->flags |= link_flag_names[i].flag;
+        }
+    }
+    else if (depth == 3 && strcmp(ctx->key[2], "linkinfo") == 0 && strcmp(key, "info_kind") == 0)
+        safe_strncpy(link->kind, val, MAX_KIND_LEN);
+
+    return true;
+}
+
+/**
+ * @brief Handles an event of the `ip -json addr show` listing. Addresses
+ * are nested in the "addr_info" list of each interface.
+ *
+ * @param ctx the listing state
+ * @param ev the event
+ * @param val the text of the event, if any
+ * @param depth the depth the event happened at
+ * @returns false if memory could not be allocated
+ */
+static bool ipjson_addr_event(ipjson_ctx_t *ctx, json_event_t ev, const char *val, int depth)
+{
+    if (depth == 2 && val && strcmp(ctx->key[2], "ifindex") == 0) {
+        ctx->ifindex = atoi(val);
+        return true;
+    }
+    if (depth != 4 || strcmp(ctx->key[2], "addr_info") != 0)
+        return true;
+
+    if (ev == JSON_OBJ_START) {
+        ctx->addr = snapshot_add_addr(&net_snapshot);
+        if (!ctx->addr)
+            return false;
+        ctx->addr->ifindex = ctx->ifindex;
+        ctx->addr->flags = IFA_F_PERMANENT;
+        ctx->has_local = false;
+        return true;
+    }
+    if (ev == JSON_OBJ_END) {
+        /** drop entries of other families and ones without an address */
+        if (ctx->addr && (!ctx->addr->family || !ctx->has_local))
+            net_snapshot.num_addrs--;
+        ctx->addr = NULL;
+        return true;
+    }
+    if (!ctx->addr || !val)
+        return true;
+
+    net_addr_t *addr = ctx->addr;
+    const char *key = ctx->key[4];
+
+    if (strcmp(key, "family") == 0)
+        addr->family = strcmp(val, "inet") == 0 ? AF_INET : strcmp(val, "inet6") == 0 ? AF_INET6 : 0;
+    else if (strcmp(key, "local") == 0)
+        ctx->has_local = addr->family && inet_pton(addr->family, val, addr->addr) == 1;
+    else if (strcmp(key, "prefixlen") == 0)
+        addr->prefixlen = strtoul(val, NULL, 10);
+    else if (strcmp(key, "scope") == 0)
+        addr->scope = route_scope_from_name(val);
+    else if (strcmp(key, "broadcast") == 0)
+        addr->has_brd = addr->family && inet_pton(addr->family, val, addr->brd) == 1;
+    else if (strcmp(key, "valid_life_time") == 0)
+        addr->valid_lft = strtoul(val, NULL, 10);
+    else if (strcmp(key, "dynamic") == 0 && ev == JSON_TRUE)
+        addr->flags &= ~IFA_F_PERMANENT;
+    else if (strcmp(key, "secondary") == 0 && ev == JSON_TRUE)
+        addr->flags |= IFA_F_SECONDARY;
+
+    return true;
+}
+
+/**
+ * @brief Handles an event of the `ip -json route show` listing
+ *
+ * @param ctx the listing state
+ * @param ev the event
+ * @param val the text of the event, if any
+ * @param depth the depth the event happened at
+ * @returns false if memory could not be allocated
+ */
+static bool ipjson_route_event(ipjson_ctx_t *ctx, json_event_t ev, const char *val, int depth)
+{
+    if (ev == JSON_OBJ_START && depth == 2) {
+        ctx->rt = snapshot_add_route(&net_snapshot);
+        if (!ctx->rt)
+            return false;
+        ctx->rt->protocol = RTPROT_BOOT;
+        return true;
+    }
+    if (ev == JSON_OBJ_END && depth == 2 && ctx->rt) {
+        if (!ctx->rt->family)
+            ctx->rt->family = AF_INET;
+        ctx->rt = NULL;
+        return true;
+    }
+    if (!ctx->rt || !val)
+        return true;
+
+    net_route_t *rt = ctx->rt;
+    const char *key = ctx->key[depth];
+
+    if (depth == 3 && strcmp(ctx->key[2], "flags") == 0) {
+        if (strcmp(val, "onlink") == 0)
+            rt->flags |= RTNH_F_ONLINK;
+        else if (strcmp(val, "linkdown") == 0)
+            rt->flags |= RTNH_F_LINKDOWN;
+        else if (strcmp(val, "dead") == 0)
+            rt->flags |= RTNH_F_DEAD;
+        return true;
+    }
+    if (depth != 2)
+        return true;
+
+    if (strcmp(key, "type") == 0)
+        rt->type = route_type_from_name(val);
+    else if (strcmp(key, "dst") == 0) {
+        if (strcmp(val, "default") == 0)
+            return true;
+        char dst[INET6_ADDRSTRLEN + 4];
+        safe_strncpy(dst, val, sizeof(dst));
+        char *slash = strchr(dst, '/');
+        if (slash)
+            *slash = '\0';
+        rt->family = ipjson_parse_addr(dst, rt->dst);
+        rt->dst_len = slash ? strtoul(slash + 1, NULL, 10) : rt->family == AF_INET6 ? 128 : 32;
+    }
+    else if (strcmp(key, "gateway") == 0) {
+        unsigned char family = ipjson_parse_addr(val, rt->gw);
+        rt->has_gw = family != 0;
+        if (!rt->family)
+            rt->family = family;
+    }
+    else if (strcmp(key, "dev") == 0) {
+        const net_link_t *link = snapshot_find_link(&net_snapshot, val);
+        if (link)
+            rt->oif = link->ifindex;
+    }
+    else if (strcmp(key, "protocol") == 0)
+        rt->protocol = route_proto_from_name(val);
+    else if (strcmp(key, "scope") == 0)
+        rt->scope = route_scope_from_name(val);
+    else if (strcmp(key, "prefsrc") == 0)
+        rt->has_prefsrc = ipjson_parse_addr(val, rt->prefsrc) != 0;
+    else if (strcmp(key, "metric") == 0) {
+        rt->priority = strtoul(val, NULL, 10);
+        rt->has_priority = true;
+    }
+    else if (strcmp(key, "table") == 0) {
+        if (isdigit((unsigned char)val[0]))
+            rt->table = strtoul(val, NULL, 10);
+        else if (strcmp(val, "local") == 0)
+            rt->table = RT_TABLE_LOCAL;
+        else if (strcmp(val, "default") == 0)
+            rt->table = RT_TABLE_DEFAULT;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Receives every event of a listing, remembers the keys and hands
+ * values to the handler of the listing
+ * @returns false if the reader should stop
+ */
+static bool ipjson_handler(void *arg, json_event_t ev, const char *val, size_t len, int depth)
+{
+    (void) len;
+    ipjson_ctx_t *ctx = arg;
+
+    if (ev == JSON_KEY) {
+        safe_strncpy(ctx->key[depth], val, IPJSON_KEY_LEN);
+        return true;
+    }
+    if (ev == JSON_OBJ_START)
+        ctx->key[depth][0] = '\0';
+    if (ev == JSON_ARR_START && depth == 1)
+        ctx->seen = true;
+
+    switch (ctx->obj) {
+    case IPJSON_LINK:   return ipjson_link_event(ctx, ev, val, depth);
+    case IPJSON_ADDR:   return ipjson_addr_event(ctx, ev, val, depth);
+    case IPJSON_ROUTE:  return ipjson_route_event(ctx, ev, val, depth);
+    }
+    return true;
+}
+
+/**
+ * @brief Feeds a chunk of command output to the JSON reader
+ */
+static bool ipjson_feed(void *reader, const char *buf, size_t len)
+{
+    return json_feed(reader, buf, len);
+}
+
+/**
+ * @brief Runs a single `ip -json` command and streams its output into the
+ * snapshot
+ *
+ * @param cmd the command
+ * @param obj which listing the command prints
+ * @returns true on success, false otherwise (err_msg is set)
+ */
+static bool ipjson_run(const char *cmd, ipjson_obj_t obj)
+{
+    char *copy = strdup(cmd);
+    MEM_CHECK(copy, false);
+    char *argv[EXEC_MAX_ARGS];
+    if (split_cmd(copy, argv, EXEC_MAX_ARGS) <= 0) {
+        sprintf(err_msg, "invalid command: %s", cmd);
+        free(copy);
+        return false;
+    }
+
+    ipjson_ctx_t *ctx = calloc(1, sizeof(ipjson_ctx_t));
+    if (!ctx) {
+        sprintf(err_msg, "could not allocate memory");
+        free(copy);
+        return false;
+    }
+    ctx->obj = obj;
+
+    json_reader_t reader;
+    json_init(&reader, &ipjson_handler, ctx);
+
+    int status = exec_stream(argv, &ipjson_feed, &reader);
+    bool ok = status >= 0 && json_finish(&reader);
+    bool seen = ctx->seen;
+
+    json_free(&reader);
+    free(ctx);
+    free(copy);
+
+    if (!ok) {
+        char reason[ERR_LEN / 2];
+        safe_strncpy(reason, err_msg, sizeof(reason));
+        sprintf(err_msg, "Could not parse the output of %s: %s", cmd, reason);
+        return false;
+    }
+    if (status != 0 || !seen) {
+        sprintf(err_msg, "Command failed: %s", cmd);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Collects links, addresses and routes with one `ip -json` process
+ * each. Links are read and indexed first so routes can resolve their device.
+ *
+ * @param cmds the commands to run
+ * @returns true on success, false otherwise (err_msg is set)
+ */
+bool ipjson_collect(cmd_list_t *cmds)
+{
+    if (net_snapshot.collected)
+        return true;
+
+    if (!ipjson_run(cmds->get_if_list, IPJSON_LINK)
+        || !snapshot_index_links(&net_snapshot)
+        || !ipjson_run(cmds->get_addrs, IPJSON_ADDR)
+        || !ipjson_run(cmds->get_routes, IPJSON_ROUTE)
+        || !snapshot_select(&net_snapshot)) {
+        free_snapshot();
+        return false;
+    }
+
+    net_snapshot.collected = true;
+    return true;
+}
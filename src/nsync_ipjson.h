@@ -0,0 +1,55 @@
+/**
+ * @file nsync_ipjson.h
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_IPJSON_H
+#define NSYNC_IPJSON_H
+
+#include "nsync_collect.h"
+#include "nsync_json.h"
+
+/**********************************************************************/
+/*                             CONSTANTS                              */
+/**********************************************************************/
+#define IPJSON_KEY_LEN 64
+
+/**********************************************************************/
+/*                              ENUMS                                 */
+/**********************************************************************/
+/**
+ * @enum ipjson_obj_t
+ * @brief which `ip -json` listing is being read
+ */
+typedef enum {
+    IPJSON_LINK = 0,
+    IPJSON_ADDR,
+    IPJSON_ROUTE,
+} ipjson_obj_t;
+
+/**********************************************************************/
+/*                             STRUCTS                                */
+/**********************************************************************/
+/**
+ * @struct ipjson_ctx
+ * @brief state carried between the events of a single listing
+ */
+typedef struct ipjson_ctx {
+    ipjson_obj_t obj;
+    char key[MAX_JSON_DEPTH + 1][IPJSON_KEY_LEN];   // last key seen at each depth
+
+    net_link_t *link;
+    net_addr_t *addr;
+    net_route_t *rt;
+    int ifindex;                                    // interface of the current addr_info list
+    bool has_local;                                 // the current addr_info entry had an address
+    bool seen;                                      // the top level list was read
+} ipjson_ctx_t;
+
+/**********************************************************************/
+/*                             COLLECTOR                              */
+/**********************************************************************/
+
+bool ipjson_collect(cmd_list_t *cmds);
+
+#endif
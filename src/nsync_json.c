@@ -0,0 +1,280 @@
+/**
+ * @file nsync_json.c
+ * Incremental JSON tokenizer. Output is fed in chunks of any size as it is
+ * read and turned into a stream of events, so there is no limit on how much
+ * a command may print.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include "nsync_json.h"
+
+/**
+ * @brief Initializes a reader
+ * @param reader the reader
+ * @param handler the function called for every event
+ * @param ctx passed through to the handler
+ */
+void json_init(json_reader_t *reader, json_handler_t handler, void *ctx)
+{
+    memset(reader, 0, sizeof(json_reader_t));
+    reader->handler = handler;
+    reader->ctx = ctx;
+}
+
+/**
+ * @brief Appends a byte to the token currently being read
+ * @param reader the reader
+ * @param c the byte
+ * @returns false if memory could not be allocated
+ */
+static bool json_tok_push(json_reader_t *reader, char c)
+{
+    if (reader->tok_len + 1 >= reader->tok_cap) {
+        size_t new_cap = reader->tok_cap ? reader->tok_cap * 2 : 64;
+        char *grown = realloc(reader->tok, new_cap);
+        MEM_CHECK(grown, false);
+        reader->tok = grown;
+        reader->tok_cap = new_cap;
+    }
+    reader->tok[reader->tok_len++] = c;
+    reader->tok[reader->tok_len] = '\0';
+    return true;
+}
+
+/**
+ * @brief Appends a unicode code point to the token as UTF-8
+ * @param reader the reader
+ * @param cp the code point
+ * @returns false if memory could not be allocated
+ */
+static bool json_tok_push_utf8(json_reader_t *reader, unsigned int cp)
+{
+    if (cp < 0x80)
+        return json_tok_push(reader, cp);
+    if (cp < 0x800)
+        return json_tok_push(reader, 0xC0 | (cp >> 6))
+            && json_tok_push(reader, 0x80 | (cp & 0x3F));
+    return json_tok_push(reader, 0xE0 | (cp >> 12))
+        && json_tok_push(reader, 0x80 | ((cp >> 6) & 0x3F))
+        && json_tok_push(reader, 0x80 | (cp & 0x3F));
+}
+
+/**
+ * @brief Hands an event to the handler
+ * @param reader the reader
+ * @param ev the event
+ * @param val the text of the event, if any
+ * @param len the length of val
+ * @returns false if the handler asked to stop
+ */
+static bool json_emit(json_reader_t *reader, json_event_t ev, const char *val, size_t len)
+{
+    if (!reader->handler(reader->ctx, ev, val, len, reader->depth)) {
+        reader->failed = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Emits the literal (number, true, false, null) that just ended
+ * @param reader the reader
+ * @returns false on a malformed literal or if the handler asked to stop
+ */
+static bool json_end_literal(json_reader_t *reader)
+{
+    json_event_t ev;
+    const char *lit = reader->tok;
+
+    if (strcmp(lit, "true") == 0)
+        ev = JSON_TRUE;
+    else if (strcmp(lit, "false") == 0)
+        ev = JSON_FALSE;
+    else if (strcmp(lit, "null") == 0)
+        ev = JSON_NULL;
+    else if (lit[0] == '-' || isdigit((unsigned char)lit[0]))
+        ev = JSON_NUMBER;
+    else {
+        sprintf(err_msg, "malformed JSON literal: %.100s", lit);
+        return false;
+    }
+
+    reader->state = JSON_TOK_NONE;
+    return json_emit(reader, ev, reader->tok, reader->tok_len);
+}
+
+/**
+ * @brief Handles a structural character or the start of a token
+ * @param reader the reader
+ * @param c the character
+ * @returns false on malformed input or if the handler asked to stop
+ */
+static bool json_structural(json_reader_t *reader, char c)
+{
+    switch (c) {
+    case '{':
+    case '[':
+        if (reader->depth == MAX_JSON_DEPTH) {
+            sprintf(err_msg, "JSON nested too deeply");
+            return false;
+        }
+        reader->depth++;
+        reader->in_object[reader->depth] = (c == '{');
+        reader->expect_key = (c == '{');
+        return json_emit(reader, c == '{' ? JSON_OBJ_START : JSON_ARR_START, NULL, 0);
+
+    case '}':
+    case ']':
+        if (reader->depth == 0 || reader->in_object[reader->depth] != (c == '}')) {
+            sprintf(err_msg, "unbalanced JSON");
+            return false;
+        }
+        if (!json_emit(reader, c == '}' ? JSON_OBJ_END : JSON_ARR_END, NULL, 0))
+            return false;
+        reader->depth--;
+        reader->expect_key = false;
+        return true;
+
+    case ',':
+        reader->expect_key = reader->in_object[reader->depth];
+        return true;
+
+    case ':':
+        reader->expect_key = false;
+        return true;
+
+    case '"':
+        // push and drop a byte so an empty string still has a buffer
+        reader->state = JSON_TOK_STRING;
+        reader->tok_len = 0;
+        if (!json_tok_push(reader, '\0'))
+            return false;
+        reader->tok_len = 0;
+        return true;
+
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+        return true;
+
+    default:
+        reader->state = JSON_TOK_LITERAL;
+        reader->tok_len = 0;
+        return json_tok_push(reader, c);
+    }
+}
+
+/**
+ * @brief Feeds the next chunk of input to the reader. Tokens may be split
+ * across chunks at any byte.
+ *
+ * @param reader the reader
+ * @param buf the chunk
+ * @param len the length of the chunk
+ * @returns true on success, false on malformed input (err_msg is set) or
+ * if the handler asked to stop
+ */
+bool json_feed(json_reader_t *reader, const char *buf, size_t len)
+{
+    if (reader->failed)
+        return false;
+
+    for (size_t i = 0; i < len; i++) {
+        char c = buf[i];
+        bool ok = true;
+
+        switch (reader->state) {
+        case JSON_TOK_STRING:
+            if (c == '\\')
+                reader->state = JSON_TOK_ESCAPE;
+            else if (c == '"') {
+                reader->state = JSON_TOK_NONE;
+                ok = json_emit(reader, reader->expect_key ? JSON_KEY : JSON_STRING, reader->tok, reader->tok_len);
+            }
+            else
+                ok = json_tok_push(reader, c);
+            break;
+
+        case JSON_TOK_ESCAPE:
+            reader->state = JSON_TOK_STRING;
+            switch (c) {
+            case 'n': ok = json_tok_push(reader, '\n'); break;
+            case 't': ok = json_tok_push(reader, '\t'); break;
+            case 'r': ok = json_tok_push(reader, '\r'); break;
+            case 'b': ok = json_tok_push(reader, '\b'); break;
+            case 'f': ok = json_tok_push(reader, '\f'); break;
+            case 'u':
+                reader->state = JSON_TOK_UNICODE;
+                reader->unicode = 0;
+                reader->unicode_digits = 0;
+                break;
+            default:  ok = json_tok_push(reader, c); break;
+            }
+            break;
+
+        case JSON_TOK_UNICODE:
+            if (!isxdigit((unsigned char)c)) {
+                sprintf(err_msg, "malformed JSON unicode escape");
+                ok = false;
+                break;
+            }
+            reader->unicode = reader->unicode * 16 + (isdigit((unsigned char)c) ? c - '0' : (tolower((unsigned char)c) - 'a' + 10));
+            if (++reader->unicode_digits == 4) {
+                reader->state = JSON_TOK_STRING;
+                ok = json_tok_push_utf8(reader, reader->unicode);
+            }
+            break;
+
+        case JSON_TOK_LITERAL:
+            if (isalnum((unsigned char)c) || c == '.' || c == '-' || c == '+') {
+                ok = json_tok_push(reader, c);
+                break;
+            }
+            ok = json_end_literal(reader) && json_structural(reader, c);
+            break;
+
+        case JSON_TOK_NONE:
+            ok = json_structural(reader, c);
+            break;
+        }
+
+        if (!ok) {
+            reader->failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Signals the end of the input
+ * @param reader the reader
+ * @returns true if the input was a complete JSON document
+ */
+bool json_finish(json_reader_t *reader)
+{
+    if (reader->failed)
+        return false;
+
+    if (reader->state == JSON_TOK_LITERAL && !json_end_literal(reader))
+        return false;
+
+    if (reader->state != JSON_TOK_NONE || reader->depth != 0) {
+        sprintf(err_msg, "truncated JSON");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Frees the buffers held by a reader
+ * @param reader the reader
+ */
+void json_free(json_reader_t *reader)
+{
+    free(reader->tok);
+    reader->tok = NULL;
+    reader->tok_cap = reader->tok_len = 0;
+}
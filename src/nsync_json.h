@@ -0,0 +1,95 @@
+/**
+ * @file nsync_json.h
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_JSON_H
+#define NSYNC_JSON_H
+
+#include "nsync_utils.h"
+
+/** GLOBAL ERROR BUFFER */
+extern char err_msg[ERR_LEN];
+
+/**********************************************************************/
+/*                             CONSTANTS                              */
+/**********************************************************************/
+#define MAX_JSON_DEPTH 32
+
+/**********************************************************************/
+/*                              ENUMS                                 */
+/**********************************************************************/
+/**
+ * @enum json_event_t
+ * @brief the events emitted by the streaming reader
+ */
+typedef enum {
+    JSON_OBJ_START = 0,
+    JSON_OBJ_END,
+    JSON_ARR_START,
+    JSON_ARR_END,
+    JSON_KEY,
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL,
+} json_event_t;
+
+/**
+ * @enum json_tok_state_t
+ * @brief what the reader is in the middle of when a chunk ends
+ */
+typedef enum {
+    JSON_TOK_NONE = 0,
+    JSON_TOK_STRING,
+    JSON_TOK_ESCAPE,
+    JSON_TOK_UNICODE,
+    JSON_TOK_LITERAL,
+} json_tok_state_t;
+
+/**********************************************************************/
+/*                             STRUCTS                                */
+/**********************************************************************/
+/**
+ * Called for every event. val/len hold the text of keys, strings, numbers
+ * and literals (NUL-terminated) and are NULL/0 otherwise. depth is the depth
+ * of the enclosing container, or of the new container for start/end events
+ * (the outermost container has depth 1). Returning false stops the reader.
+ */
+typedef bool (*json_handler_t)(void *ctx, json_event_t ev, const char *val, size_t len, int depth);
+
+/**
+ * @struct json_reader
+ * @brief an incremental JSON tokenizer that can be fed arbitrary chunks
+ */
+typedef struct json_reader {
+    json_handler_t handler;
+    void *ctx;
+
+    json_tok_state_t state;
+    char *tok;
+    size_t tok_len;
+    size_t tok_cap;
+    unsigned int unicode;
+    int unicode_digits;
+
+    int depth;
+    bool in_object[MAX_JSON_DEPTH + 1];
+    bool expect_key;
+    bool failed;
+} json_reader_t;
+
+/**********************************************************************/
+/*                            FUNCTIONS                               */
+/**********************************************************************/
+
+void json_init(json_reader_t *reader, json_handler_t handler, void *ctx);
+
+bool json_feed(json_reader_t *reader, const char *buf, size_t len);
+
+bool json_finish(json_reader_t *reader);
+
+void json_free(json_reader_t *reader);
+
+#endif
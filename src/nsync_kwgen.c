@@ -0,0 +1,274 @@
+/**
+ * @file nsync_kwgen.c
+ * Build-time generator for the parsers' keyword tables. Reads the keyword
+ * list (nsync_keywords.def) and prints a header with one collision-free
+ * hash table and lookup function per table.
+ *
+ *   nsync_kwgen nsync_keywords.def > nsync_keywords.h
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include "nsync_kwhash.h"
+
+#define KW_MAX_TABLES 16
+#define KW_MAX_KEYS 128
+#define KW_MAX_LEN 64
+#define KW_MAX_SLOTS 4096
+#define KW_MAX_SEEDS 1000000
+#define KW_LINE_LEN 512
+
+/**
+ * @struct kw_table
+ * @brief one table of the keyword list and the hash found for it
+ */
+typedef struct kw_table {
+    char prefix[KW_MAX_LEN];
+    char type[KW_MAX_LEN];
+    char def[KW_MAX_LEN];
+    bool gen_enum;
+    int num_keys;
+    char keys[KW_MAX_KEYS][KW_MAX_LEN];
+    char values[KW_MAX_KEYS][KW_MAX_LEN];
+
+    uint32_t seed;
+    int num_slots;
+    int slots[KW_MAX_SLOTS];        // key index, -1 for empty
+} kw_table_t;
+
+static kw_table_t tables[KW_MAX_TABLES];
+static int num_tables = 0;
+
+/**
+ * @brief Reads the next word of a line, which may be double-quoted
+ * @param pos the position in the line, advanced past the word
+ * @param word receives the word
+ * @returns false if the line has no more words
+ */
+static bool next_word(char **pos, char word[KW_MAX_LEN])
+{
+    char *p = *pos;
+    while (isspace((unsigned char)*p))
+        p++;
+    if (*p == '\0')
+        return false;
+
+    size_t n = 0;
+    if (*p == '"') {
+        p++;
+        while (*p && *p != '"' && n < KW_MAX_LEN - 1)
+            word[n++] = *p++;
+        if (*p == '"')
+            p++;
+    } else {
+        while (*p && !isspace((unsigned char)*p) && n < KW_MAX_LEN - 1)
+            word[n++] = *p++;
+    }
+    word[n] = '\0';
+    *pos = p;
+    return true;
+}
+
+/**
+ * @brief Reads the keyword list
+ * @param path the keyword list
+ * @returns true on success
+ */
+static bool read_def(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "nsync_kwgen: could not open %s\n", path);
+        return false;
+    }
+
+    char line[KW_LINE_LEN];
+    int line_num = 0;
+    kw_table_t *table = NULL;
+    while (fgets(line, KW_LINE_LEN, fp)) {
+        line_num++;
+        char *pos = line;
+        char word[KW_MAX_LEN];
+        if (!next_word(&pos, word) || line[strspn(line, " \t")] == '#')
+            continue;
+
+        /** A quoted word is always a keyword, even "table" or "enum" */
+        bool quoted = line[strspn(line, " \t")] == '"';
+        if (!quoted && (strcmp(word, "table") == 0 || strcmp(word, "enum") == 0)) {
+            if (num_tables == KW_MAX_TABLES) {
+                fprintf(stderr, "nsync_kwgen: %s:%d: too many tables\n", path, line_num);
+                fclose(fp);
+                return false;
+            }
+            table = &tables[num_tables++];
+            table->gen_enum = strcmp(word, "enum") == 0;
+            if (!next_word(&pos, table->prefix) || !next_word(&pos, table->type) ||
+                !next_word(&pos, table->def)) {
+                fprintf(stderr, "nsync_kwgen: %s:%d: expected %s <prefix> <type> <default>\n",
+                        path, line_num, word);
+                fclose(fp);
+                return false;
+            }
+            continue;
+        }
+
+        if (!table || table->num_keys == KW_MAX_KEYS) {
+            fprintf(stderr, "nsync_kwgen: %s:%d: keyword outside of a table or table full\n", path, line_num);
+            fclose(fp);
+            return false;
+        }
+        int k = table->num_keys;
+        strcpy(table->keys[k], word);
+        if (!next_word(&pos, table->values[k])) {
+            fprintf(stderr, "nsync_kwgen: %s:%d: keyword %s has no value\n", path, line_num, word);
+            fclose(fp);
+            return false;
+        }
+        for (int i = 0; i < k; i++) {
+            if (strcmp(table->keys[i], word) == 0) {
+                fprintf(stderr, "nsync_kwgen: %s:%d: duplicate keyword %s\n", path, line_num, word);
+                fclose(fp);
+                return false;
+            }
+        }
+        table->num_keys++;
+    }
+    fclose(fp);
+    return true;
+}
+
+/**
+ * @brief Searches for a table size and seed under which no two keywords
+ * share a slot. Starts at twice the number of keywords, rounded up to a
+ * power of two, and doubles the size whenever no seed is found.
+ * @param table the table
+ * @returns true if a perfect hash was found
+ */
+static bool find_perfect_hash(kw_table_t *table)
+{
+    int num_slots = 8;
+    while (num_slots < 2 * table->num_keys)
+        num_slots *= 2;
+
+    for (; num_slots <= KW_MAX_SLOTS; num_slots *= 2) {
+        for (uint32_t seed = 1; seed < KW_MAX_SEEDS; seed++) {
+            bool collision = false;
+            for (int i = 0; i < num_slots; i++)
+                table->slots[i] = -1;
+
+            for (int k = 0; k < table->num_keys && !collision; k++) {
+                const char *key = table->keys[k];
+                uint32_t slot = kw_hash(key, strlen(key), seed) & (num_slots - 1);
+                collision = table->slots[slot] >= 0;
+                table->slots[slot] = k;
+            }
+            if (!collision) {
+                table->seed = seed;
+                table->num_slots = num_slots;
+                return true;
+            }
+        }
+    }
+    fprintf(stderr, "nsync_kwgen: no perfect hash for table %s\n", table->prefix);
+    return false;
+}
+
+/**
+ * @brief Prints a keyword as a C string literal
+ * @param key the keyword
+ */
+static void print_literal(const char *key)
+{
+    putchar('"');
+    for (const char *c = key; *c; c++) {
+        if (*c == '"' || *c == '\\')
+            putchar('\\');
+        putchar(*c);
+    }
+    putchar('"');
+}
+
+/**
+ * @brief Prints the enum of a table whose values are generated, in order
+ * of first use with the default first
+ * @param table the table
+ */
+static void print_enum(const kw_table_t *table)
+{
+    printf("typedef enum {\n    %s = 0,\n", table->def);
+    for (int k = 0; k < table->num_keys; k++) {
+        bool seen = false;
+        for (int i = 0; i < k && !seen; i++)
+            seen = strcmp(table->values[i], table->values[k]) == 0;
+        if (!seen)
+            printf("    %s,\n", table->values[k]);
+    }
+    printf("} %s;\n\n", table->type);
+}
+
+/**
+ * @brief Prints the lookup function of a table, with the table itself
+ * as a static local so units that do not use it carry no copy
+ * @param table the table
+ */
+static void print_lookup(const kw_table_t *table)
+{
+    printf("/**\n"
+           " * @brief Looks up a keyword of the %s table\n"
+           " * @param str the word, not necessarily NUL-terminated\n"
+           " * @param len length of the word\n"
+           " * @returns the keyword's value, or %s\n"
+           " */\n", table->prefix, table->def);
+    printf("static inline %s %s_lookup(const char *str, size_t len)\n{\n", table->type, table->prefix);
+    printf("    static const kw_entry_t table[%d] = {\n", table->num_slots);
+    for (int i = 0; i < table->num_slots; i++) {
+        int k = table->slots[i];
+        if (k < 0)
+            continue;
+        printf("        [%d] = { ", i);
+        print_literal(table->keys[k]);
+        printf(", %zu, %s },\n", strlen(table->keys[k]), table->values[k]);
+    }
+    printf("    };\n");
+    printf("    const kw_entry_t *e = &table[kw_hash(str, len, %uu) & %d];\n",
+           table->seed, table->num_slots - 1);
+    printf("    if (e->str && e->len == len && memcmp(e->str, str, len) == 0)\n");
+    printf("        return (%s)e->value;\n", table->type);
+    printf("    return %s;\n}\n\n", table->def);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <keywords.def>\n", argv[0]);
+        return 1;
+    }
+    if (!read_def(argv[1]))
+        return 1;
+    for (int t = 0; t < num_tables; t++) {
+        if (!find_perfect_hash(&tables[t]))
+            return 1;
+    }
+
+    printf("/**\n"
+           " * @file nsync_keywords.h\n"
+           " * Generated by nsync_kwgen from %s -- do not edit.\n"
+           " */\n\n"
+           "#ifndef NSYNC_KEYWORDS_H\n"
+           "#define NSYNC_KEYWORDS_H\n\n"
+           "#include <string.h>\n"
+           "#include \"nsync_kwhash.h\"\n\n", argv[1]);
+
+    for (int t = 0; t < num_tables; t++) {
+        if (tables[t].gen_enum)
+            print_enum(&tables[t]);
+        print_lookup(&tables[t]);
+    }
+    printf("#endif\n");
+    return 0;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file nsync_kwhash.h
+ * The hash shared by nsync_kwgen and the keyword tables it generates. Both
+ * sides must hash a keyword the same way, so it lives only here.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_KWHASH_H
+#define NSYNC_KWHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct kw_entry
+ * @brief one slot of a generated keyword table, empty slots have no str
+ */
+typedef struct kw_entry {
+    const char *str;
+    size_t len;
+    int value;
+} kw_entry_t;
+
+/**
+ * @brief Seeded FNV-1a over a keyword. The generator searches for a seed
+ * under which every keyword of a table lands in its own slot.
+ * @param str the keyword, not necessarily NUL-terminated
+ * @param len length of the keyword
+ * @param seed the table's seed
+ * @returns the hash, reduced to a slot by masking
+ */
+static inline uint32_t kw_hash(const char *str, size_t len, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)str[i]) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+#endif
@@ -0,0 +1,438 @@
+/**
+ * @file nsync_netlink.c
+ * Native NETLINK_ROUTE collector. Dumps links, addresses and routes over a
+ * single socket and stores them in the shared snapshot, replacing the
+ * `ip link` / `ip addr show` / `ip route` command pipeline.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <linux/if_addr.h>
+#include "nsync_netlink.h"
+
+/** Large enough for any message the kernel sends in a dump */
+#define NL_RECV_BUF_LEN 32768
+
+/** Times a dump is run before a system that keeps changing is given up on */
+#define NL_DUMP_TRIES 3
+
+/** Retries get sequence numbers of their own, clear of the other dumps */
+#define NL_DUMP_SEQ_STRIDE 16
+
+/**
+ * @struct nl_request
+ * @brief a dump request: the netlink header followed by the family header
+ */
+typedef struct nl_request {
+    struct nlmsghdr hdr;
+    union {
+        struct ifinfomsg ifi;
+        struct ifaddrmsg ifa;
+        struct rtmsg rtm;
+    } body;
+} nl_request_t;
+
+/**
+ * @brief Splits a run of route attributes into a table indexed by type
+ *
+ * @param tb the table, with room for max+1 entries
+ * @param max the highest attribute type of interest
+ * @param rta the first attribute
+ * @param len the number of bytes of attributes
+ */
+static void nl_parse_attrs(struct rtattr **tb, int max, struct rtattr *rta, int len)
+{
+    memset(tb, 0, sizeof(struct rtattr *) * (max + 1));
+    for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        unsigned short type = rta->rta_type & ~NLA_F_NESTED;
+        if (type <= max && !tb[type])
+            tb[type] = rta;
+    }
+}
+
+/**
+ * @brief Copies an address attribute into a fixed 16 byte buffer
+ * @param dst the buffer
+ * @param rta the attribute
+ */
+static void nl_copy_addr(unsigned char *dst, const struct rtattr *rta)
+{
+    size_t len = RTA_PAYLOAD(rta);
+    memcpy(dst, RTA_DATA(rta), len < 16 ? len : 16);
+}
+
+/**
+ * @brief Stores a RTM_NEWLINK message in the snapshot
+ * @param snap the snapshot
+ * @param nlh the message
+ * @returns true on success, false if memory could not be allocated
+ */
+static bool nl_store_link(net_snapshot_t *snap, struct nlmsghdr *nlh)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    struct rtattr *tb[IFLA_MAX + 1];
+    nl_parse_attrs(tb, IFLA_MAX, IFLA_RTA(ifi), IFLA_PAYLOAD(nlh));
+
+    if (!tb[IFLA_IFNAME] || !if_name_selected(RTA_DATA(tb[IFLA_IFNAME])))
+        return true;
+
+    net_link_t *link = snapshot_add_link(snap);
+    if (!link) return false;
+
+    link->ifindex = ifi->ifi_index;
+    link->flags = ifi->ifi_flags;
+    link->type = ifi->ifi_type;
+    safe_strncpy(link->name, RTA_DATA(tb[IFLA_IFNAME]), IF_NAMESIZE);
+
+    if (tb[IFLA_MTU])
+        link->mtu = *(unsigned int *)RTA_DATA(tb[IFLA_MTU]);
+    if (tb[IFLA_OPERSTATE])
+        link->operstate = *(unsigned char *)RTA_DATA(tb[IFLA_OPERSTATE]);
+    if (tb[IFLA_CARRIER])
+        link->carrier = *(unsigned char *)RTA_DATA(tb[IFLA_CARRIER]);
+    if (tb[IFLA_ADDRESS]) {
+        int len = RTA_PAYLOAD(tb[IFLA_ADDRESS]);
+        link->hwaddr_len = len < MAX_HWADDR_LEN ? len : MAX_HWADDR_LEN;
+        memcpy(link->hwaddr, RTA_DATA(tb[IFLA_ADDRESS]), link->hwaddr_len);
+    }
+    if (tb[IFLA_LINKINFO]) {
+        struct rtattr *info[IFLA_INFO_MAX + 1];
+        nl_parse_attrs(info, IFLA_INFO_MAX, RTA_DATA(tb[IFLA_LINKINFO]), RTA_PAYLOAD(tb[IFLA_LINKINFO]));
+        if (info[IFLA_INFO_KIND])
+            safe_strncpy(link->kind, RTA_DATA(info[IFLA_INFO_KIND]), MAX_KIND_LEN);
+    }
+
+    /** drop excluded kinds right away, there can be thousands of them */
+    if (!snapshot_link_selected(link)) {
+        snap->num_links--;
+        return if_withhold(link->name);
+    }
+    return true;
+}
+
+/**
+ * @brief Stores a RTM_NEWADDR message in the snapshot
+ * @param snap the snapshot
+ * @param nlh the message
+ * @returns true on success, false if memory could not be allocated
+ */
+static bool nl_store_addr(net_snapshot_t *snap, struct nlmsghdr *nlh)
+{
+    struct ifaddrmsg *ifa = NLMSG_DATA(nlh);
+    struct rtattr *tb[IFA_MAX + 1];
+    nl_parse_attrs(tb, IFA_MAX, IFA_RTA(ifa), IFA_PAYLOAD(nlh));
+
+    if (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)
+        return true;
+
+    /** IFA_LOCAL is the address itself, IFA_ADDRESS the peer on ptp links */
+    struct rtattr *local = tb[IFA_LOCAL] ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+    if (!local)
+        return true;
+
+    net_addr_t *addr = snapshot_add_addr(snap);
+    if (!addr) return false;
+
+    addr->ifindex = ifa->ifa_index;
+    addr->family = ifa->ifa_family;
+    addr->prefixlen = ifa->ifa_prefixlen;
+    addr->scope = ifa->ifa_scope;
+    addr->flags = tb[IFA_FLAGS] ? *(unsigned int *)RTA_DATA(tb[IFA_FLAGS]) : ifa->ifa_flags;
+    nl_copy_addr(addr->addr, local);
+
+    if (tb[IFA_BROADCAST]) {
+        nl_copy_addr(addr->brd, tb[IFA_BROADCAST]);
+        addr->has_brd = true;
+    }
+    if (tb[IFA_CACHEINFO]) {
+        struct ifa_cacheinfo *ci = RTA_DATA(tb[IFA_CACHEINFO]);
+        addr->valid_lft = ci->ifa_valid;
+    }
+    return true;
+}
+
+/**
+ * @brief Stores a RTM_NEWROUTE message in the snapshot. Only routes of the
+ * main table are kept, matching the output of `ip route`.
+ * @param snap the snapshot
+ * @param nlh the message
+ * @returns true on success, false if memory could not be allocated
+ */
+static bool nl_store_route(net_snapshot_t *snap, struct nlmsghdr *nlh)
+{
+    struct rtmsg *rtm = NLMSG_DATA(nlh);
+    struct rtattr *tb[RTA_MAX + 1];
+    nl_parse_attrs(tb, RTA_MAX, RTM_RTA(rtm), RTM_PAYLOAD(nlh));
+
+    unsigned int table = tb[RTA_TABLE] ? *(unsigned int *)RTA_DATA(tb[RTA_TABLE]) : rtm->rtm_table;
+    if (table != RT_TABLE_MAIN || (rtm->rtm_flags & RTM_F_CLONED))
+        return true;
+
+    net_route_t *rt = snapshot_add_route(snap);
+    if (!rt) return false;
+
+    rt->family = rtm->rtm_family;
+    rt->dst_len = rtm->rtm_dst_len;
+    rt->protocol = rtm->rtm_protocol;
+    rt->scope = rtm->rtm_scope;
+    rt->type = rtm->rtm_type;
+    rt->flags = rtm->rtm_flags;
+    rt->table = table;
+
+    if (tb[RTA_DST])
+        nl_copy_addr(rt->dst, tb[RTA_DST]);
+    if (tb[RTA_GATEWAY]) {
+        nl_copy_addr(rt->gw, tb[RTA_GATEWAY]);
+        rt->has_gw = true;
+    }
+    if (tb[RTA_PREFSRC]) {
+        nl_copy_addr(rt->prefsrc, tb[RTA_PREFSRC]);
+        rt->has_prefsrc = true;
+    }
+    if (tb[RTA_OIF])
+        rt->oif = *(int *)RTA_DATA(tb[RTA_OIF]);
+    if (tb[RTA_PRIORITY]) {
+        rt->priority = *(unsigned int *)RTA_DATA(tb[RTA_PRIORITY]);
+        rt->has_priority = true;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends a dump request and stores every reply in the snapshot
+ *
+ * @param snap the snapshot
+ * @param fd the netlink socket
+ * @param type RTM_GETLINK, RTM_GETADDR or RTM_GETROUTE
+ * @param family the address family to dump
+ * @param seq the sequence number of the request
+ * @param buf the receive buffer
+ * @param intr set if the kernel flagged the dump as interrupted by a change
+ * made while it ran; the dump is read to its end regardless
+ * @returns true on success, false on error (err_msg is set)
+ */
+static bool nl_dump_once(net_snapshot_t *snap, int fd, unsigned short type, unsigned char family,
+                         unsigned int seq, char *buf, bool *intr)
+{
+    nl_request_t req;
+    memset(&req, 0, sizeof(req));
+    req.hdr.nlmsg_type = type;
+    req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.hdr.nlmsg_seq = seq;
+
+    switch (type) {
+    case RTM_GETLINK:
+        req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+        req.body.ifi.ifi_family = family;
+        break;
+    case RTM_GETADDR:
+        req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+        req.body.ifa.ifa_family = family;
+        break;
+    default:
+        req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+        req.body.rtm.rtm_family = family;
+        break;
+    }
+
+    if (send(fd, &req, req.hdr.nlmsg_len, 0) < 0) {
+        sprintf(err_msg, "netlink request failed: %s", strerror(errno));
+        return false;
+    }
+
+    *intr = false;
+    while (true) {
+        struct iovec iov = { buf, NL_RECV_BUF_LEN };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        ssize_t len = recvmsg(fd, &msg, 0);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                sprintf(err_msg, "netlink dump timed out");
+                return false;
+            }
+            sprintf(err_msg, "netlink receive failed: %s", strerror(errno));
+            return false;
+        }
+
+        /** The dump ends with NLMSG_DONE, anything else is a partial snapshot */
+        if (len == 0) {
+            sprintf(err_msg, "netlink socket closed before the dump ended");
+            return false;
+        }
+        if (msg.msg_flags & MSG_TRUNC) {
+            sprintf(err_msg, "netlink message truncated");
+            return false;
+        }
+
+        struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+        for (; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_seq != seq)
+                continue;
+
+            if (nlh->nlmsg_flags & NLM_F_DUMP_INTR)
+                *intr = true;
+
+            if (nlh->nlmsg_type == NLMSG_DONE)
+                return true;
+
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                struct nlmsgerr *err = NLMSG_DATA(nlh);
+                sprintf(err_msg, "netlink dump failed: %s", strerror(-err->error));
+                return false;
+            }
+
+            bool stored = true;
+            switch (nlh->nlmsg_type) {
+            case RTM_NEWLINK:   stored = nl_store_link(snap, nlh);     break;
+            case RTM_NEWADDR:   stored = nl_store_addr(snap, nlh);     break;
+            case RTM_NEWROUTE:  stored = nl_store_route(snap, nlh);    break;
+            default: break;
+            }
+            if (!stored) return false;
+        }
+    }
+}
+
+/**
+ * @brief Dumps one object type into the snapshot. A dump the kernel flags
+ * as interrupted may be missing objects, so its results are dropped and it
+ * is run again.
+ *
+ * @param snap the snapshot
+ * @param fd the netlink socket
+ * @param type RTM_GETLINK, RTM_GETADDR or RTM_GETROUTE
+ * @param family the address family to dump
+ * @param seq the sequence number of the first request
+ * @param buf the receive buffer
+ * @returns true on success, false on error (err_msg is set)
+ */
+static bool nl_dump(net_snapshot_t *snap, int fd, unsigned short type, unsigned char family, unsigned int seq, char *buf)
+{
+    int num_links = snap->num_links;
+    int num_addrs = snap->num_addrs;
+    int num_routes = snap->num_routes;
+
+    for (int try = 0; try < NL_DUMP_TRIES; try++) {
+        bool intr;
+        if (!nl_dump_once(snap, fd, type, family, seq + try * NL_DUMP_SEQ_STRIDE, buf, &intr))
+            return false;
+        if (!intr)
+            return true;
+
+        snap->num_links = num_links;
+        snap->num_addrs = num_addrs;
+        snap->num_routes = num_routes;
+    }
+
+    sprintf(err_msg, "netlink dump kept being interrupted by changes");
+    return false;
+}
+
+/**
+ * @brief Opens and binds a NETLINK_ROUTE socket
+ * @returns the socket, or -1 on error (err_msg is set)
+ */
+static int nl_open(void)
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        sprintf(err_msg, "could not open netlink socket: %s", strerror(errno));
+        return -1;
+    }
+
+    /** Bound each receive like an external command */
+    int left = exec_time_left();
+    if (left >= 0) {
+        struct timeval tv = { left / 1000, (left % 1000) * 1000 };
+        if (!left)
+            tv.tv_usec = 1;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    struct sockaddr_nl local;
+    memset(&local, 0, sizeof(local));
+    local.nl_family = AF_NETLINK;
+    if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        sprintf(err_msg, "could not bind netlink socket: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Collects all links, addresses and routes of the system with one
+ * netlink socket and stores them in the shared snapshot
+ *
+ * @param cmds unused, the dumps are fixed
+ * @returns true on success, false on error (err_msg is set)
+ */
+bool netlink_collect(cmd_list_t *cmds)
+{
+    (void) cmds;
+
+    if (net_snapshot.collected)
+        return true;
+
+    int fd = nl_open();
+    if (fd < 0)
+        return false;
+
+    char *buf = malloc(NL_RECV_BUF_LEN);
+    if (!buf) {
+        sprintf(err_msg, "could not allocate memory");
+        close(fd);
+        return false;
+    }
+
+    bool ok = nl_dump(&net_snapshot, fd, RTM_GETLINK, AF_UNSPEC, 1, buf)
+           && nl_dump(&net_snapshot, fd, RTM_GETADDR, AF_UNSPEC, 2, buf)
+           && nl_dump(&net_snapshot, fd, RTM_GETROUTE, AF_INET, 3, buf);
+
+    free(buf);
+    close(fd);
+
+    ok = ok && snapshot_select(&net_snapshot);
+    net_snapshot.collected = ok;
+    return ok;
+}
+
+/**
+ * @brief Collects only the links, with a single dump
+ *
+ * @param snap the snapshot to store the links in
+ * @returns true on success, false on error (err_msg is set)
+ */
+bool netlink_collect_links(net_snapshot_t *snap)
+{
+    int fd = nl_open();
+    if (fd < 0)
+        return false;
+
+    char *buf = malloc(NL_RECV_BUF_LEN);
+    if (!buf) {
+        sprintf(err_msg, "could not allocate memory");
+        close(fd);
+        return false;
+    }
+
+    bool ok = nl_dump(snap, fd, RTM_GETLINK, AF_UNSPEC, 1, buf);
+
+    free(buf);
+    close(fd);
+
+    ok = ok && snapshot_select(snap);
+    snap->collected = ok;
+    return ok;
+}
@@ -0,0 +1,19 @@
+/**
+ * @file nsync_netlink.h
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_NETLINK_H
+#define NSYNC_NETLINK_H
+
+#include "nsync_collect.h"
+
+/**********************************************************************/
+/*                             COLLECTOR                              */
+/**********************************************************************/
+
+bool netlink_collect(cmd_list_t *cmds);
+
+bool netlink_collect_links(net_snapshot_t *snap);
+
+#endif
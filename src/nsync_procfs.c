@@ -0,0 +1,684 @@
+/**
+ * @file nsync_procfs.c
+ * Collector that starts no processes. Links come from sysfs, IPv6 addresses
+ * and all routes from procfs, and IPv4 addresses (which procfs does not
+ * list) from the SIOCGIFCONF family of ioctls.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/route.h>
+#include <net/if_arp.h>
+#include <linux/sockios.h>
+#include <linux/ethtool.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
+#include "nsync_procfs.h"
+
+/** Not exported by <net/route.h> */
+#ifndef RTF_LOCAL
+#define RTF_LOCAL 0x80000000
+#endif
+
+/** Names sysfs uses for operational states, indexed by IF_OPER_* */
+static const char *operstate_names[] = {
+    "unknown", "notpresent", "down", "lowerlayerdown", "testing", "dormant", "up",
+};
+
+/**
+ * @brief Reads a small sysfs attribute relative to a directory
+ *
+ * @param dirfd the directory
+ * @param file the name of the attribute
+ * @param buf the output buffer, trimmed of the trailing newline
+ * @param len the size of buf
+ * @returns true if the attribute could be read
+ */
+static bool sysfs_read_at(int dirfd, const char *file, char *buf, size_t len)
+{
+    int fd = openat(dirfd, file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    ssize_t n = pread(fd, buf, len - 1, 0);
+    close(fd);
+    if (n <= 0)
+        return false;
+
+    buf[n] = '\0';
+    rtrim(buf, "\n");
+    return true;
+}
+
+/**
+ * @brief Reads a whole procfs file relative to a directory. procfs files
+ * report no size, so the buffer grows until a read comes back short.
+ *
+ * @param dirfd the directory
+ * @param file the name of the file
+ * @returns the NUL-terminated contents (free with free()), or NULL on
+ * failure (err_msg is set)
+ */
+static char *procfs_slurp_at(int dirfd, const char *file)
+{
+    int fd = openat(dirfd, file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        sprintf(err_msg, "could not open %s/%s: %s", PROCFS_NET_DIR, file, strerror(errno));
+        return NULL;
+    }
+
+    size_t cap = PROCFS_READ_LEN, len = 0;
+    char *buf = malloc(cap);
+    if (!buf) {
+        sprintf(err_msg, "could not allocate memory");
+        close(fd);
+        return NULL;
+    }
+
+    ssize_t n;
+    while ((n = pread(fd, &buf[len], cap - len - 1, len)) > 0) {
+        len += n;
+        if (len + 1 == cap) {
+            char *grown = realloc(buf, cap * 2);
+            if (!grown) {
+                sprintf(err_msg, "could not allocate memory");
+                free(buf);
+                close(fd);
+                return NULL;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+    }
+    close(fd);
+
+    if (n < 0) {
+        sprintf(err_msg, "could not read %s/%s: %s", PROCFS_NET_DIR, file, strerror(errno));
+        free(buf);
+        return NULL;
+    }
+    buf[len] = '\0';
+    return buf;
+}
+
+/**
+ * @brief Parses a string of hex digits into bytes
+ * @param hex the digits, two per byte
+ * @param dst the output buffer
+ * @param len the number of bytes to parse
+ * @returns true if hex held enough digits
+ */
+static bool parse_hex_bytes(const char *hex, unsigned char *dst, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (!isxdigit((unsigned char)hex[2*i]) || !isxdigit((unsigned char)hex[2*i+1]))
+            return false;
+        dst[i] = strtoul((char[3]){ hex[2*i], hex[2*i+1], '\0' }, NULL, 16);
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the name of the driver of a network device
+ * @param name the name of the interface
+ * @param buf the output buffer
+ * @param len the size of buf
+ * @returns true if the driver could be queried
+ */
+static bool ethtool_driver(const char *name, char *buf, size_t len)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+        return false;
+
+    struct ethtool_drvinfo info;
+    memset(&info, 0, sizeof(info));
+    info.cmd = ETHTOOL_GDRVINFO;
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    safe_strncpy(ifr.ifr_name, name, IF_NAMESIZE);
+    ifr.ifr_data = (char *)&info;
+
+    bool ok = ioctl(sock, SIOCETHTOOL, &ifr) == 0;
+    close(sock);
+    if (ok)
+        safe_strncpy(buf, info.driver, len);
+    return ok;
+}
+
+/**
+ * @brief Classifies a link by the kind netlink would report for it
+ * (IFLA_INFO_KIND). sysfs names some kinds in the DEVTYPE of uevent and
+ * marks tun/tap devices with tun_flags. Other virtual devices are named
+ * after their driver, which is the kind for veth, vxlan, dummy and the
+ * like. Devices backed by hardware have no kind.
+ *
+ * @param ifd the sysfs directory of the interface
+ * @param link the link, whose name is set
+ */
+static void sysfs_read_kind(int ifd, net_link_t *link)
+{
+    char val[SYSFS_VAL_LEN];
+
+    if (sysfs_read_at(ifd, "uevent", val, sizeof(val))) {
+        char *devtype = strstr(val, "DEVTYPE=");
+        if (devtype) {
+            devtype += strlen("DEVTYPE=");
+            devtype[strcspn(devtype, "\n")] = '\0';
+            safe_strncpy(link->kind, devtype, MAX_KIND_LEN);
+            return;
+        }
+    }
+
+    if (faccessat(ifd, "tun_flags", F_OK, 0) == 0) {
+        safe_strncpy(link->kind, "tun", MAX_KIND_LEN);
+        return;
+    }
+
+    if (faccessat(ifd, "device", F_OK, AT_SYMLINK_NOFOLLOW) == 0 || link->type == ARPHRD_LOOPBACK)
+        return;
+
+    ethtool_driver(link->name, link->kind, MAX_KIND_LEN);
+}
+
+/**
+ * @brief Reads one interface directory of sysfs into the snapshot
+ *
+ * @param netfd the sysfs net class directory
+ * @param name the name of the interface
+ * @returns false if memory could not be allocated
+ */
+static bool sysfs_read_link(int netfd, const char *name)
+{
+    int ifd = openat(netfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (ifd < 0)
+        return true;
+
+    char val[SYSFS_VAL_LEN];
+    if (!sysfs_read_at(ifd, "ifindex", val, sizeof(val))) {
+        close(ifd);
+        return true;
+    }
+
+    net_link_t *link = snapshot_add_link(&net_snapshot);
+    if (!link) {
+        close(ifd);
+        return false;
+    }
+
+    link->ifindex = atoi(val);
+    safe_strncpy(link->name, name, IF_NAMESIZE);
+
+    if (sysfs_read_at(ifd, "flags", val, sizeof(val)))
+        link->flags = strtoul(val, NULL, 16);
+    if (sysfs_read_at(ifd, "mtu", val, sizeof(val)))
+        link->mtu = strtoul(val, NULL, 10);
+    if (sysfs_read_at(ifd, "type", val, sizeof(val)))
+        link->type = strtoul(val, NULL, 10);
+    sysfs_read_kind(ifd, link);
+
+    /** drop excluded kinds before reading the rest */
+    if (!snapshot_link_selected(link)) {
+        net_snapshot.num_links--;
+        close(ifd);
+        return if_withhold(link->name);
+    }
+
+    /** reading carrier fails with EINVAL while the interface is down */
+    if (sysfs_read_at(ifd, "carrier", val, sizeof(val)))
+        link->carrier = atoi(val);
+
+    if (sysfs_read_at(ifd, "operstate", val, sizeof(val))) {
+        for (size_t i = 0; i < sizeof(operstate_names) / sizeof(operstate_names[0]); i++) {
+            if (strcmp(operstate_names[i], val) == 0)
+                link->operstate = i;
+        }
+    }
+
+    if (sysfs_read_at(ifd, "address", val, sizeof(val))) {
+        const char *p = val;
+        while (link->hwaddr_len < MAX_HWADDR_LEN && parse_hex_bytes(p, &link->hwaddr[link->hwaddr_len], 1)) {
+            link->hwaddr_len++;
+            p += 2;
+            if (*p != ':')
+                break;
+            p++;
+        }
+    }
+
+    close(ifd);
+    return true;
+}
+
+/**
+ * @brief Orders links by interface index, the order the kernel lists them in
+ */
+static int link_index_cmp(const void *a, const void *b)
+{
+    return ((const net_link_t *)a)->ifindex - ((const net_link_t *)b)->ifindex;
+}
+
+/**
+ * @brief Reads every interface listed in sysfs into the snapshot
+ * @returns true on success, false otherwise (err_msg is set)
+ */
+static bool sysfs_read_links(void)
+{
+    int netfd = open(SYSFS_NET_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (netfd < 0) {
+        sprintf(err_msg, "could not open %s: %s", SYSFS_NET_DIR, strerror(errno));
+        return false;
+    }
+
+    /** fdopendir takes ownership of its fd, keep netfd for openat */
+    int listfd = dup(netfd);
+    DIR *dir = listfd < 0 ? NULL : fdopendir(listfd);
+    if (!dir) {
+        sprintf(err_msg, "could not list %s: %s", SYSFS_NET_DIR, strerror(errno));
+        if (listfd >= 0)
+            close(listfd);
+        close(netfd);
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent *ent;
+    while (ok && (ent = readdir(dir)) != NULL) {
+        /** skip unselected interfaces before reading any of their attributes */
+        if (ent->d_name[0] == '.' || !if_name_selected(ent->d_name))
+            continue;
+        ok = sysfs_read_link(netfd, ent->d_name);
+    }
+
+    closedir(dir);
+    close(netfd);
+
+    qsort(net_snapshot.links, net_snapshot.num_links, sizeof(net_link_t), &link_index_cmp);
+    return ok;
+}
+
+/**
+ * @brief Reads what the selection and the carrier lookup need to know
+ * about a single interface from sysfs
+ * @param name the name of the interface
+ * @param link filled with the name, flags, carrier, type and kind
+ * @returns false if the interface does not exist
+ */
+bool sysfs_read_link_info(const char *name, net_link_t *link)
+{
+    memset(link, 0, sizeof(net_link_t));
+    link->carrier = -1;
+    safe_strncpy(link->name, name, IF_NAMESIZE);
+
+    int netfd = open(SYSFS_NET_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (netfd < 0)
+        return false;
+    int ifd = openat(netfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    close(netfd);
+    if (ifd < 0)
+        return false;
+
+    char val[SYSFS_VAL_LEN];
+    if (sysfs_read_at(ifd, "flags", val, sizeof(val)))
+        link->flags = strtoul(val, NULL, 16);
+    if (sysfs_read_at(ifd, "carrier", val, sizeof(val)))
+        link->carrier = atoi(val);
+    if (sysfs_read_at(ifd, "type", val, sizeof(val)))
+        link->type = strtoul(val, NULL, 10);
+    sysfs_read_kind(ifd, link);
+    close(ifd);
+    return true;
+}
+
+/**
+ * @brief Determines if an interface has carrier from its sysfs attributes
+ * @param name the name of the interface
+ * @returns true if the interface is up and has carrier
+ */
+bool sysfs_link_has_carrier(const char *name)
+{
+    net_link_t link;
+    return sysfs_read_link_info(name, &link) && snapshot_link_is_up(&link);
+}
+
+/**
+ * @brief Reads the IPv4 addresses of all interfaces with SIOCGIFCONF, and
+ * their masks and broadcast addresses with SIOCGIFNETMASK/SIOCGIFBRDADDR.
+ * Lifetimes are not available this way, so addresses count as permanent.
+ *
+ * @returns true on success, false otherwise (err_msg is set)
+ */
+static bool ioctl_read_inet_addrs(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        sprintf(err_msg, "could not open socket: %s", strerror(errno));
+        return false;
+    }
+
+    /** grow the buffer until the kernel leaves some of it unused */
+    struct ifconf ifc;
+    memset(&ifc, 0, sizeof(ifc));
+    size_t cap = 64;
+    for (;;) {
+        struct ifreq *grown = realloc(ifc.ifc_req, cap * sizeof(struct ifreq));
+        if (!grown) {
+            sprintf(err_msg, "could not allocate memory");
+            free(ifc.ifc_req);
+            close(sock);
+            return false;
+        }
+        ifc.ifc_req = grown;
+        ifc.ifc_len = cap * sizeof(struct ifreq);
+        if (ioctl(sock, SIOCGIFCONF, &ifc) < 0) {
+            sprintf(err_msg, "SIOCGIFCONF failed: %s", strerror(errno));
+            free(ifc.ifc_req);
+            close(sock);
+            return false;
+        }
+        if ((size_t)ifc.ifc_len < cap * sizeof(struct ifreq))
+            break;
+        cap *= 2;
+    }
+
+    bool ok = true;
+    int num = ifc.ifc_len / sizeof(struct ifreq);
+    for (int i = 0; i < num && ok; i++) {
+        struct ifreq *ifr = &ifc.ifc_req[i];
+        if (ifr->ifr_addr.sa_family != AF_INET)
+            continue;
+
+        /** aliases are reported as <if>:<label> */
+        char name[IF_NAMESIZE];
+        safe_strncpy(name, ifr->ifr_name, IF_NAMESIZE);
+        char *colon = strchr(name, ':');
+        if (colon)
+            *colon = '\0';
+
+        const net_link_t *link = snapshot_find_link(&net_snapshot, name);
+        if (!link)
+            continue;
+
+        net_addr_t *addr = snapshot_add_addr(&net_snapshot);
+        if (!addr) {
+            ok = false;
+            break;
+        }
+        addr->ifindex = link->ifindex;
+        addr->family = AF_INET;
+        addr->flags = IFA_F_PERMANENT;
+        addr->scope = (link->flags & IFF_LOOPBACK) ? RT_SCOPE_HOST : RT_SCOPE_UNIVERSE;
+        memcpy(addr->addr, &((struct sockaddr_in *)&ifr->ifr_addr)->sin_addr, 4);
+
+        struct ifreq req;
+        memset(&req, 0, sizeof(req));
+        safe_strncpy(req.ifr_name, ifr->ifr_name, IF_NAMESIZE);
+        if (ioctl(sock, SIOCGIFNETMASK, &req) == 0) {
+            uint32_t mask = ntohl(((struct sockaddr_in *)&req.ifr_netmask)->sin_addr.s_addr);
+            while (mask & 0x80000000U) {
+                addr->prefixlen++;
+                mask <<= 1;
+            }
+        }
+
+        if ((link->flags & IFF_BROADCAST) && ioctl(sock, SIOCGIFBRDADDR, &req) == 0) {
+            struct in_addr *brd = &((struct sockaddr_in *)&req.ifr_broadaddr)->sin_addr;
+            if (brd->s_addr != 0) {
+                memcpy(addr->brd, brd, 4);
+                addr->has_brd = true;
+            }
+        }
+    }
+
+    free(ifc.ifc_req);
+    close(sock);
+    return ok;
+}
+
+/**
+ * @brief Reads the IPv6 addresses of all interfaces from if_inet6. Each
+ * line holds the address, ifindex, prefix length, scope and IFA_F flags
+ * in hex, followed by the interface name.
+ *
+ * @param procfd the procfs net directory
+ * @returns true on success, false otherwise (err_msg is set)
+ */
+static bool procfs_read_inet6_addrs(int procfd)
+{
+    char *data = procfs_slurp_at(procfd, "if_inet6");
+    if (!data) {
+        /** IPv6 may be disabled entirely */
+        return errno == ENOENT;
+    }
+
+    char *save = NULL;
+    for (char *line = strtok_r(data, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        char hex[33];
+        unsigned int ifindex, prefixlen, scope, flags;
+        if (sscanf(line, "%32s %x %x %x %x", hex, &ifindex, &prefixlen, &scope, &flags) != 5)
+            continue;
+
+        net_addr_t *addr = snapshot_add_addr(&net_snapshot);
+        if (!addr) {
+            free(data);
+            return false;
+        }
+        addr->ifindex = ifindex;
+        addr->family = AF_INET6;
+        addr->prefixlen = prefixlen;
+        addr->flags = flags;
+        if (!parse_hex_bytes(hex, addr->addr, 16)) {
+            net_snapshot.num_addrs--;
+            continue;
+        }
+
+        /** if_inet6 reports IPV6_ADDR_* scope bits rather than RT_SCOPE_* */
+        switch (scope) {
+        case 0x10:  addr->scope = RT_SCOPE_HOST; break;
+        case 0x20:  addr->scope = RT_SCOPE_LINK; break;
+        case 0x40:  addr->scope = RT_SCOPE_SITE; break;
+        default:    addr->scope = RT_SCOPE_UNIVERSE; break;
+        }
+    }
+
+    free(data);
+    return true;
+}
+
+/**
+ * @brief Finds the IPv4 address of an interface that lies within a prefix
+ * @param ifindex the interface
+ * @param dst the network, in network byte order
+ * @param mask the netmask, in network byte order
+ * @returns the address, or NULL if none lies within the prefix
+ */
+static const net_addr_t *find_addr_in_prefix(int ifindex, uint32_t dst, uint32_t mask)
+{
+    for (int i = 0; i < net_snapshot.num_addrs; i++) {
+        const net_addr_t *addr = &net_snapshot.addrs[i];
+        uint32_t local;
+        if (addr->ifindex != ifindex || addr->family != AF_INET)
+            continue;
+        memcpy(&local, addr->addr, 4);
+        if ((local & mask) == dst)
+            return addr;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reads the IPv4 main table from /proc/net/route. Addresses are
+ * printed as the hex of the network order value, so they are copied back
+ * as is. The protocol is not reported: prefixes that match an address of
+ * their interface are taken to be the connected routes the kernel adds.
+ *
+ * @param procfd the procfs net directory
+ * @returns true on success, false otherwise (err_msg is set)
+ */
+static bool procfs_read_inet_routes(int procfd)
+{
+    char *data = procfs_slurp_at(procfd, "route");
+    if (!data)
+        return false;
+
+    char *save = NULL;
+    char *line = strtok_r(data, "\n", &save);      // header
+    for (line = strtok_r(NULL, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        char iface[IF_NAMESIZE + 1];
+        unsigned int dst, gw, flags, refcnt, use, metric, mask;
+        if (sscanf(line, "%16s %x %x %x %u %u %u %x", iface, &dst, &gw, &flags, &refcnt, &use, &metric, &mask) != 8)
+            continue;
+        if (!(flags & RTF_UP))
+            continue;
+
+        net_route_t *rt = snapshot_add_route(&net_snapshot);
+        if (!rt) {
+            free(data);
+            return false;
+        }
+        rt->family = AF_INET;
+        rt->protocol = RTPROT_BOOT;
+        memcpy(rt->dst, &dst, 4);
+        rt->dst_len = __builtin_popcount(mask);
+
+        if (metric) {
+            rt->priority = metric;
+            rt->has_priority = true;
+        }
+
+        /**
+         * Routes without a device are printed with "*". Unreachable and
+         * prohibit routes (which cannot be told apart) carry RTF_REJECT,
+         * blackhole routes do not.
+         */
+        if (strcmp(iface, "*") == 0) {
+            rt->type = (flags & RTF_REJECT) ? RTN_UNREACHABLE : RTN_BLACKHOLE;
+            continue;
+        }
+
+        /** routes of interfaces that were not read (not selected) are dropped */
+        const net_link_t *link = snapshot_find_link(&net_snapshot, iface);
+        if (!link) {
+            net_snapshot.num_routes--;
+            continue;
+        }
+        rt->oif = link->ifindex;
+
+        if (flags & RTF_GATEWAY) {
+            memcpy(rt->gw, &gw, 4);
+            rt->has_gw = true;
+            continue;
+        }
+
+        rt->scope = RT_SCOPE_LINK;
+        const net_addr_t *src = link && metric == 0 ? find_addr_in_prefix(link->ifindex, dst, mask) : NULL;
+        if (src && rt->dst_len == src->prefixlen) {
+            rt->protocol = RTPROT_KERNEL;
+            memcpy(rt->prefsrc, src->addr, 4);
+            rt->has_prefsrc = true;
+        }
+    }
+
+    free(data);
+    return true;
+}
+
+/**
+ * @brief Reads the IPv6 routes from /proc/net/ipv6_route, leaving out
+ * those of the local table
+ *
+ * @param procfd the procfs net directory
+ * @returns true on success, false otherwise (err_msg is set)
+ */
+static bool procfs_read_inet6_routes(int procfd)
+{
+    char *data = procfs_slurp_at(procfd, "ipv6_route");
+    if (!data)
+        return errno == ENOENT;
+
+    char *save = NULL;
+    for (char *line = strtok_r(data, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        char dst[33], src[33], gw[33], iface[IF_NAMESIZE + 1];
+        unsigned int dst_len, src_len, metric, refcnt, use, flags;
+        if (sscanf(line, "%32s %x %32s %x %32s %x %x %x %x %16s",
+                   dst, &dst_len, src, &src_len, gw, &metric, &refcnt, &use, &flags, iface) != 10)
+            continue;
+        if (!(flags & RTF_UP) || (flags & RTF_LOCAL))
+            continue;
+
+        net_route_t *rt = snapshot_add_route(&net_snapshot);
+        if (!rt) {
+            free(data);
+            return false;
+        }
+        rt->family = AF_INET6;
+        rt->protocol = (flags & RTF_GATEWAY) ? RTPROT_BOOT : RTPROT_KERNEL;
+        rt->dst_len = dst_len;
+        rt->priority = metric;
+        rt->has_priority = true;
+        parse_hex_bytes(dst, rt->dst, 16);
+
+        if (flags & RTF_REJECT) {
+            rt->type = RTN_UNREACHABLE;
+            continue;
+        }
+
+        /** routes of interfaces that were not read (not selected) are dropped */
+        const net_link_t *link = snapshot_find_link(&net_snapshot, iface);
+        if (!link) {
+            net_snapshot.num_routes--;
+            continue;
+        }
+        rt->oif = link->ifindex;
+
+        if (flags & RTF_GATEWAY) {
+            parse_hex_bytes(gw, rt->gw, 16);
+            rt->has_gw = true;
+        }
+    }
+
+    free(data);
+    return true;
+}
+
+/**
+ * @brief Collects links, addresses and routes from procfs and sysfs
+ * without starting any processes
+ *
+ * @param cmds unused, the files read are fixed
+ * @returns true on success, false on error (err_msg is set)
+ */
+bool procfs_collect(cmd_list_t *cmds)
+{
+    (void) cmds;
+
+    if (net_snapshot.collected)
+        return true;
+
+    int procfd = open(PROCFS_NET_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procfd < 0) {
+        sprintf(err_msg, "could not open %s: %s", PROCFS_NET_DIR, strerror(errno));
+        return false;
+    }
+
+    bool ok = sysfs_read_links()
+           && snapshot_index_links(&net_snapshot)
+           && ioctl_read_inet_addrs()
+           && procfs_read_inet6_addrs(procfd)
+           && procfs_read_inet_routes(procfd)
+           && procfs_read_inet6_routes(procfd);
+
+    close(procfd);
+
+    ok = ok && snapshot_select(&net_snapshot);
+    if (!ok)
+        free_snapshot();
+    net_snapshot.collected = ok;
+    return ok;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file nsync_procfs.h
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_PROCFS_H
+#define NSYNC_PROCFS_H
+
+#include "nsync_collect.h"
+
+/**********************************************************************/
+/*                             CONSTANTS                              */
+/**********************************************************************/
+#define SYSFS_NET_DIR "/sys/class/net"
+#define PROCFS_NET_DIR "/proc/net"
+
+#define SYSFS_VAL_LEN 128
+#define PROCFS_READ_LEN 4096
+
+/**********************************************************************/
+/*                             COLLECTOR                              */
+/**********************************************************************/
+
+bool procfs_collect(cmd_list_t *cmds);
+
+bool sysfs_read_link_info(const char *name, net_link_t *link);
+
+bool sysfs_link_has_carrier(const char *name);
+
+#endif
@@ -0,0 +1,779 @@
+/**
+ * @file nsync_route.c
+ * Parses `ip route` lines and `ip route add` arguments into packed route
+ * records, and renders the records back exactly as `ip route` prints them.
+ * A line that would not render back to itself keeps its text, so persisted
+ * routes are written out as they were read.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <arpa/inet.h>
+#include <linux/rtnetlink.h>
+#include "nsync_route.h"
+#include "nsync_centos_parse.h"     // ifcfg_opt_t, used by the generated keyword tables
+#include "nsync_keywords.h"
+#include "nsync_scan.h"
+
+/** Longest word of a route looked up by name */
+#define ROUTE_WORD_LEN 32
+
+/**
+ * @struct route_devs
+ * @brief the device names routes refer to, numbered from 1 in order of
+ * first use and indexed by a hash of the name
+ */
+typedef struct route_devs {
+    char **names;       // by id - 1
+    int num;
+    int cap;
+    int *slots;         // id of the name in each slot, 0 for empty
+    int num_slots;      // a power of two
+} route_devs_t;
+
+/**
+ * @struct route_stream
+ * @brief where the routes of a stream go
+ */
+typedef struct route_stream {
+    route_if_map_t ifs;
+    route_sink_fn sink;
+    void *ctx;
+} route_stream_t;
+
+/** Devices of the routes parsed this run */
+static route_devs_t route_devs;
+
+/** Names `ip route` uses for route protocols */
+static const char *route_proto_names[256] = {
+    [RTPROT_UNSPEC]     = "unspec",
+    [RTPROT_REDIRECT]   = "redirect",
+    [RTPROT_KERNEL]     = "kernel",
+    [RTPROT_BOOT]       = "boot",
+    [RTPROT_STATIC]     = "static",
+    [RTPROT_GATED]      = "gated",
+    [RTPROT_RA]         = "ra",
+    [RTPROT_MRT]        = "mrt",
+    [RTPROT_ZEBRA]      = "zebra",
+    [RTPROT_BIRD]       = "bird",
+    [RTPROT_DNROUTED]   = "dnrouted",
+    [RTPROT_XORP]       = "xorp",
+    [RTPROT_NTK]        = "ntk",
+    [RTPROT_DHCP]       = "dhcp",
+    [RTPROT_KEEPALIVED] = "keepalived",
+    [RTPROT_BABEL]      = "babel",
+    [RTPROT_BGP]        = "bgp",
+    [RTPROT_ISIS]       = "isis",
+    [RTPROT_OSPF]       = "ospf",
+    [RTPROT_RIP]        = "rip",
+    [RTPROT_EIGRP]      = "eigrp",
+};
+
+/** Names `ip route` uses for non-unicast route types */
+static const char *route_type_names[RTN_MAX + 1] = {
+    [RTN_LOCAL]         = "local",
+    [RTN_BROADCAST]     = "broadcast",
+    [RTN_ANYCAST]       = "anycast",
+    [RTN_MULTICAST]     = "multicast",
+    [RTN_BLACKHOLE]     = "blackhole",
+    [RTN_UNREACHABLE]   = "unreachable",
+    [RTN_PROHIBIT]      = "prohibit",
+    [RTN_THROW]         = "throw",
+    [RTN_NAT]           = "nat",
+};
+
+/**
+ * @brief Gets the name `ip` uses for an address/route scope
+ * @param scope the RT_SCOPE_* value
+ * @param buf buffer used for unnamed scopes
+ * @param len the size of buf
+ * @returns the name of the scope
+ */
+const char *route_scope_name(unsigned char scope, char *buf, size_t len)
+{
+    switch (scope) {
+    case RT_SCOPE_UNIVERSE: return "global";
+    case RT_SCOPE_SITE:     return "site";
+    case RT_SCOPE_LINK:     return "link";
+    case RT_SCOPE_HOST:     return "host";
+    case RT_SCOPE_NOWHERE:  return "nowhere";
+    default:
+        snprintf(buf, len, "%u", scope);
+        return buf;
+    }
+}
+
+/**
+ * @brief Looks up a route protocol by the name `ip route` uses for it
+ * @param name the name or number of the protocol
+ * @returns the RTPROT_* value, or RTPROT_UNSPEC if the name is unknown
+ */
+unsigned char route_proto_from_name(const char *name)
+{
+    if (isdigit((unsigned char)name[0]))
+        return strtoul(name, NULL, 10);
+    for (int i = 0; i < 256; i++) {
+        if (route_proto_names[i] && strcmp(route_proto_names[i], name) == 0)
+            return i;
+    }
+    return RTPROT_UNSPEC;
+}
+
+/**
+ * @brief Looks up a route type by the name `ip route` uses for it
+ * @param name the name of the type
+ * @returns the RTN_* value, RTN_UNICAST if the name is unknown
+ */
+unsigned char route_type_from_name(const char *name)
+{
+    for (int i = 0; i <= RTN_MAX; i++) {
+        if (route_type_names[i] && strcmp(route_type_names[i], name) == 0)
+            return i;
+    }
+    return RTN_UNICAST;
+}
+
+/**
+ * @brief Looks up an address/route scope by the name `ip` uses for it
+ * @param name the name or number of the scope
+ * @returns the RT_SCOPE_* value
+ */
+unsigned char route_scope_from_name(const char *name)
+{
+    if (isdigit((unsigned char)name[0]))
+        return strtoul(name, NULL, 10);
+    if (strcmp(name, "site") == 0)
+        return RT_SCOPE_SITE;
+    if (strcmp(name, "link") == 0)
+        return RT_SCOPE_LINK;
+    if (strcmp(name, "host") == 0)
+        return RT_SCOPE_HOST;
+    if (strcmp(name, "nowhere") == 0)
+        return RT_SCOPE_NOWHERE;
+    return RT_SCOPE_UNIVERSE;
+}
+
+/**
+ * @brief Finds the slot of a device name in the hash index
+ * @param name the name, not necessarily NUL-terminated
+ * @returns the slot holding the name, or the empty slot it would go in
+ */
+static int *route_dev_slot(str_slice_t name)
+{
+    int mask = route_devs.num_slots - 1;
+    int s = kw_hash(name.ptr, name.len, 0) & mask;
+    for (;; s = (s + 1) & mask) {
+        int id = route_devs.slots[s];
+        if (id == 0)
+            return &route_devs.slots[s];
+        const char *dev = route_devs.names[id - 1];
+        if (strncmp(dev, name.ptr, name.len) == 0 && dev[name.len] == '\0')
+            return &route_devs.slots[s];
+    }
+}
+
+/**
+ * @brief Doubles the hash index of the device names
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+static bool route_devs_rehash(void)
+{
+    int num_slots = route_devs.num_slots ? route_devs.num_slots * 2 : 64;
+    int *slots = calloc(num_slots, sizeof(int));
+    MEM_CHECK(slots, false);
+
+    free(route_devs.slots);
+    route_devs.slots = slots;
+    route_devs.num_slots = num_slots;
+    for (int id = 1; id <= route_devs.num; id++)
+        *route_dev_slot(slice_make(route_devs.names[id - 1])) = id;
+    return true;
+}
+
+/**
+ * @brief Numbers a device, adding it to the devices of this run the first
+ * time it is seen
+ * @param name the name of the device
+ * @returns the device's number, from 1, or -1 if memory could not be
+ * allocated (err_msg is set)
+ */
+int route_dev_id(str_slice_t name)
+{
+    if (2 * (route_devs.num + 1) > route_devs.num_slots && !route_devs_rehash())
+        return -1;
+
+    int *slot = route_dev_slot(name);
+    if (*slot)
+        return *slot;
+
+    if (route_devs.num == route_devs.cap) {
+        int cap = route_devs.cap ? route_devs.cap * 2 : 64;
+        char **names = realloc(route_devs.names, cap * sizeof(char *));
+        MEM_CHECK(names, -1);
+        route_devs.names = names;
+        route_devs.cap = cap;
+    }
+    char *dev = strndup(name.ptr, name.len);
+    MEM_CHECK(dev, -1);
+    route_devs.names[route_devs.num++] = dev;
+    *slot = route_devs.num;
+    return *slot;
+}
+
+/**
+ * @brief Looks up the number of a device without adding it
+ * @param name the name of the device
+ * @returns the device's number, or 0 if no route refers to it
+ */
+int route_dev_lookup(const char *name)
+{
+    if (route_devs.num == 0)
+        return 0;
+    return *route_dev_slot(slice_make(name));
+}
+
+/**
+ * @brief Gets the name of a device
+ * @param id the device's number
+ * @returns the name, or NULL for 0
+ */
+const char *route_dev_name(int id)
+{
+    return id > 0 && id <= route_devs.num ? route_devs.names[id - 1] : NULL;
+}
+
+/**
+ * @brief Frees the devices of this run
+ */
+void route_devs_free(void)
+{
+    for (int i = 0; i < route_devs.num; i++)
+        free(route_devs.names[i]);
+    free(route_devs.names);
+    free(route_devs.slots);
+    memset(&route_devs, 0, sizeof(route_devs));
+}
+
+/**
+ * @brief Reads an IPv4 address, with an optional prefix length
+ * @param word the word, e.g. 10.0.0.0/24
+ * @param addr receives the address in network byte order
+ * @param prefix_len receives the prefix length, 32 if there is none. NULL
+ * if the word may not have one.
+ * @returns false if the word is not an IPv4 address
+ */
+static bool route_read_addr(str_slice_t word, uint32_t *addr, uint8_t *prefix_len)
+{
+    char buf[INET_ADDRSTRLEN + 3];
+    if (word.len >= sizeof(buf))
+        return false;
+    slice_copy(buf, word, sizeof(buf));
+
+    char *slash = strchr(buf, '/');
+    if (slash) {
+        char *end;
+        unsigned long len = strtoul(slash + 1, &end, 10);
+        if (!prefix_len || *end || end == slash + 1 || len > 32)
+            return false;
+        *slash = '\0';
+        *prefix_len = len;
+    } else if (prefix_len) {
+        *prefix_len = 32;
+    }
+    return inet_pton(AF_INET, buf, addr) == 1;
+}
+
+/**
+ * @brief Reads a number
+ * @param word the word
+ * @param num receives the number
+ * @returns false if the word is not a number
+ */
+static bool route_read_num(str_slice_t word, uint32_t *num)
+{
+    if (word.len == 0 || word.len > 10)
+        return false;
+    uint64_t n = 0;
+    for (size_t i = 0; i < word.len; i++) {
+        if (!isdigit((unsigned char)word.ptr[i]))
+            return false;
+        n = n * 10 + (word.ptr[i] - '0');
+    }
+    if (n > UINT32_MAX)
+        return false;
+    *num = n;
+    return true;
+}
+
+/**
+ * @brief Reads a name of a route table, protocol or scope
+ * @param word the word
+ * @param buf receives the NUL-terminated name
+ * @returns false if the word is too long to be a name
+ */
+static bool route_read_name(str_slice_t word, char buf[ROUTE_WORD_LEN])
+{
+    if (word.len == 0 || word.len >= ROUTE_WORD_LEN)
+        return false;
+    slice_copy(buf, word, ROUTE_WORD_LEN);
+    return true;
+}
+
+/** Where route_render prints each keyword, to tell words out of its order */
+static const uint8_t route_kw_rank[] = {
+    [ROUTE_KW_VIA]          = 1,
+    [ROUTE_KW_DEV]          = 2,
+    [ROUTE_KW_TABLE]        = 3,
+    [ROUTE_KW_PROTO]        = 4,
+    [ROUTE_KW_SCOPE]        = 5,
+    [ROUTE_KW_SRC]          = 6,
+    [ROUTE_KW_METRIC]       = 7,
+    [ROUTE_KW_DEAD]         = 8,
+    [ROUTE_KW_PERVASIVE]    = 9,
+    [ROUTE_KW_ONLINK]       = 10,
+    [ROUTE_KW_LINKDOWN]     = 11,
+};
+
+/**
+ * @brief Determines if a number read by route_read_num is written as "%u"
+ * prints it, i.e. without leading zeros
+ * @param word the number
+ * @returns true if printing the number gives the word back
+ */
+static bool route_num_verbatim(str_slice_t word)
+{
+    return word.ptr[0] != '0' || word.len == 1;
+}
+
+/**
+ * @brief Fills a route from the words of a line
+ * @param text the line
+ * @param rt the route, with its defaults set
+ * @param complete set to false if a word has no field in the record
+ * @param verbatim set to false if route_render would not give the words
+ * back as they are: a word is spelled or placed differently, or says
+ * what rendering leaves out (e.g. "table main")
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+static bool route_read_words(str_slice_t text, route_t *rt, bool *complete, bool *verbatim)
+{
+    str_slice_t word, arg;
+    char name[ROUTE_WORD_LEN];
+    uint32_t num;
+    int rank = 0;
+
+    /** [type] <prefix>|default */
+    if (!slice_next(&text, ROUTE_DELIM, &word)) {
+        *complete = false;
+        return true;
+    }
+    if (route_read_name(word, name) && route_type_from_name(name) != RTN_UNICAST) {
+        rt->type = route_type_from_name(name);
+        if (!slice_next(&text, ROUTE_DELIM, &word)) {
+            *complete = false;
+            return true;
+        }
+    }
+    if (slice_eq(word, "default"))
+        rt->dst_len = 0;
+    else if (route_read_addr(word, &rt->dst, &rt->dst_len)) {
+        /** A host route is printed without its length, a zero length as default */
+        const char *slash = memchr(word.ptr, '/', word.len);
+        if (slash) {
+            str_slice_t len = { slash + 1, word.ptr + word.len - slash - 1 };
+            if (rt->dst_len == 32 || rt->dst_len == 0 || !isdigit((unsigned char)len.ptr[0]) || !route_num_verbatim(len))
+                *verbatim = false;
+        }
+    }
+    else
+        *complete = false;
+
+    while (slice_next(&text, ROUTE_DELIM, &word)) {
+        route_kw_t kw = route_kw_lookup(word.ptr, word.len);
+
+        /** Each keyword once, in the order they are printed; metric has other spellings */
+        if (kw != ROUTE_KW_NONE) {
+            if (route_kw_rank[kw] <= rank || (kw == ROUTE_KW_METRIC && !slice_eq(word, "metric")))
+                *verbatim = false;
+            rank = route_kw_rank[kw];
+        }
+
+        switch (kw) {
+        case ROUTE_KW_DEAD:         rt->flags |= RTNH_F_DEAD;       continue;
+        case ROUTE_KW_PERVASIVE:    rt->flags |= RTNH_F_PERVASIVE;  continue;
+        case ROUTE_KW_ONLINK:       rt->flags |= RTNH_F_ONLINK;     continue;
+        case ROUTE_KW_LINKDOWN:     rt->flags |= RTNH_F_LINKDOWN;   continue;
+        case ROUTE_KW_NONE:
+            *complete = false;
+            continue;
+        default:
+            break;
+        }
+
+        /** The remaining keywords take an argument */
+        if (!slice_next(&text, ROUTE_DELIM, &arg)) {
+            *complete = false;
+            break;
+        }
+        switch (kw) {
+        case ROUTE_KW_VIA:
+            if (route_read_addr(arg, &rt->gw, NULL))
+                rt->has |= ROUTE_HAS_GW;
+            else
+                *complete = false;
+            break;
+
+        case ROUTE_KW_DEV:
+            rt->oif = route_dev_id(arg);
+            if (rt->oif < 0)
+                return false;
+            break;
+
+        case ROUTE_KW_TABLE:
+            /** The main table is not printed, the others by number */
+            if (route_read_num(arg, &num)) {
+                rt->table = num;
+                *verbatim &= num != RT_TABLE_MAIN && route_num_verbatim(arg);
+                break;
+            }
+            *verbatim = false;
+            if (slice_eq(arg, "main"))
+                rt->table = RT_TABLE_MAIN;
+            else if (slice_eq(arg, "local"))
+                rt->table = RT_TABLE_LOCAL;
+            else if (slice_eq(arg, "default"))
+                rt->table = RT_TABLE_DEFAULT;
+            else
+                *complete = false;
+            break;
+
+        case ROUTE_KW_PROTO:
+            if (route_read_num(arg, &num) && num < 256)
+                rt->proto = num;
+            else if (route_read_name(arg, name) && route_proto_from_name(name) != RTPROT_UNSPEC)
+                rt->proto = route_proto_from_name(name);
+            else {
+                *complete = false;
+                break;
+            }
+            /** boot is not printed, a protocol with a name by its name */
+            if (route_proto_names[rt->proto])
+                *verbatim &= rt->proto != RTPROT_BOOT && slice_eq(arg, route_proto_names[rt->proto]);
+            else
+                *verbatim &= route_num_verbatim(arg);
+            break;
+
+        case ROUTE_KW_SCOPE:
+            if (route_read_num(arg, &num) && num < 256)
+                rt->scope = num;
+            else if (route_read_name(arg, name))
+                rt->scope = route_scope_from_name(name);
+            else {
+                *complete = false;
+                break;
+            }
+            /** global is not printed, the others as route_scope_name names them */
+            *verbatim &= rt->scope != RT_SCOPE_UNIVERSE &&
+                         slice_eq(arg, route_scope_name(rt->scope, name, sizeof(name)));
+            break;
+
+        case ROUTE_KW_SRC:
+            if (route_read_addr(arg, &rt->src, NULL))
+                rt->has |= ROUTE_HAS_SRC;
+            else
+                *complete = false;
+            break;
+
+        case ROUTE_KW_METRIC:
+            if (route_read_num(arg, &rt->metric)) {
+                rt->has |= ROUTE_HAS_METRIC;
+                *verbatim &= route_num_verbatim(arg);
+            }
+            else
+                *complete = false;
+            break;
+
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parses a route from an `ip route` line or the arguments of
+ * `ip route add`. Routes the record cannot hold are kept as text.
+ * @param text the line, with or without surrounding whitespace
+ * @param rt receives the route; its text, if kept, is allocated from the
+ * parse arena with the words separated by single spaces
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+bool route_parse(str_slice_t text, route_t *rt)
+{
+    memset(rt, 0, sizeof(*rt));
+    rt->table = RT_TABLE_MAIN;
+    rt->proto = RTPROT_BOOT;
+    rt->scope = RT_SCOPE_UNIVERSE;
+    rt->type = RTN_UNICAST;
+
+    text = slice_trim(text, ROUTE_DELIM);
+    bool complete = true, verbatim = true;
+    if (!route_read_words(text, rt, &complete, &verbatim))
+        return false;
+
+    if (complete) {
+        rt->family = AF_INET;
+
+        /** Keep the text only when rendering would not give it back word for word */
+        if (verbatim)
+            return true;
+    } else {
+        rt->family = AF_UNSPEC;
+    }
+
+    /** Words are rejoined with single spaces, as ip prints them */
+    char *joined = NULL;
+    str_slice_t word;
+    while (slice_next(&text, ROUTE_DELIM, &word)) {
+        if (joined) {
+            joined = arena_strcat(parse_arena, joined, " ", 1);
+            MEM_CHECK(joined, false);
+        }
+        joined = arena_strcat(parse_arena, joined, word.ptr, word.len);
+        MEM_CHECK(joined, false);
+    }
+    rt->raw = joined ? joined : "";
+    return true;
+}
+
+/**
+ * @brief Renders a route exactly as `ip route` prints it, without the
+ * trailing space
+ * @param rt the route
+ * @param buf the output buffer
+ * @param len the size of buf
+ * @returns the length of the text, at most len - 1
+ */
+size_t route_render(const route_t *rt, char *buf, size_t len)
+{
+    char addr[INET_ADDRSTRLEN];
+    char num[16];
+    size_t off = 0;
+
+#define ROUTE_APPEND(...) \
+    do { if (off < len) off += snprintf(&buf[off], len - off, __VA_ARGS__); } while (0)
+
+    buf[0] = '\0';
+
+    if (rt->family != AF_INET) {
+        ROUTE_APPEND("%s", rt->raw ? rt->raw : "");
+        return min(off, len - 1);
+    }
+
+    if (rt->type != RTN_UNICAST && rt->type <= RTN_MAX && route_type_names[rt->type])
+        ROUTE_APPEND("%s ", route_type_names[rt->type]);
+
+    if (rt->dst_len == 0)
+        ROUTE_APPEND("default");
+    else {
+        inet_ntop(AF_INET, &rt->dst, addr, sizeof(addr));
+        if (rt->dst_len == 32)
+            ROUTE_APPEND("%s", addr);
+        else
+            ROUTE_APPEND("%s/%u", addr, rt->dst_len);
+    }
+
+    if (rt->has & ROUTE_HAS_GW) {
+        inet_ntop(AF_INET, &rt->gw, addr, sizeof(addr));
+        ROUTE_APPEND(" via %s", addr);
+    }
+
+    if (rt->oif)
+        ROUTE_APPEND(" dev %s", route_dev_name(rt->oif));
+
+    if (rt->table != RT_TABLE_MAIN)
+        ROUTE_APPEND(" table %u", rt->table);
+
+    if (rt->proto != RTPROT_BOOT) {
+        if (route_proto_names[rt->proto])
+            ROUTE_APPEND(" proto %s", route_proto_names[rt->proto]);
+        else
+            ROUTE_APPEND(" proto %u", rt->proto);
+    }
+
+    if (rt->scope != RT_SCOPE_UNIVERSE)
+        ROUTE_APPEND(" scope %s", route_scope_name(rt->scope, num, sizeof(num)));
+
+    if (rt->has & ROUTE_HAS_SRC) {
+        inet_ntop(AF_INET, &rt->src, addr, sizeof(addr));
+        ROUTE_APPEND(" src %s", addr);
+    }
+
+    if (rt->has & ROUTE_HAS_METRIC)
+        ROUTE_APPEND(" metric %u", rt->metric);
+
+    if (rt->flags & RTNH_F_DEAD)
+        ROUTE_APPEND(" dead");
+    if (rt->flags & RTNH_F_PERVASIVE)
+        ROUTE_APPEND(" pervasive");
+    if (rt->flags & RTNH_F_ONLINK)
+        ROUTE_APPEND(" onlink");
+    if (rt->flags & RTNH_F_LINKDOWN)
+        ROUTE_APPEND(" linkdown");
+
+#undef ROUTE_APPEND
+
+    return min(off, len - 1);
+}
+
+/**
+ * @brief Gets the text of a route for writing: the text it was read from
+ * if that was kept, otherwise its rendering
+ * @param rt the route
+ * @param buf buffer for the rendering
+ * @returns the text
+ */
+const char *route_str(const route_t *rt, char buf[ROUTE_TEXT_LEN])
+{
+    if (rt->raw)
+        return rt->raw;
+    route_render(rt, buf, ROUTE_TEXT_LEN);
+    return buf;
+}
+
+/**
+ * @brief Compares two routes. Records are compared field by field, so the
+ * order and spelling of the words they were read from do not matter;
+ * routes kept as text are compared by their text.
+ * @param a a route
+ * @param b another route
+ * @returns true if the routes are the same
+ */
+bool route_eq(const route_t *a, const route_t *b)
+{
+    if (a->family != AF_INET || b->family != AF_INET) {
+        char buf_a[ROUTE_TEXT_LEN], buf_b[ROUTE_TEXT_LEN];
+        return strcmp(route_str(a, buf_a), route_str(b, buf_b)) == 0;
+    }
+
+    return a->dst == b->dst && a->dst_len == b->dst_len &&
+           a->gw == b->gw && a->src == b->src &&
+           a->table == b->table && a->metric == b->metric &&
+           a->oif == b->oif && a->proto == b->proto &&
+           a->scope == b->scope && a->type == b->type &&
+           a->flags == b->flags && a->has == b->has;
+}
+
+/**
+ * @brief Numbers the devices of a list of interfaces, so routes can be
+ * attributed to the interfaces by device number. An interface that is
+ * listed twice gets its device's routes at its first place.
+ * @param map the map
+ * @param if_names the names of the interfaces; NULL for one that takes no routes
+ * @param num_if the number of interfaces
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+bool route_if_map_init(route_if_map_t *map, const char *const *if_names, int num_if)
+{
+    memset(map, 0, sizeof(*map));
+
+    int *dev_ids = calloc(num_if ? num_if : 1, sizeof(int));
+    MEM_CHECK(dev_ids, false);
+    for (int i = 0; i < num_if; i++) {
+        if (!if_names[i])
+            continue;
+        dev_ids[i] = route_dev_id(slice_make(if_names[i]));
+        if (dev_ids[i] < 0) {
+            free(dev_ids);
+            return false;
+        }
+        if (dev_ids[i] >= map->num_devs)
+            map->num_devs = dev_ids[i] + 1;
+    }
+
+    map->if_of_dev = malloc((map->num_devs ? map->num_devs : 1) * sizeof(int));
+    if (!map->if_of_dev) {
+        free(dev_ids);
+        MEM_CHECK(map->if_of_dev, false);
+    }
+    for (int d = 0; d < map->num_devs; d++)
+        map->if_of_dev[d] = -1;
+    for (int i = num_if - 1; i >= 0; i--) {
+        if (dev_ids[i] > 0)
+            map->if_of_dev[dev_ids[i]] = i;
+    }
+    free(dev_ids);
+    return true;
+}
+
+/**
+ * @brief Frees a map of devices to interfaces
+ * @param map the map
+ */
+void route_if_map_free(route_if_map_t *map)
+{
+    free(map->if_of_dev);
+    memset(map, 0, sizeof(*map));
+}
+
+/**
+ * @brief Parses a line of a route stream and hands the route to the sink
+ * if it is on one of the interfaces
+ * @param ctx the stream
+ * @param line the line
+ * @param kernel whether the line is a route the kernel added
+ * @returns false if the sink failed or memory could not be allocated
+ */
+static bool route_stream_line(void *ctx, str_slice_t line, bool kernel)
+{
+    route_stream_t *rs = ctx;
+
+    /** Routes made on boot are dropped before they are parsed */
+    if (kernel || line.len == 0)
+        return true;
+
+    route_t rt;
+    if (!route_parse(line, &rt))
+        return false;
+
+    /** Routes of other devices are never kept */
+    int if_index = ROUTE_IF(&rs->ifs, &rt);
+    if (if_index < 0)
+        return true;
+    return rs->sink(rs->ctx, if_index, &rt);
+}
+
+/**
+ * @brief Runs an `ip route` command and streams its routes to the
+ * interfaces they are on. Output is read and parsed a chunk at a time and
+ * the stream itself holds no route: kernel routes and routes of other
+ * devices are dropped as they are read. Every route the sink keeps stays
+ * in memory, so the routes of the synced interfaces are still all held
+ * until the config files are written.
+ * @param cmd the command
+ * @param if_names the names of the interfaces; NULL for one that takes no routes
+ * @param num_if the number of interfaces
+ * @param sink called with each kept route and the index of its interface
+ * @param ctx passed through to sink
+ * @returns false if the command failed, the sink failed or memory could
+ * not be allocated (err_msg is set)
+ */
+bool route_stream(const char *cmd, const char *const *if_names, int num_if, route_sink_fn sink, void *ctx)
+{
+    route_stream_t rs = { .sink = sink, .ctx = ctx };
+
+    if (!route_if_map_init(&rs.ifs, if_names, num_if))
+        return false;
+
+    line_stream_t lines;
+    scan_stream_init(&lines, ROUTE_KERNEL_KW, &route_stream_line, &rs);
+    bool ok = exec_read_stream(cmd, &scan_stream_feed, &lines);
+
+    /** A failed stream's unfinished line is dropped, not handed on */
+    if (!ok)
+        lines.partial_len = 0;
+    ok = scan_stream_finish(&lines) && ok;
+
+    route_if_map_free(&rs.ifs);
+    return ok;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file nsync_route.h
+ * Stores routes as packed records instead of `ip route` text lines, and
+ * renders them back to the text `ip route` prints and `ip route add` takes
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_ROUTE_H
+#define NSYNC_ROUTE_H
+
+#include <stdint.h>
+#include "nsync_utils.h"
+
+/** GLOBAL ERROR BUFFER */
+extern char err_msg[ERR_LEN];
+
+/**********************************************************************/
+/*                             CONSTANTS                              */
+/**********************************************************************/
+/** Longest text a route record renders to, flags included */
+#define ROUTE_TEXT_LEN 256
+#define ROUTE_DELIM " \t\n"
+
+/** Marks the routes the kernel adds itself, which are never persisted */
+#define ROUTE_KERNEL_KW "proto kernel"
+
+/** Which of the optional fields of a route are present */
+#define ROUTE_HAS_GW        0x01
+#define ROUTE_HAS_SRC       0x02
+#define ROUTE_HAS_METRIC    0x04
+
+/**********************************************************************/
+/*                             STRUCTS                                */
+/**********************************************************************/
+/**
+ * @struct route
+ * @brief one route, 40 bytes. Routes with words the record has no field
+ * for (IPv6 addresses, `mtu`, `nexthop` ...) have an AF_UNSPEC family and
+ * are compared and written by their text alone; their device is still
+ * recorded so they are attributed to the right interface.
+ */
+typedef struct route {
+    const char *raw;        // the text as read when rendering would not reproduce it, else NULL
+    uint32_t dst;           // network byte order, like the gateway and source
+    uint32_t gw;
+    uint32_t src;
+    uint32_t table;
+    uint32_t metric;
+    int oif;                // device, numbered by route_dev_id; 0 for none
+    uint8_t family;         // AF_INET, or AF_UNSPEC for routes kept as text
+    uint8_t dst_len;
+    uint8_t proto;          // RTPROT_*
+    uint8_t scope;          // RT_SCOPE_*
+    uint8_t type;           // RTN_*
+    uint8_t flags;          // RTNH_F_*
+    uint8_t has;            // ROUTE_HAS_*
+} route_t;
+
+/**
+ * @struct route_if_map
+ * @brief the interface each device number belongs to, so a route is
+ * attributed by its device with one lookup
+ */
+typedef struct route_if_map {
+    int *if_of_dev;         // interface of each device number, -1 for devices of no interface
+    int num_devs;           // entries of if_of_dev
+} route_if_map_t;
+
+/** The index of the interface a route is on, or -1 */
+#define ROUTE_IF(map, rt) \
+    ((rt)->oif > 0 && (rt)->oif < (map)->num_devs ? (map)->if_of_dev[(rt)->oif] : -1)
+
+/** Called with each route of a stream and the index of its interface; returns false to stop */
+typedef bool (*route_sink_fn)(void *ctx, int if_index, const route_t *rt);
+
+/**********************************************************************/
+/*                             FUNCTIONS                              */
+/**********************************************************************/
+bool route_parse(str_slice_t text, route_t *rt);
+
+size_t route_render(const route_t *rt, char *buf, size_t len);
+
+const char *route_str(const route_t *rt, char buf[ROUTE_TEXT_LEN]);
+
+bool route_eq(const route_t *a, const route_t *b);
+
+bool route_if_map_init(route_if_map_t *map, const char *const *if_names, int num_if);
+
+void route_if_map_free(route_if_map_t *map);
+
+bool route_stream(const char *cmd, const char *const *if_names, int num_if, route_sink_fn sink, void *ctx);
+
+int route_dev_id(str_slice_t name);
+
+int route_dev_lookup(const char *name);
+
+const char *route_dev_name(int id);
+
+void route_devs_free(void);
+
+const char *route_scope_name(unsigned char scope, char *buf, size_t len);
+
+unsigned char route_proto_from_name(const char *name);
+
+unsigned char route_type_from_name(const char *name);
+
+unsigned char route_scope_from_name(const char *name);
+
+#endif
@@ -0,0 +1,360 @@
+/**
+ * @file nsync_scan.c
+ * Bulk line scanner for command output such as `ip route` on hosts with a
+ * full routing table. Each 64-byte block of the buffer is compared once,
+ * a vector at a time, against the newline and the first byte of a keyword;
+ * lines are then split and checked for the keyword by walking the bits of
+ * the block's mask, with no per-line copy. The widest path the CPU
+ * supports is picked at the first scan.
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include "nsync_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_HAVE_X86 1
+#endif
+
+/** Bytes covered by one mask */
+#define SCAN_BLOCK 64
+
+typedef uint64_t (*scan_mask_fn)(const char *p, char a, char b);
+
+static uint64_t scan_mask_resolve(const char *p, char a, char b);
+
+/** The path in use; resolved on the first call */
+static scan_mask_fn scan_mask_impl = &scan_mask_resolve;
+static scan_isa_t scan_isa_in_use = SCAN_SCALAR;
+
+/**
+ * @brief Marks the bytes of a block equal to either of two bytes, a byte
+ * at a time
+ * @param p the block
+ * @param n the length of the block, at most SCAN_BLOCK
+ * @param a a byte
+ * @param b another byte, or a again
+ * @returns the mask, bit i set if p[i] is a or b
+ */
+static uint64_t scan_mask_tail(const char *p, size_t n, char a, char b)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] == a || p[i] == b)
+            mask |= (uint64_t)1 << i;
+    }
+    return mask;
+}
+
+/**
+ * @brief Marks the bytes of a full block equal to either of two bytes, a
+ * byte at a time
+ * @param p the block, SCAN_BLOCK bytes
+ * @param a a byte
+ * @param b another byte, or a again
+ * @returns the mask, bit i set if p[i] is a or b
+ */
+static uint64_t scan_mask_scalar(const char *p, char a, char b)
+{
+    return scan_mask_tail(p, SCAN_BLOCK, a, b);
+}
+
+#ifdef SCAN_HAVE_X86
+/**
+ * @brief Marks the bytes of a full block equal to either of two bytes, 16
+ * bytes at a time
+ * @param p the block, SCAN_BLOCK bytes
+ * @param a a byte
+ * @param b another byte, or a again
+ * @returns the mask, bit i set if p[i] is a or b
+ */
+__attribute__((target("sse2")))
+static uint64_t scan_mask_sse2(const char *p, char a, char b)
+{
+    __m128i va = _mm_set1_epi8(a);
+    __m128i vb = _mm_set1_epi8(b);
+    uint64_t mask = 0;
+    for (int i = 0; i < SCAN_BLOCK; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&p[i]);
+        uint64_t m = (uint16_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        mask |= m << i;
+    }
+    return mask;
+}
+
+/**
+ * @brief Marks the bytes of a full block equal to either of two bytes, 32
+ * bytes at a time
+ * @param p the block, SCAN_BLOCK bytes
+ * @param a a byte
+ * @param b another byte, or a again
+ * @returns the mask, bit i set if p[i] is a or b
+ */
+__attribute__((target("avx2")))
+static uint64_t scan_mask_avx2(const char *p, char a, char b)
+{
+    __m256i va = _mm256_set1_epi8(a);
+    __m256i vb = _mm256_set1_epi8(b);
+    __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)&p[32]);
+    uint64_t m_lo = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, va),
+                                                                   _mm256_cmpeq_epi8(lo, vb)));
+    uint64_t m_hi = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, va),
+                                                                   _mm256_cmpeq_epi8(hi, vb)));
+    return m_lo | m_hi << 32;
+}
+#endif
+
+/**
+ * @brief Tells whether the CPU can run a path of the scanner
+ * @param isa the path
+ * @returns true if it can
+ */
+static bool scan_isa_supported(scan_isa_t isa)
+{
+    switch (isa) {
+    case SCAN_SCALAR:
+        return true;
+#ifdef SCAN_HAVE_X86
+    case SCAN_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case SCAN_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Makes the scanner use a path, for benchmarks and for tracking
+ * down a suspect path
+ * @param isa the path
+ * @returns false if the CPU cannot run it; the path in use is unchanged
+ */
+bool scan_set_isa(scan_isa_t isa)
+{
+    if (!scan_isa_supported(isa))
+        return false;
+
+    switch (isa) {
+#ifdef SCAN_HAVE_X86
+    case SCAN_AVX2: scan_mask_impl = &scan_mask_avx2;       break;
+    case SCAN_SSE2: scan_mask_impl = &scan_mask_sse2;       break;
+#endif
+    default:        scan_mask_impl = &scan_mask_scalar;     break;
+    }
+    scan_isa_in_use = isa;
+    return true;
+}
+
+/**
+ * @brief Picks the widest path the CPU supports
+ */
+static void scan_pick_isa(void)
+{
+    if (!scan_set_isa(SCAN_AVX2) && !scan_set_isa(SCAN_SSE2))
+        scan_set_isa(SCAN_SCALAR);
+}
+
+/**
+ * @brief Picks the path on the first call, then masks the block with it
+ */
+static uint64_t scan_mask_resolve(const char *p, char a, char b)
+{
+    scan_pick_isa();
+    return scan_mask_impl(p, a, b);
+}
+
+/**
+ * @brief Gets the path the scanner uses
+ * @returns the path
+ */
+scan_isa_t scan_isa(void)
+{
+    if (scan_mask_impl == &scan_mask_resolve)
+        scan_pick_isa();
+    return scan_isa_in_use;
+}
+
+/**
+ * @brief Gets the name of a path of the scanner
+ * @param isa the path
+ * @returns the name
+ */
+const char *scan_isa_name(scan_isa_t isa)
+{
+    switch (isa) {
+    case SCAN_SSE2: return "sse2";
+    case SCAN_AVX2: return "avx2";
+    default:        return "scalar";
+    }
+}
+
+/**
+ * @brief Masks the block of a scanner at its current offset. Only a
+ * partial last block is masked a byte at a time.
+ * @param scan the scanner
+ */
+static void scan_load_block(line_scanner_t *scan)
+{
+    const char *p = &scan->buf[scan->block];
+    char b = scan->kw ? scan->kw[0] : '\n';
+    size_t left = scan->len - scan->block;
+    scan->mask = left >= SCAN_BLOCK ? scan_mask_impl(p, '\n', b) : scan_mask_tail(p, left, '\n', b);
+}
+
+/**
+ * @brief Starts reading a buffer line by line
+ * @param scan the scanner
+ * @param buf the buffer, not necessarily NUL-terminated
+ * @param len the length of the buffer
+ * @param kw the keyword to note in lines, or NULL
+ */
+void scan_init(line_scanner_t *scan, const char *buf, size_t len, const char *kw)
+{
+    memset(scan, 0, sizeof(*scan));
+    scan->buf = buf;
+    scan->len = len;
+    scan->kw = kw && *kw ? kw : NULL;
+    scan->kw_len = scan->kw ? strlen(kw) : 0;
+    if (len > 0)
+        scan_load_block(scan);
+}
+
+/**
+ * @brief Reads the next line. Only the bytes the block masks mark, the
+ * newlines and the keyword's first byte, are looked at one by one.
+ * @param scan the scanner
+ * @param line receives the line, without its newline
+ * @param has_kw receives whether the keyword is in the line; may be NULL
+ * @returns false once every line has been read
+ */
+bool scan_next_line(line_scanner_t *scan, str_slice_t *line, bool *has_kw)
+{
+    if (scan->pos >= scan->len)
+        return false;
+
+    bool found = false;
+    size_t eol = scan->len;
+    for (;;) {
+        while (scan->mask == 0) {
+            scan->block += SCAN_BLOCK;
+            if (scan->block >= scan->len)
+                goto done;
+            scan_load_block(scan);
+        }
+
+        size_t at = scan->block + __builtin_ctzll(scan->mask);
+        scan->mask &= scan->mask - 1;
+        if (scan->buf[at] == '\n') {
+            eol = at;
+            break;
+        }
+        if (!found && scan->len - at >= scan->kw_len)
+            found = memcmp(&scan->buf[at], scan->kw, scan->kw_len) == 0;
+    }
+
+done:
+    line->ptr = &scan->buf[scan->pos];
+    line->len = eol - scan->pos;
+    scan->pos = eol < scan->len ? eol + 1 : eol;
+    if (has_kw)
+        *has_kw = found;
+    return true;
+}
+
+/**
+ * @brief Starts reading lines from output that arrives in chunks
+ * @param stream the stream
+ * @param kw the keyword to note in lines, or NULL
+ * @param on_line called with each line
+ * @param ctx passed through to on_line
+ */
+void scan_stream_init(line_stream_t *stream, const char *kw, scan_line_fn on_line, void *ctx)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->kw = kw && *kw ? kw : NULL;
+    stream->on_line = on_line;
+    stream->ctx = ctx;
+}
+
+/**
+ * @brief Hands on a line that was split across chunks, once it is whole
+ * @param stream the stream
+ * @returns what on_line returns
+ */
+static bool scan_stream_flush(line_stream_t *stream)
+{
+    line_scanner_t scan;
+    str_slice_t line = { stream->partial, 0 };
+    bool has_kw = false;
+
+    /** The joined line has no newline, so it is scanned as one line */
+    scan_init(&scan, stream->partial, stream->partial_len, stream->kw);
+    scan_next_line(&scan, &line, &has_kw);
+    stream->partial_len = 0;
+    return stream->on_line(stream->ctx, line, has_kw);
+}
+
+/**
+ * @brief Feeds the next chunk of output to a stream. Matches exec_chunk_fn,
+ * so a stream can be given to exec_stream directly.
+ * @param stream the stream
+ * @param buf the chunk
+ * @param len the length of the chunk
+ * @returns false if on_line stopped the stream or memory could not be
+ * allocated (err_msg is set)
+ */
+bool scan_stream_feed(void *stream, const char *buf, size_t len)
+{
+    line_stream_t *ls = stream;
+    line_scanner_t scan;
+    str_slice_t line;
+    bool has_kw;
+
+    scan_init(&scan, buf, len, ls->kw);
+    while (scan_next_line(&scan, &line, &has_kw)) {
+        bool whole = line.ptr + line.len < buf + len;
+
+        /** The end of a line the previous chunk started */
+        if (ls->partial_len || !whole) {
+            if (ls->partial_len + line.len > ls->partial_cap) {
+                size_t cap = ls->partial_cap ? ls->partial_cap : EXEC_READ_LEN;
+                while (cap < ls->partial_len + line.len)
+                    cap *= 2;
+                char *grown = realloc(ls->partial, cap);
+                MEM_CHECK(grown, false);
+                ls->partial = grown;
+                ls->partial_cap = cap;
+            }
+            memcpy(&ls->partial[ls->partial_len], line.ptr, line.len);
+            ls->partial_len += line.len;
+            if (whole && !scan_stream_flush(ls))
+                return false;
+            continue;
+        }
+
+        if (!ls->on_line(ls->ctx, line, has_kw))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Hands on the last line of a stream if it had no newline, and frees
+ * the stream
+ * @param stream the stream
+ * @returns what on_line returns, true if there was no such line
+ */
+bool scan_stream_finish(line_stream_t *stream)
+{
+    bool ok = stream->partial_len == 0 || scan_stream_flush(stream);
+    free(stream->partial);
+    stream->partial = NULL;
+    stream->partial_cap = 0;
+    return ok;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file nsync_scan.h
+ * Splits large command output into lines 16 or 32 bytes at a time, and
+ * notes the lines holding a keyword in the same pass
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#ifndef NSYNC_SCAN_H
+#define NSYNC_SCAN_H
+
+#include "nsync_utils.h"
+
+/** GLOBAL ERROR BUFFER */
+extern char err_msg[ERR_LEN];
+
+/**********************************************************************/
+/*                             STRUCTS                                */
+/**********************************************************************/
+/**
+ * @enum scan_isa_t
+ * @brief the instruction sets the scanner has a path for
+ */
+typedef enum {
+    SCAN_SCALAR = 0,
+    SCAN_SSE2,
+    SCAN_AVX2,
+} scan_isa_t;
+
+/**
+ * @struct line_scanner
+ * @brief a position in a buffer being read line by line, and the keyword
+ * looked for in each line
+ */
+typedef struct line_scanner {
+    const char *buf;
+    size_t len;
+    size_t pos;             // start of the next line
+    size_t block;           // start of the 64 bytes the mask is for
+    uint64_t mask;          // newlines and keyword first bytes of the block not yet read
+    const char *kw;         // NULL to look for no keyword
+    size_t kw_len;
+} line_scanner_t;
+
+/** Called with each line of a stream and whether it holds the keyword; returns false to stop */
+typedef bool (*scan_line_fn)(void *ctx, str_slice_t line, bool has_kw);
+
+/**
+ * @struct line_stream
+ * @brief lines read from output that arrives in chunks. Whole lines are
+ * handed on from the chunk itself; only a line split across chunks is
+ * copied, so memory is bounded by the longest line.
+ */
+typedef struct line_stream {
+    const char *kw;
+    scan_line_fn on_line;
+    void *ctx;
+    char *partial;          // the start of a line the last chunk ended in
+    size_t partial_len;
+    size_t partial_cap;
+} line_stream_t;
+
+/**********************************************************************/
+/*                             FUNCTIONS                              */
+/**********************************************************************/
+void scan_init(line_scanner_t *scan, const char *buf, size_t len, const char *kw);
+
+bool scan_next_line(line_scanner_t *scan, str_slice_t *line, bool *has_kw);
+
+void scan_stream_init(line_stream_t *stream, const char *kw, scan_line_fn on_line, void *ctx);
+
+bool scan_stream_feed(void *stream, const char *buf, size_t len);
+
+bool scan_stream_finish(line_stream_t *stream);
+
+scan_isa_t scan_isa(void);
+
+bool scan_set_isa(scan_isa_t isa);
+
+const char *scan_isa_name(scan_isa_t isa);
+
+#endif
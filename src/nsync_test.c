@@ -0,0 +1,238 @@
+/**
+ * @file nsync_test.c
+ * Checks that the collectors describe the same network the same way. Each
+ * case builds a snapshot by hand and the matching `ip` output as text, so
+ * no commands are run and nothing is written.
+ *
+ *   make test
+ *
+ * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
+ */
+
+#include <net/if_arp.h>
+#include <linux/if_addr.h>
+#include <linux/rtnetlink.h>
+#include "nsync_collect.h"
+
+static int failures;
+
+/** Reports a check that failed, with where it is */
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/** Interned strings are equal only if they are the same pointer */
+#define CHECK_FIELD(a, b, field) CHECK((a)->field == (b)->field)
+
+/**
+ * @brief Adds an up ethernet link to the shared snapshot
+ * @param name the name of the link
+ * @param ifindex its index
+ * @returns the link, or NULL if memory could not be allocated
+ */
+static net_link_t *test_add_link(const char *name, int ifindex)
+{
+    static const unsigned char hwaddr[] = { 0x02, 0xfc, 0x00, 0x00, 0x00, 0x01 };
+
+    net_link_t *link = snapshot_add_link(&net_snapshot);
+    if (!link)
+        return NULL;
+    safe_strncpy(link->name, name, IF_NAMESIZE);
+    link->ifindex = ifindex;
+    link->type = ARPHRD_ETHER;
+    link->flags = IFF_UP;
+    link->carrier = 1;
+    link->mtu = 1500;
+    link->hwaddr_len = sizeof(hwaddr);
+    memcpy(link->hwaddr, hwaddr, sizeof(hwaddr));
+    return link;
+}
+
+/**
+ * @brief Adds a permanent IPv4 address to the shared snapshot
+ * @param ifindex the index of its link
+ * @param addr the address, dotted
+ * @param prefixlen its prefix length
+ * @param brd its broadcast address, or NULL for none
+ * @returns false if memory could not be allocated
+ */
+static bool test_add_inet(int ifindex, const char *addr, int prefixlen, const char *brd)
+{
+    net_addr_t *a = snapshot_add_addr(&net_snapshot);
+    if (!a)
+        return false;
+    a->ifindex = ifindex;
+    a->family = AF_INET;
+    a->prefixlen = prefixlen;
+    a->scope = RT_SCOPE_UNIVERSE;
+    a->flags = IFA_F_PERMANENT;
+    a->valid_lft = INFINITY_LIFE_TIME;
+    inet_pton(AF_INET, addr, a->addr);
+    if (brd) {
+        inet_pton(AF_INET, brd, a->brd);
+        a->has_brd = true;
+    }
+    return true;
+}
+
+/**
+ * @brief An address with a broadcast is printed by `ip addr` as
+ * "brd <addr> scope global"; netlink must give it the same scope.
+ */
+static void test_brd_scope_global(void)
+{
+    free_snapshot();
+    CHECK(test_add_link("eth0", 2) != NULL);
+    CHECK(test_add_inet(2, "192.0.2.2", 24, "192.0.2.255"));
+    CHECK(snapshot_select(&net_snapshot));
+
+    if_data_t *nl = snapshot_parse_active_interfaces(NULL, NULL);
+    CHECK(nl != NULL && nl->num_if == 1);
+
+    interface_t *ip = ubuntu_parse_if_details(
+        "2: eth0: <BROADCAST,MULTICAST,UP,LOWER_UP> mtu 1500 qdisc fq_codel state UP group default qlen 1000\n"
+        "    link/ether 02:fc:00:00:00:01 brd ff:ff:ff:ff:ff:ff\n"
+        "    inet 192.0.2.2/24 brd 192.0.2.255 scope global eth0\n"
+        "       valid_lft forever preferred_lft forever\n");
+    CHECK(ip != NULL);
+    if (!nl || nl->num_if != 1 || !ip)
+        return;
+
+    interface_t *if_ = nl->interfaces[0];
+    CHECK(ip->scope != NULL && strcmp(ip->scope, "global") == 0);
+    CHECK_FIELD(if_, ip, name);
+    CHECK_FIELD(if_, ip, linktype);
+    CHECK_FIELD(if_, ip, hwaddress);
+    CHECK_FIELD(if_, ip, mtu);
+    CHECK_FIELD(if_, ip, scope);
+    CHECK_FIELD(if_, ip, auto_opt);
+    CHECK(ip_addr_eq(&if_->address, &ip->address));
+    CHECK(ip_addr_eq(&if_->netmask, &ip->netmask));
+    CHECK(ip_addr_eq(&if_->broadcast, &ip->broadcast));
+}
+
+/**
+ * @brief Links are found by index and by name through the index built by
+ * snapshot_select, and each notes its first address of each family
+ */
+static void test_link_index(void)
+{
+    char name[IF_NAMESIZE];
+
+    free_snapshot();
+    for (int i = 1; i <= 200; i++) {
+        snprintf(name, sizeof(name), "eth%d", i);
+        CHECK(test_add_link(name, i * 7) != NULL);
+    }
+    CHECK(test_add_inet(700, "192.0.2.1", 24, NULL));
+    CHECK(test_add_inet(14, "192.0.2.2", 24, NULL));
+    CHECK(test_add_inet(700, "192.0.2.3", 24, NULL));
+    CHECK(snapshot_select(&net_snapshot));
+    CHECK(net_snapshot.num_slots >= 2 * net_snapshot.num_links);
+
+    for (int i = 1; i <= 200; i++) {
+        snprintf(name, sizeof(name), "eth%d", i);
+        const net_link_t *link = snapshot_link_by_index(&net_snapshot, i * 7);
+        CHECK(link != NULL && strcmp(link->name, name) == 0);
+        CHECK(snapshot_find_link(&net_snapshot, name) == link);
+    }
+    CHECK(snapshot_link_by_index(&net_snapshot, 3) == NULL);
+    CHECK(snapshot_find_link(&net_snapshot, "eth0") == NULL);
+
+    const net_link_t *link = snapshot_find_link(&net_snapshot, "eth100");
+    CHECK(link != NULL && link->inet == 1 && link->inet6 == 0);
+    link = snapshot_find_link(&net_snapshot, "eth2");
+    CHECK(link != NULL && link->inet == 2);
+    link = snapshot_find_link(&net_snapshot, "eth1");
+    CHECK(link != NULL && link->inet == 0);
+}
+
+/**
+ * @brief A route keeps the text it was read from exactly when rendering its
+ * record would not give the same words back
+ */
+static void test_route_verbatim(void)
+{
+    static const char *const lines[] = {
+        "default via 192.0.2.1 dev eth0",
+        "default via 192.0.2.1 dev eth0 proto dhcp src 192.0.2.2 metric 100",
+        "192.0.2.0/24 dev eth0 proto kernel scope link src 192.0.2.2",
+        "10.0.0.1 dev eth0 scope link",
+        "10.0.0.0/8 via 192.0.2.1 dev eth0 table 100 onlink",
+        "blackhole 10.1.0.0/16",
+        "unreachable 10.2.0.0/16 metric 5 dead linkdown",
+        "  default   via 192.0.2.1\tdev eth0  ",
+        "0.0.0.0/0 via 192.0.2.1 dev eth0",
+        "10.0.0.1/32 dev eth0",
+        "10.0.0.0/08 dev eth0",
+        "default dev eth0 via 192.0.2.1",
+        "default via 192.0.2.1 dev eth0 table main",
+        "default via 192.0.2.1 dev eth0 table 254",
+        "default via 192.0.2.1 dev eth0 table local",
+        "default via 192.0.2.1 dev eth0 table 0100",
+        "default via 192.0.2.1 dev eth0 proto boot",
+        "default via 192.0.2.1 dev eth0 proto 4",
+        "default via 192.0.2.1 dev eth0 proto 200",
+        "default via 192.0.2.1 dev eth0 proto 0200",
+        "default via 192.0.2.1 dev eth0 scope global",
+        "default via 192.0.2.1 dev eth0 scope 253",
+        "default via 192.0.2.1 dev eth0 scope 7",
+        "default via 192.0.2.1 dev eth0 scope nosuch",
+        "default via 192.0.2.1 dev eth0 priority 10",
+        "default via 192.0.2.1 dev eth0 metric 010",
+        "default via 192.0.2.1 dev eth0 onlink onlink",
+        "default via 192.0.2.1 dev eth0 mtu 1400",
+    };
+    char buf[ROUTE_TEXT_LEN];
+
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+        route_t rt;
+        CHECK(route_parse(slice_make(lines[i]), &rt));
+
+        /** The words of the line against the words of the record's rendering */
+        str_slice_t a, b, rest_a = slice_make(lines[i]);
+        str_slice_t rest_b = { buf, rt.family == AF_INET ? route_render(&rt, buf, sizeof(buf)) : 0 };
+        bool same = rt.family == AF_INET;
+        while (same) {
+            bool more_a = slice_next(&rest_a, ROUTE_DELIM, &a);
+            bool more_b = slice_next(&rest_b, ROUTE_DELIM, &b);
+            if (!more_a || !more_b) {
+                same = more_a == more_b;
+                break;
+            }
+            same = a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0;
+        }
+        if (same != (rt.raw == NULL))
+            fprintf(stderr, "%s:%d: route kept as text %s: %s\n", __FILE__, __LINE__,
+                    rt.raw ? "needlessly" : "wrongly not", lines[i]);
+        CHECK(same == (rt.raw == NULL));
+    }
+}
+
+int main(void)
+{
+    arena_t arena = { 0 };
+    intern_table_t strings = { 0 };
+    parse_arena = &arena;
+    parse_strings = &strings;
+
+    test_brd_scope_global();
+    test_link_index();
+    test_route_verbatim();
+
+    free_snapshot();
+    route_devs_free();
+    arena_reset(&arena);
+    intern_reset(&strings);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
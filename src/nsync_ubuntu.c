@@ -8,6 +8,8 @@
  */
 
 #include "nsync_ubuntu.h"
+#include "nsync_collect.h"
+#include "nsync_dhcp.h"
 #include <time.h>
 
 state_func_t ubuntu_state_funcs = {
@@ -30,6 +32,208 @@ cmd_list_t ubuntu_cmd_list = {
     .get_routes = "ip route",
 };
 
+/**
+ * @brief Gets the prefix length of an interface's address: the one written
+ * with the address as <addr>/<len>, otherwise the length of its netmask
+ * 
+ * @param if_ the interface
+ * @returns the prefix length, or -1 if the interface has none
+ */
+static int ubuntu_if_prefix_len(const interface_t *if_)
+{
+    if (IP_ADDR_IS_SET(if_->address) && if_->address.prefix_len != IP_NO_PREFIX)
+        return if_->address.prefix_len;
+    return ip_netmask_len(&if_->netmask);
+}
+
+
+/**
+ * @brief Fills the compared fields of a list of interfaces into a table,
+ * one row per interface
+ * 
+ * @param table the table, with UBUNTU_NUM_COLS columns and a row per interface
+ * @param ifs the interfaces
+ */
+static void ubuntu_fill_if_table(if_table_t *table, if_data_t *ifs)
+{
+    for (int i = 0; i < ifs->num_if; i++) {
+        interface_t *if_ = ifs->interfaces[i];
+
+        /** Strings are interned, so a string's pointer stands for its value */
+        IF_CELL(table, UBUNTU_COL_NAME, i) = (uintptr_t)if_->name;
+        IF_CELL(table, UBUNTU_COL_LINKTYPE, i) = (uintptr_t)if_->linktype;
+        IF_CELL(table, UBUNTU_COL_HWADDRESS, i) = (uintptr_t)if_->hwaddress;
+        IF_CELL(table, UBUNTU_COL_MTU, i) = (uintptr_t)if_->mtu;
+        IF_CELL(table, UBUNTU_COL_SCOPE, i) = (uintptr_t)if_->scope;
+        IF_CELL(table, UBUNTU_COL_AUTO_OPT, i) = if_->auto_opt;
+
+        /** The mask is compared by its length however it is written */
+        IF_CELL(table, UBUNTU_COL_PREFIX_LEN, i) = (uint64_t)ubuntu_if_prefix_len(if_);
+        IF_CELL(table, UBUNTU_COL_NUM_ROUTES, i) = if_->mapped_routes.num_routes;
+        if_table_set_addr(table, UBUNTU_COL_ADDRESS, i, &if_->address);
+        if_table_set_addr(table, UBUNTU_COL_BROADCAST, i, &if_->broadcast);
+    }
+}
+
+
+/**
+ * @brief Writes the stanza of an interface, followed by a blank line
+ * 
+ * @param fp the interfaces file being built
+ * @param if_ the interface
+ */
+static void ubuntu_write_stanza(FILE *fp, const interface_t *if_)
+{
+    char route[ROUTE_TEXT_LEN];
+    char addr[IP_ADDR_STR_LEN];
+
+    /** An auto line with no iface stanza has no method */
+    bool is_static = if_->linktype && strcmp("static", if_->linktype) == 0;
+
+    if (if_->auto_opt)
+        fprintf(fp, "auto %s\n", if_->name);
+
+    if (if_->linktype)
+        fprintf(fp, "iface %s inet %s\n", if_->name, if_->linktype);
+
+    if (is_static){
+        if (IP_ADDR_IS_SET(if_->address))
+            fprintf(fp, "address %s\n", ip_addr_str(&if_->address, addr));
+
+        if (IP_ADDR_IS_SET(if_->netmask))
+            fprintf(fp, "netmask %s\n", ip_addr_str(&if_->netmask, addr));
+
+        if (IP_ADDR_IS_SET(if_->broadcast))
+            fprintf(fp, "broadcast %s\n", ip_addr_str(&if_->broadcast, addr));
+
+        if (if_->metric)
+            fprintf(fp, "metric %s\n", if_->metric);
+
+        if (if_->hwaddress)
+            fprintf(fp, "hwaddress %s\n", if_->hwaddress);
+
+        if (IP_ADDR_IS_SET(if_->gateway))
+            fprintf(fp, "gateway %s\n", ip_addr_str(&if_->gateway, addr));
+
+        if (if_->mtu)
+            fprintf(fp, "mtu %s\n", if_->mtu);
+
+        if (if_->scope)
+            fprintf(fp, "scope %s\n", if_->scope);
+    }
+
+    /** Lines nsync does not manage are kept whatever the method */
+    if (if_->unmanaged)
+        fprintf(fp, "%s", if_->unmanaged);
+
+    if (is_static){
+        for (int j = 0; j < if_->mapped_routes.num_routes; j++) {
+            fprintf(fp, "up ip route add %s\n", route_str(&if_->mapped_routes.routes[j], route));
+        }
+    }
+    fprintf(fp, "\n");
+}
+
+
+/**
+ * @brief Writes a persisted stanza back byte for byte as it was read,
+ * followed by a blank line
+ * 
+ * @param fp the interfaces file being built
+ * @param if_ the persisted interface
+ */
+static void ubuntu_write_raw_stanza(FILE *fp, const interface_t *if_)
+{
+    fwrite(if_->stanza.ptr, 1, if_->stanza.len, fp);
+    if (if_->stanza.len && if_->stanza.ptr[if_->stanza.len - 1] != '\n')
+        fprintf(fp, "\n");
+    fprintf(fp, "\n");
+}
+
+
+/**
+ * @brief Opens the temp config file to append the next synced stanza. The
+ * kept stanzas that came before it in the persisted file are written first,
+ * so they stay where they were.
+ * 
+ * @param info A struct containing all of the info related to the nsync utility
+ * @param pos how many synced stanzas are already written, INT_MAX to write
+ * every kept stanza that is left
+ * @returns the file, or NULL if it could not be opened
+ */
+static FILE *ubuntu_open_tmp(net_sync_info_t *info, int pos)
+{
+    char cfg_file[FILENAME_MAX];
+    sprintf(cfg_file, "%s%s.tmp", CFG_FILE_LOC, CFG_FILE);
+
+    FILE *fp = fopen(cfg_file, "a");
+    if (fp == NULL){
+        sprintf(err_msg, "could not open file '%s' for appending", cfg_file);
+        return NULL;
+    }
+
+    ubuntu_net_cfg_t *net_config = UBUNTU_NET_CONFIG;
+    while (net_config->kept_written < UBUNTU_KEPT_IF_NUM &&
+           net_config->kept_pos[net_config->kept_written] <= pos)
+        ubuntu_write_raw_stanza(fp, UBUNTU_KEPT_IFS->interfaces[net_config->kept_written++]);
+    return fp;
+}
+
+
+/**
+ * @brief Moves the persisted interfaces that the run leaves alone out of
+ * the persistent list, noting where each one sat among the others, and
+ * starts a new temp config file with the lines that are outside any
+ * stanza. The kept stanzas are written back as they were read, in place,
+ * as the synced ones are appended.
+ * 
+ * @param info A struct containing all of the info related to the nsync utility
+ * @returns false if memory could not be allocated or the file written
+ */
+static bool ubuntu_keep_withheld(net_sync_info_t *info)
+{
+    UBUNTU_KEPT_IFS = arena_alloc(&info->arena, sizeof(if_data_t));
+    MEM_CHECK(UBUNTU_KEPT_IFS, false);
+    ubuntu_net_cfg_t *net_config = UBUNTU_NET_CONFIG;
+    int cap_pos = 0;
+
+    int num = 0;
+    for (int i = 0; i < UBUNTU_PERSIST_IF_NUM; i++) {
+        if (!if_is_withheld(UBUNTU_PERSIST_IF_LIST_NAME(i))) {
+            UBUNTU_PERSIST_IF_LIST_NAME(num) = UBUNTU_PERSIST_IF_LIST_NAME(i);
+            UBUNTU_PERSIST_INTERFACE(num++) = UBUNTU_PERSIST_INTERFACE(i);
+            continue;
+        }
+        net_config->kept_pos = arena_array_grow(&info->arena, net_config->kept_pos, &cap_pos,
+                                                UBUNTU_KEPT_IF_NUM + 1, sizeof(int));
+        if (!net_config->kept_pos || !if_data_reserve(UBUNTU_KEPT_IFS, UBUNTU_KEPT_IF_NUM + 1))
+            return false;
+        net_config->kept_pos[UBUNTU_KEPT_IF_NUM] = num;
+        UBUNTU_KEPT_IFS->if_name_list[UBUNTU_KEPT_IF_NUM] = UBUNTU_PERSIST_IF_LIST_NAME(i);
+        UBUNTU_KEPT_IFS->interfaces[UBUNTU_KEPT_IF_NUM++] = UBUNTU_PERSIST_INTERFACE(i);
+    }
+    UBUNTU_PERSIST_IF_NUM = num;
+
+    char cfg_file[FILENAME_MAX];
+    sprintf(cfg_file, "%s%s.tmp", CFG_FILE_LOC, CFG_FILE);
+    FILE *fp = fopen(cfg_file, "w");
+    if (fp == NULL){
+        sprintf(err_msg, "could not open file '%s' for writing", cfg_file);
+        return false;
+    }
+    /** Kept with a blank line after them, like every stanza */
+    const char *top = UBUNTU_PERSIST_IFS->top;
+    if (top) {
+        size_t len = strlen(top);
+        fprintf(fp, "%s", top);
+        if (len < 2 || top[len - 2] != '\n')
+            fprintf(fp, "\n");
+    }
+    fclose(fp);
+    return true;
+}
+
+
 /**
  * @brief Gets all information about the current persistent network configuration files
  * and information about the active network configuration and stores all the data in the
@@ -43,43 +247,58 @@ nsync_state_t ubuntu_get_config(net_sync_info_t *info)
 {
     ubuntu_parse_func_t *parsers = (ubuntu_parse_func_t *)info->parsers;
 
-    info->net_config = calloc(1, sizeof(ubuntu_net_cfg_t));
+    info->net_config = arena_alloc(&info->arena, sizeof(ubuntu_net_cfg_t));
     MEM_CHECK(info->net_config, NSYNC_ERROR);
+
+    /** Collectors that gather everything in one pass do so up front */
+    if (parsers->collect && !parsers->collect(info->cmd_list)) return NSYNC_ERROR;
     
     /** Get Active Interfaces */
     UBUNTU_ACTIVE_IFS = parsers->ubuntu_parse_active_interfaces(UBUNTU_GET_IF_LIST, UBUNTU_GET_ACTIVE_IF_CFG);
     if (!UBUNTU_ACTIVE_IFS) return NSYNC_ERROR;
 
-    /** Get Active Routes */
-    UBUNTU_ACTIVE_ROUTES = parsers->ubuntu_parse_active_routes(UBUNTU_GET_ROUTES);
-    if (!UBUNTU_ACTIVE_ROUTES) return NSYNC_ERROR;
+    /** Get Active Routes, mapped to the Active Interfaces */
+    if (parsers->ubuntu_stream_routes) {
+        /** Read straight into the interfaces' route lists; only their routes are held */
+        if (!parsers->ubuntu_stream_routes(UBUNTU_GET_ROUTES, UBUNTU_ACTIVE_IFS)) return NSYNC_ERROR;
+    } else {
+        UBUNTU_ACTIVE_ROUTES = parsers->ubuntu_parse_active_routes(UBUNTU_GET_ROUTES);
+        if (!UBUNTU_ACTIVE_ROUTES) return NSYNC_ERROR;
 
-    /** Map Active Routes to Active Interfaces */
-    if(!parsers->ubuntu_map_routes(UBUNTU_ACTIVE_IFS, UBUNTU_ACTIVE_ROUTES)){
-        return NSYNC_ERROR;
+        /** Map Active Routes to Active Interfaces */
+        if(!parsers->ubuntu_map_routes(UBUNTU_ACTIVE_IFS, UBUNTU_ACTIVE_ROUTES)){
+            return NSYNC_ERROR;
+        }
     }
 
-    /** Get saved routes */
-    char route_file[FILENAME_MAX];
-    sprintf(route_file, "%s%s", CFG_FILE_LOC, ROUTE_FILE);
-    UBUNTU_PERSIST_ROUTES = parsers->ubuntu_parse_persist_routes(route_file);
-    if (!UBUNTU_PERSIST_ROUTES) return NSYNC_ERROR;
-
-    /** Get saved Inferface Configs */
+    /** Get saved Inferface Configs and their routes, already mapped */
     char if_file[FILENAME_MAX];
     sprintf(if_file, "%s%s", CFG_FILE_LOC, CFG_FILE);
     UBUNTU_PERSIST_IFS = parsers->ubuntu_parse_persist_interfaces(if_file);
     if (!UBUNTU_PERSIST_IFS) return NSYNC_ERROR;
 
-    /** Map Persistent Routes to Persistent Interfaces */
-    if(!parsers->ubuntu_map_routes(UBUNTU_PERSIST_IFS, UBUNTU_PERSIST_ROUTES)){
-        return NSYNC_ERROR;
-    }
+    /** Interfaces the run leaves alone are not compared, only written back */
+    if (!ubuntu_keep_withheld(info)) return NSYNC_ERROR;
+
+    if (!bitset_init(&info->synced, UBUNTU_ACTIVE_IF_NUM, &info->arena)) return NSYNC_ERROR;
 
+    /** Compare every interface's fields at once; lists of different lengths are rewritten whole */
+    if (UBUNTU_ACTIVE_IF_NUM == UBUNTU_PERSIST_IF_NUM) {
+        if_table_t active, persist;
+        if (!if_table_init(&active, UBUNTU_NUM_COLS, UBUNTU_ACTIVE_IF_NUM, &info->arena) ||
+            !if_table_init(&persist, UBUNTU_NUM_COLS, UBUNTU_PERSIST_IF_NUM, &info->arena))
+            return NSYNC_ERROR;
+        ubuntu_fill_if_table(&active, UBUNTU_ACTIVE_IFS);
+        ubuntu_fill_if_table(&persist, UBUNTU_PERSIST_IFS);
+
+        UBUNTU_NET_CONFIG->if_diff = if_table_diff(&active, &persist, &info->arena);
+        if (!UBUNTU_NET_CONFIG->if_diff) return NSYNC_ERROR;
+    }
 
     /** Print some general info about what was parsed */
     if (info->verbose) {
-        system("clear;");
+        char route[ROUTE_TEXT_LEN];
+        exec_argv((char *[]){ "clear", NULL }, NULL);
         printf("##################################################################\n\n");
         printf("Found the following active interfaces:");
         for (int i = 0; i < UBUNTU_ACTIVE_IF_NUM; i++) {
@@ -97,7 +316,7 @@ nsync_state_t ubuntu_get_config(net_sync_info_t *info)
 
             printf(" has the following route(s):\n");
             for (int j = 0; j < UBUNTU_ACTIVE_IF_ROUTE_NUM(i); j++) {
-                printf("%s\n", UBUNTU_ACTIVE_IF_ROUTE(i, j));
+                printf("%s\n", route_str(&UBUNTU_ACTIVE_IF_ROUTE(i, j), route));
             }
             printf("\n");
         }
@@ -117,10 +336,18 @@ nsync_state_t ubuntu_get_config(net_sync_info_t *info)
             }
             printf(" has the following route(s):\n");
             for (int j = 0; j < UBUNTU_PERSIST_IF_ROUTE_NUM(i); j++) {
-                printf("%s\n", UBUNTU_PERSIST_IF_ROUTE(i, j));
+                printf("%s\n", route_str(&UBUNTU_PERSIST_IF_ROUTE(i, j), route));
             }
             printf("\n");
         }
+
+        if (UBUNTU_KEPT_IF_NUM) {
+            printf("Leaving the following persistent interfaces as they are:");
+            for (int i = 0; i < UBUNTU_KEPT_IF_NUM; i++) {
+                printf(" %s", UBUNTU_KEPT_IFS->if_name_list[i]);
+            }
+            printf("\n\n");
+        }
         printf("##################################################################\n\n");
     }
 
@@ -141,10 +368,7 @@ nsync_state_t ubuntu_get_unsynced(net_sync_info_t *info)
     ubuntu_net_cfg_t *net_config = (ubuntu_net_cfg_t *)info->net_config;
 
     /** Find next unsynced interface */
-    int i;
-    for (i = 0; i < net_config->active_ifs->num_if; i++) {
-        if(!info->synced[i]) break;
-    }
+    int i = bitset_first_clear(&info->synced);
 
     /** If none are unsynced then we are done! */
     if (i == net_config->active_ifs->num_if) 
@@ -198,6 +422,8 @@ nsync_state_t ubuntu_check_persistent_files(net_sync_info_t *info)
 nsync_state_t ubuntu_create_and_write_to_file(net_sync_info_t *info)
 {
     FILE * fp;
+    char route[ROUTE_TEXT_LEN];
+    char addr[IP_ADDR_STR_LEN];
     
     int i = info->next_to_sync;
 
@@ -206,15 +432,9 @@ nsync_state_t ubuntu_create_and_write_to_file(net_sync_info_t *info)
         return NSYNC_IF_SYNCED;
     }
 
-    /** Build filepath */
-    char cfg_file[FILENAME_MAX];
-    sprintf(cfg_file, "%s%s.tmp", CFG_FILE_LOC, CFG_FILE);
-    
-    fp = fopen(cfg_file, "a");
-    if (fp == NULL){
-        sprintf(err_msg, "Could not open file for writing/appending: %s", cfg_file);
+    fp = ubuntu_open_tmp(info, i);
+    if (fp == NULL)
         return NSYNC_ERROR;
-    }
     
     /** Print out details of this interface */
     if(UBUNTU_ACTIVE_IF_AUTO_OPT(i)) 
@@ -223,13 +443,14 @@ nsync_state_t ubuntu_create_and_write_to_file(net_sync_info_t *info)
     fprintf(fp, "iface %s inet %s\n", UBUNTU_ACTIVE_IF_NAME(i), UBUNTU_ACTIVE_IF_LINKTYPE(i));
     
     if (strcmp("static", UBUNTU_ACTIVE_IF_LINKTYPE(i)) == 0){
-        fprintf(fp, "address %s\n", UBUNTU_ACTIVE_IF_ADDRESS(i));
+        if (IP_ADDR_IS_SET(UBUNTU_ACTIVE_IF_ADDRESS(i))) 
+            fprintf(fp, "address %s\n", ip_addr_str(&UBUNTU_ACTIVE_IF_ADDRESS(i), addr));
         
-        if (UBUNTU_ACTIVE_IF_NETMASK(i)) 
-            fprintf(fp, "netmask %s\n", UBUNTU_ACTIVE_IF_NETMASK(i));
+        if (IP_ADDR_IS_SET(UBUNTU_ACTIVE_IF_NETMASK(i))) 
+            fprintf(fp, "netmask %s\n", ip_addr_str(&UBUNTU_ACTIVE_IF_NETMASK(i), addr));
 
-        if (UBUNTU_ACTIVE_IF_BROADCAST(i)) 
-            fprintf(fp, "broadcast %s\n", UBUNTU_ACTIVE_IF_BROADCAST(i));
+        if (IP_ADDR_IS_SET(UBUNTU_ACTIVE_IF_BROADCAST(i))) 
+            fprintf(fp, "broadcast %s\n", ip_addr_str(&UBUNTU_ACTIVE_IF_BROADCAST(i), addr));
 
         if (UBUNTU_ACTIVE_IF_METRIC(i)) 
             fprintf(fp, "metric %s\n", UBUNTU_ACTIVE_IF_METRIC(i));
@@ -237,8 +458,8 @@ nsync_state_t ubuntu_create_and_write_to_file(net_sync_info_t *info)
         if (UBUNTU_ACTIVE_IF_HWADDRESS(i)) 
             fprintf(fp, "hwaddress %s\n", UBUNTU_ACTIVE_IF_HWADDRESS(i));
 
-        if (UBUNTU_ACTIVE_IF_GATEWAY(i)) 
-            fprintf(fp, "gateway %s\n", UBUNTU_ACTIVE_IF_GATEWAY(i));
+        if (IP_ADDR_IS_SET(UBUNTU_ACTIVE_IF_GATEWAY(i))) 
+            fprintf(fp, "gateway %s\n", ip_addr_str(&UBUNTU_ACTIVE_IF_GATEWAY(i), addr));
 
         if (UBUNTU_ACTIVE_IF_MTU(i)) 
             fprintf(fp, "mtu %s\n", UBUNTU_ACTIVE_IF_MTU(i));
@@ -247,11 +468,11 @@ nsync_state_t ubuntu_create_and_write_to_file(net_sync_info_t *info)
             fprintf(fp, "scope %s\n", UBUNTU_ACTIVE_IF_SCOPE(i));
 
         if (UBUNTU_ACTIVE_IF_UNMANAGED(i)) 
-            fprintf(fp, "%s\n", UBUNTU_ACTIVE_IF_UNMANAGED(i));
+            fprintf(fp, "%s", UBUNTU_ACTIVE_IF_UNMANAGED(i));
 
         
         for (int j = 0; j < UBUNTU_ACTIVE_IF_ROUTE_NUM(i); j++) {
-            fprintf(fp, "up %s\n", UBUNTU_ACTIVE_IF_ROUTE(i,j));
+            fprintf(fp, "up ip route add %s\n", route_str(&UBUNTU_ACTIVE_IF_ROUTE(i,j), route));
         }
     }
     fclose(fp);
@@ -276,82 +497,22 @@ nsync_state_t ubuntu_compare_configs(net_sync_info_t *info)
     }
     
     int i = info->next_to_sync;
-    bool match = true;
-
-    /** 
-     * Check that values are either both null or both not null (i.e. matching)
-     * If they aren't null then check that they have the same value.
-     */
-
-    if(!(!(UBUNTU_ACTIVE_IF_NAME(i)) != !(UBUNTU_PERSIST_IF_NAME(i)))) {
-        if (UBUNTU_ACTIVE_IF_NAME(i) && strcmp(UBUNTU_PERSIST_IF_NAME(i), UBUNTU_ACTIVE_IF_NAME(i)) != 0) {
-            match = false;
-        }
-    } 
-    else 
-        match = false;
+    uint64_t diff = UBUNTU_IF_DIFF(i);
 
     /** If the interface is loopback or dhcp, then the rest of the fields dont apply */
-    if(!(!(UBUNTU_ACTIVE_IF_LINKTYPE(i)) != !(UBUNTU_PERSIST_IF_LINKTYPE(i)))) {
-        if (UBUNTU_ACTIVE_IF_LINKTYPE(i) && strcmp(UBUNTU_PERSIST_IF_LINKTYPE(i), UBUNTU_ACTIVE_IF_LINKTYPE(i)) != 0) {
-            match = false;
-        } else if (strcmp("loopback", UBUNTU_ACTIVE_IF_LINKTYPE(i)) == 0 || strcmp("dhcp", UBUNTU_ACTIVE_IF_LINKTYPE(i)) == 0){
-            return NSYNC_KEEP_EXISTING;
-        }
-    } 
-    else match = false;
-
-    if(!(!(UBUNTU_ACTIVE_IF_ADDRESS(i)) != !(UBUNTU_PERSIST_IF_ADDRESS(i)))) {
-        if (UBUNTU_ACTIVE_IF_ADDRESS(i) && strcmp(UBUNTU_PERSIST_IF_ADDRESS(i), UBUNTU_ACTIVE_IF_ADDRESS(i)) != 0) {
-            match = false;
-        }
-    } else match = false;
-
-    if(!(!(UBUNTU_ACTIVE_IF_NETMASK(i)) != !(UBUNTU_PERSIST_IF_NETMASK(i)))) {
-        if (UBUNTU_ACTIVE_IF_NETMASK(i) && strcmp(UBUNTU_PERSIST_IF_NETMASK(i), UBUNTU_ACTIVE_IF_NETMASK(i)) != 0) {
-            match = false;
-        }
-    } else match = false;
-
-    if(!(!(UBUNTU_ACTIVE_IF_BROADCAST(i)) != !(UBUNTU_PERSIST_IF_BROADCAST(i)))) {
-        if (UBUNTU_ACTIVE_IF_BROADCAST(i) && strcmp(UBUNTU_PERSIST_IF_BROADCAST(i), UBUNTU_ACTIVE_IF_BROADCAST(i)) != 0) {
-            match = false;
-        }
-    } else match = false;
-
-    if(!(!(UBUNTU_ACTIVE_IF_HWADDRESS(i)) != !(UBUNTU_PERSIST_IF_HWADDRESS(i)))) {
-        if (UBUNTU_ACTIVE_IF_HWADDRESS(i) && strcmp(UBUNTU_PERSIST_IF_HWADDRESS(i), UBUNTU_ACTIVE_IF_HWADDRESS(i)) != 0) {
-            match = false;
-        }
-    } else match = false;
-
-    if(!(!(UBUNTU_ACTIVE_IF_MTU(i)) != !(UBUNTU_PERSIST_IF_MTU(i)))) {
-        if (UBUNTU_ACTIVE_IF_MTU(i) && strcmp(UBUNTU_PERSIST_IF_MTU(i), UBUNTU_ACTIVE_IF_MTU(i)) != 0) {
-            match = false;
-        }
-    } else match = false;
-
-    if(!(!(UBUNTU_ACTIVE_IF_SCOPE(i)) != !(UBUNTU_PERSIST_IF_SCOPE(i)))) {
-        if (UBUNTU_ACTIVE_IF_SCOPE(i) && strcmp(UBUNTU_PERSIST_IF_SCOPE(i), UBUNTU_ACTIVE_IF_SCOPE(i)) != 0) {
-            match = false;
-        }  
-    } else match = false;
-
+    if (!(diff & IF_DIFF(UBUNTU_COL_LINKTYPE, 1)) && UBUNTU_ACTIVE_IF_LINKTYPE(i) &&
+        (strcmp("loopback", UBUNTU_ACTIVE_IF_LINKTYPE(i)) == 0 ||
+         strcmp("dhcp", UBUNTU_ACTIVE_IF_LINKTYPE(i)) == 0))
+        return NSYNC_KEEP_EXISTING;
 
-    if(!(UBUNTU_ACTIVE_IF_AUTO_OPT(i) != UBUNTU_PERSIST_IF_AUTO_OPT(i))) {
-        if (UBUNTU_ACTIVE_IF_AUTO_OPT(i) != UBUNTU_PERSIST_IF_AUTO_OPT(i)) {
-            match = false;
-        }
-    } else match = false;
-    
-    
-    /** Check routes */
-    if (UBUNTU_ACTIVE_IF_ROUTE_NUM(i) != UBUNTU_PERSIST_IF_ROUTE_NUM(i)){
+    /** The fields and route counts of every interface were compared together by get_config */
+    if (diff)
         return NSYNC_BACKUP;
-    }
 
+    /** Check routes */
+    bool match = true;
     for (int j = 0; j < UBUNTU_ACTIVE_IF_ROUTE_NUM(i); j++){
-        if (strcmp(UBUNTU_ACTIVE_IF_ROUTE(i,j), UBUNTU_PERSIST_IF_ROUTE(i,j)))
+        if (!route_eq(&UBUNTU_ACTIVE_IF_ROUTE(i,j), &UBUNTU_PERSIST_IF_ROUTE(i,j)))
             match= false;
     }
 
@@ -373,58 +534,13 @@ nsync_state_t ubuntu_compare_configs(net_sync_info_t *info)
  */
 nsync_state_t ubuntu_keep_existing(net_sync_info_t *info)
 {
-    char cfg_file[FILENAME_MAX];
-    
-    sprintf(cfg_file, "%s%s.tmp",CFG_FILE_LOC, CFG_FILE); 
-
     /** Open the file for appending */
-    FILE *fp = fopen(cfg_file, "a");
-    if (fp == NULL){
-        sprintf(err_msg, "could not open file '%s' for appending", cfg_file);
+    FILE *fp = ubuntu_open_tmp(info, info->next_to_sync);
+    if (fp == NULL)
         return NSYNC_ERROR;
-    }
-
-    /** Append the perisstent configuration of the interface to temp config file */
-    int i = info->next_to_sync;
-
-    if(UBUNTU_PERSIST_IF_AUTO_OPT(i)) 
-        fprintf(fp, "auto %s\n", UBUNTU_PERSIST_IF_NAME(i));
-    
-    fprintf(fp, "iface %s inet %s\n", UBUNTU_PERSIST_IF_NAME(i), UBUNTU_PERSIST_IF_LINKTYPE(i));
-    
-    if (strcmp("static", UBUNTU_PERSIST_IF_LINKTYPE(i)) == 0){
-
-        fprintf(fp, "address %s\n", UBUNTU_PERSIST_IF_ADDRESS(i));
-
-        if (UBUNTU_PERSIST_IF_NETMASK(i)) 
-            fprintf(fp, "netmask %s\n", UBUNTU_PERSIST_IF_NETMASK(i));
 
-        if (UBUNTU_PERSIST_IF_BROADCAST(i)) 
-            fprintf(fp, "broadcast %s\n", UBUNTU_PERSIST_IF_BROADCAST(i));
-
-        if (UBUNTU_PERSIST_IF_METRIC(i)) 
-            fprintf(fp, "metric %s\n", UBUNTU_PERSIST_IF_METRIC(i));
-
-        if (UBUNTU_PERSIST_IF_HWADDRESS(i)) 
-            fprintf(fp, "hwaddress %s\n", UBUNTU_PERSIST_IF_HWADDRESS(i));
-
-        if (UBUNTU_PERSIST_IF_GATEWAY(i)) 
-            fprintf(fp, "gateway %s\n", UBUNTU_PERSIST_IF_GATEWAY(i));
-
-        if (UBUNTU_PERSIST_IF_MTU(i)) 
-            fprintf(fp, "mtu %s\n", UBUNTU_PERSIST_IF_MTU(i));
-
-        if (UBUNTU_PERSIST_IF_SCOPE(i)) 
-            fprintf(fp, "scope %s\n", UBUNTU_PERSIST_IF_SCOPE(i));
-
-        if (UBUNTU_PERSIST_IF_UNMANAGED(i)) 
-            fprintf(fp, "%s", UBUNTU_PERSIST_IF_UNMANAGED(i));
-
-        for (int j = 0; j < UBUNTU_PERSIST_IF_ROUTE_NUM(i); j++) {
-            fprintf(fp, "up ip route add %s\n", UBUNTU_PERSIST_IF_ROUTE(i,j));
-        }
-    }
-    fprintf(fp, "\n");
+    /** Append the perisstent configuration of the interface to temp config file, as it was read */
+    ubuntu_write_raw_stanza(fp, UBUNTU_PERSIST_INTERFACE(info->next_to_sync));
 
     fclose(fp);
 
@@ -473,23 +589,19 @@ nsync_state_t ubuntu_backup_files(net_sync_info_t *info)
     }
 
     if (!dir_check(full_path)){
-        char mkdir_cmd[MAX_CMD_LEN];
-        sprintf(mkdir_cmd, "mkdir %s", full_path);
-        if (system(mkdir_cmd) == -1){
-            sprintf(err_msg, "command `%s` failed", mkdir_cmd);
+        if (mkdir(full_path, 0777) != 0){
+            sprintf(err_msg, "could not create directory %s: %s", full_path, strerror(errno));
             return NSYNC_ERROR;
-        }        
+        }
         info->backup.started = true;
     }
 
-    char *backup_cmd_fmt = "cp %s %s";
-    char backup_cmd[MAX_CMD_LEN];
     char backup_file[FILENAME_MAX];
     sprintf(backup_file, "%s%s", CFG_FILE_LOC, CFG_FILE);
-    sprintf(backup_cmd, backup_cmd_fmt, backup_file, full_path);
+    char *backup_argv[] = { "cp", backup_file, full_path, NULL };
 
-    if (system(backup_cmd) == -1){
-        sprintf(err_msg, "command `%s` failed", backup_cmd);
+    if (exec_argv(backup_argv, NULL) != 0){
+        sprintf(err_msg, "could not copy %s to %s", backup_file, full_path);
         return NSYNC_ERROR;
     }
     info->backup.complete = true;
@@ -509,7 +621,7 @@ nsync_state_t ubuntu_mark_synced(net_sync_info_t *info)
     if(info->verbose){
         printf("Done syncing interface\n\n");
     }
-    info->synced[info->next_to_sync++] = true;
+    bitset_set(&info->synced, info->next_to_sync++);
     return NSYNC_GET_UNSYNCED;
 }
 
@@ -525,55 +637,11 @@ nsync_state_t ubuntu_mark_synced(net_sync_info_t *info)
  */
 nsync_state_t ubuntu_overwrite_configs(net_sync_info_t *info)
 {
-    char cfg_file[FILENAME_MAX];
-    
-    sprintf(cfg_file, "%s%s.tmp",CFG_FILE_LOC, CFG_FILE); 
-
-    FILE *fp = fopen(cfg_file, "a");
-    if (fp == NULL){
-        sprintf(err_msg, "could not open file '%s' for appending", cfg_file);
+    FILE *fp = ubuntu_open_tmp(info, info->next_to_sync);
+    if (fp == NULL)
         return NSYNC_ERROR;
-    }
-
-    int i = info->next_to_sync;
-
-    if(UBUNTU_ACTIVE_IF_AUTO_OPT(i)) 
-        fprintf(fp, "auto %s\n", UBUNTU_ACTIVE_IF_NAME(i));
-
-    fprintf(fp, "iface %s inet %s\n", UBUNTU_ACTIVE_IF_NAME(i), UBUNTU_ACTIVE_IF_LINKTYPE(i));
-    
-    if (strcmp("static", UBUNTU_ACTIVE_IF_LINKTYPE(i)) == 0){
-        fprintf(fp, "address %s\n", UBUNTU_ACTIVE_IF_ADDRESS(i));
-
-        if (UBUNTU_ACTIVE_IF_NETMASK(i)) 
-            fprintf(fp, "netmask %s\n", UBUNTU_ACTIVE_IF_NETMASK(i));
-
-        if (UBUNTU_ACTIVE_IF_BROADCAST(i)) 
-            fprintf(fp, "broadcast %s\n", UBUNTU_ACTIVE_IF_BROADCAST(i));
-
-        if (UBUNTU_ACTIVE_IF_METRIC(i)) 
-            fprintf(fp, "metric %s\n", UBUNTU_ACTIVE_IF_METRIC(i));
 
-        if (UBUNTU_ACTIVE_IF_HWADDRESS(i)) 
-            fprintf(fp, "hwaddress %s\n", UBUNTU_ACTIVE_IF_HWADDRESS(i));
-
-        if (UBUNTU_ACTIVE_IF_GATEWAY(i)) 
-            fprintf(fp, "gateway %s\n", UBUNTU_ACTIVE_IF_GATEWAY(i));
-
-        if (UBUNTU_ACTIVE_IF_MTU(i)) 
-            fprintf(fp, "mtu %s\n", UBUNTU_ACTIVE_IF_MTU(i));
-
-        if (UBUNTU_ACTIVE_IF_SCOPE(i)) 
-            fprintf(fp, "scope %s\n", UBUNTU_ACTIVE_IF_SCOPE(i));
-
-        if (UBUNTU_ACTIVE_IF_UNMANAGED(i)) 
-            fprintf(fp, "%s", UBUNTU_ACTIVE_IF_UNMANAGED(i));
-
-        for (int j = 0; j < UBUNTU_ACTIVE_IF_ROUTE_NUM(i); j++) {
-            fprintf(fp, "up ip route add %s\n", UBUNTU_ACTIVE_IF_ROUTE(i,j));
-        }
-    }
-    fprintf(fp, "\n");
+    ubuntu_write_stanza(fp, UBUNTU_ACTIVE_INTERFACE(info->next_to_sync));
 
     fclose(fp);
 
@@ -596,43 +664,33 @@ nsync_state_t ubuntu_cleanup_and_free(net_sync_info_t *info)
         printf("Syncing complete!\n\n");
     }
 
+    /** Kept stanzas that came after every synced one go last */
+    FILE *fp = ubuntu_open_tmp(info, INT_MAX);
+    if (fp == NULL)
+        return NSYNC_ERROR;
+    fclose(fp);
+
     /** Overwrite/replace the cfg file with the tmp one that has the most updated details */
-    char cmd[FILENAME_MAX];
-    sprintf(cmd, "mv %s%s.tmp %s%s", CFG_FILE_LOC, CFG_FILE, CFG_FILE_LOC, CFG_FILE);
-    if (system(cmd) == -1){
-        sprintf(err_msg, "command `%s` failed", cmd);
+    char tmp_file[FILENAME_MAX];
+    char cfg_file[FILENAME_MAX];
+    sprintf(tmp_file, "%s%s.tmp", CFG_FILE_LOC, CFG_FILE);
+    sprintf(cfg_file, "%s%s", CFG_FILE_LOC, CFG_FILE);
+    if (rename(tmp_file, cfg_file) != 0){
+        sprintf(err_msg, "could not move %s to %s: %s", tmp_file, cfg_file, strerror(errno));
         return NSYNC_ERROR;
-    } 
+    }
 
     /** Free sys info */
     free(info->sys.os_str);
 
-    for (int i = 0; i < UBUNTU_ACTIVE_ROUTES_NUM; i++){
-        free(UBUNTU_ACTIVE_ROUTE(i));
-    }
-    for (int i = 0; i < UBUNTU_PERSIST_ROUTE_NUM; i++){
-        free(UBUNTU_PERSIST_ROUTE(i));
-    }
-
-    /** Free network config stuff */
-    for (int i = 0; i < UBUNTU_ACTIVE_IF_NUM; i++) {
-        free(UBUNTU_ACTIVE_IF_LIST_NAME(i));
-
-        free_interface(UBUNTU_ACTIVE_INTERFACE(i));
-        free(UBUNTU_ACTIVE_INTERFACE(i));
-    }
-    for (int i = 0; i < UBUNTU_PERSIST_IF_NUM; i++) {
-        free(UBUNTU_PERSIST_IF_LIST_NAME(i));
-
-        free_interface(UBUNTU_PERSIST_INTERFACE(i));
-        free(UBUNTU_PERSIST_INTERFACE(i));
-    }
-
-    free(UBUNTU_ACTIVE_IFS);
-    free(UBUNTU_PERSIST_IFS);
-    free(UBUNTU_ACTIVE_ROUTES);
-    free(UBUNTU_PERSIST_ROUTES);
-    free(UBUNTU_NET_CONFIG);
+    /** Everything parsed is released at once */
+    arena_reset(&info->arena);
+    intern_reset(&info->strings);
+    info->net_config = NULL;
+    free_snapshot();
+    free_dhcp();
+    route_devs_free();
+    exec_cache_free();
     
     return NSYNC_SUCCESS;
 }
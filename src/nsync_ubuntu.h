@@ -15,14 +15,32 @@
 /*                            NET CONFIGS                             */
 /**********************************************************************/
 typedef struct ubuntu_network_config {
-    route_list_t *persist_routes;
     route_list_t *active_routes;
 
     if_data_t *persist_ifs;
     if_data_t *active_ifs;
+    if_data_t *kept_ifs;    // persisted interfaces the run leaves alone, written back as they are
+    int *kept_pos;          // per kept interface, how many synced stanzas came before it in the file
+    int kept_written;       // kept stanzas already written to the temp file
+    uint64_t *if_diff;      // per interface, the IF_DIFF bits of the fields that differ
 
 }ubuntu_net_cfg_t;
 
+/** Columns of the fields compared between active and persistent interfaces */
+typedef enum {
+    UBUNTU_COL_NAME,
+    UBUNTU_COL_LINKTYPE,
+    UBUNTU_COL_HWADDRESS,
+    UBUNTU_COL_MTU,
+    UBUNTU_COL_SCOPE,
+    UBUNTU_COL_AUTO_OPT,
+    UBUNTU_COL_PREFIX_LEN,
+    UBUNTU_COL_NUM_ROUTES,
+    UBUNTU_COL_ADDRESS,
+    UBUNTU_COL_BROADCAST = UBUNTU_COL_ADDRESS + IF_TABLE_ADDR_COLS,
+    UBUNTU_NUM_COLS = UBUNTU_COL_BROADCAST + IF_TABLE_ADDR_COLS
+} ubuntu_col_t;
+
 
 extern cmd_list_t ubuntu_cmd_list;
 
@@ -39,13 +57,11 @@ extern cmd_list_t ubuntu_cmd_list;
 /**********************************************************************/
 #define UBUNTU_NET_CONFIG              ((ubuntu_net_cfg_t *)info->net_config)
 
-#define UBUNTU_PERSIST_ROUTES          UBUNTU_NET_CONFIG->persist_routes
-#define UBUNTU_PERSIST_ROUTE_NUM       UBUNTU_NET_CONFIG->persist_routes->num_routes
-#define UBUNTU_PERSIST_ROUTE(i)        UBUNTU_NET_CONFIG->persist_routes->routes[i]
 
 #define UBUNTU_ACTIVE_ROUTES           UBUNTU_NET_CONFIG->active_routes
 #define UBUNTU_ACTIVE_ROUTES_NUM       UBUNTU_NET_CONFIG->active_routes->num_routes
 #define UBUNTU_ACTIVE_ROUTE(i)         UBUNTU_NET_CONFIG->active_routes->routes[i]
+#define UBUNTU_IF_DIFF(i)              UBUNTU_NET_CONFIG->if_diff[i]
 
 #define UBUNTU_PERSIST_IFS             UBUNTU_NET_CONFIG->persist_ifs
 #define UBUNTU_PERSIST_IF_NAME_LIST    UBUNTU_NET_CONFIG->persist_ifs->if_name_list
@@ -70,6 +86,9 @@ extern cmd_list_t ubuntu_cmd_list;
 #define UBUNTU_PERSIST_IF_ROUTE_NUM(i) IF_I_ROUTE_NUM(UBUNTU_PERSIST_INTERFACES, i)
 #define UBUNTU_PERSIST_IF_ROUTE(i,j)   IF_I_ROUTE_J(UBUNTU_PERSIST_INTERFACES, i, j)
 
+#define UBUNTU_KEPT_IFS                UBUNTU_NET_CONFIG->kept_ifs
+#define UBUNTU_KEPT_IF_NUM             UBUNTU_NET_CONFIG->kept_ifs->num_if
+
 #define UBUNTU_ACTIVE_IFS              UBUNTU_NET_CONFIG->active_ifs
 #define UBUNTU_ACTIVE_IF_NAME_LIST     UBUNTU_NET_CONFIG->active_ifs->if_name_list
 #define UBUNTU_ACTIVE_IF_LIST_NAME(i)  UBUNTU_NET_CONFIG->active_ifs->if_name_list[i]
@@ -9,72 +9,134 @@
  */
 
 #include "nsync_ubuntu_parse.h"
+#include "nsync_collect.h"
+#include "nsync_dhcp.h"
+#include "nsync_keywords.h"
+#include "nsync_scan.h"
 
 ubuntu_parse_func_t ubuntu_parsers = {
+    .collect                            = NULL,
     .ubuntu_parse_active_interfaces     = &ubuntu_parse_active_interfaces,
     .ubuntu_parse_active_routes         = &ubuntu_parse_active_routes,
     .ubuntu_parse_persist_interfaces    = &ubuntu_parse_persist_interfaces,
-    .ubuntu_parse_persist_routes        = &ubuntu_parse_persist_routes,
     .ubuntu_map_routes                  = &map_routes_to_if,
+    .ubuntu_stream_routes               = &ubuntu_stream_routes,
 };
 
 /**
- * @brief Cleans up the output of a file and stores it in a buffer.
- * Specifically used to clean the output for centos_parse_ip_show.
- * NOTE: Not for general use.
+ * @brief Makes room for a number of interfaces in both lists of an if_data_t
  * 
- * @param fp the file pointer to an open data stream
- * @param out_buff the buffer to store the cleaned-up file contents
+ * @param ifs the interfaces
+ * @param num_if the number of interfaces the lists must hold
+ * 
+ * @returns boolean that is true if successful and false if there was an error
  */
-static void clean_output(FILE *fp, char *out_buff)
+bool if_data_reserve(if_data_t *ifs, int num_if)
 {
-    char line[MAX_OUTPUT_LEN];
-
-    int offset = 0;
-    
-    /** 
-     * Make output all on single line
-     * Replace all newlines with spaces
-     */
-    while(fgets(line, MAX_OUTPUT_LEN, fp))
-    {
-        char *pchar = strchr(line, '\n');
-        if(pchar){
-            *pchar = ' ';
-        }
-        safe_strncpy(&out_buff[offset], line, MAX_OUTPUT_LEN - offset);
-        offset += strlen(line);
-    }
-    
-    /** strip all extra spaces */
-    int i, x;
-    for(i=0, x=0; out_buff[i]; i++){
-        if(!isspace(out_buff[i]) || (i > 0 && !isspace(out_buff[i-1])))
-            out_buff[x++] = out_buff[i];
-    }
-    out_buff[x] = '\0';
+    int cap = ifs->cap_if;
+    ifs->if_name_list = arena_array_grow(parse_arena, ifs->if_name_list, &cap, num_if, sizeof(const char *));
+    if (!ifs->if_name_list)
+        return false;
+
+    cap = ifs->cap_if;
+    ifs->interfaces = arena_array_grow(parse_arena, ifs->interfaces, &cap, num_if, sizeof(interface_t *));
+    if (!ifs->interfaces)
+        return false;
+
+    ifs->cap_if = cap;
+    return true;
 }
 
-static bool is_up(const char *interface)
+/**
+ * @brief Parses the output of `ip addr show <if>` into an interface. The
+ * words are sliced out of the output where they are, however long it is.
+ * 
+ * @param out the output of the command
+ * 
+ * @returns the interface, or NULL if memory could not be allocated
+ */
+interface_t *ubuntu_parse_if_details(const char *out)
 {
-    char cmd[MAX_CMD_LEN];
-    sprintf(cmd, "ethtool %s 2> /dev/null", interface);
+    interface_t *if_ = arena_alloc(parse_arena, sizeof(interface_t));
+    MEM_CHECK(if_, NULL);
+
+    /** "<n>: <name>[@<parent>]: ..." */
+    str_slice_t rest = slice_make(out), word;
+    slice_next(&rest, CMD_OUT_DELIM, &word);
+    slice_next(&rest, CMD_OUT_DELIM, &word);
+    if_->name = slice_intern(slice_field(slice_trim(word, ":"), 1, "@"));
+    MEM_CHECK(if_->name, NULL);
+
+    /** Dispatch on each word, keeping the first of each field */
+    bool in_inet = false;
+    while (slice_next(&rest, CMD_OUT_DELIM, &word)) {
+        /** link/<type> is looked up by the part before the slash */
+        str_slice_t key = slice_field(word, 1, "/");
+        ip_kw_t kw = ip_kw_lookup(key.ptr, key.len);
+
+        /** brd and scope belong to the first inet address */
+        if (kw == IP_KW_INET || kw == IP_KW_INET6 || kw == IP_KW_LINK)
+            in_inet = false;
+
+        switch (kw) {
+        case IP_KW_MTU:
+            if (if_->mtu || !slice_next(&rest, CMD_OUT_DELIM, &word))
+                break;
+            if_->mtu = slice_intern(word);
+            MEM_CHECK(if_->mtu, NULL);
+            break;
+
+        case IP_KW_LINK: {
+            if (if_->linktype || key.len == word.len)
+                break;
+            str_slice_t link_type = slice_field(word, 2, "/");
+            if(slice_eq(link_type, "ether")){
+                bool dynamic = dhcp_ip_show_is_dynamic(out) || dhcp_if_is_dynamic(if_->name);
+                link_type = slice_make(dynamic ? "dhcp" : "static");
+            }
+            if_->linktype = slice_intern(link_type);
+            MEM_CHECK(if_->linktype, NULL);
 
-    FILE *fp = popen(cmd,"r");
-    if (fp == NULL){
-        fprintf(stderr, "\n%sIssue running command %s. Moving on to next interface%s\n", KYEL, cmd, KNRM);
-        return false;
-    }
+            /** Get HW Address -- the word after link/<opt> */
+            if (slice_next(&rest, CMD_OUT_DELIM, &word)) {
+                if_->hwaddress = slice_intern(word);
+                MEM_CHECK(if_->hwaddress, NULL);
+            }
+            break;
+        }
 
-    char line[MAX_OUTPUT_LEN];
-    while(fgets(line, MAX_OUTPUT_LEN, fp)){
-        if(strstr(line, "Link detected: yes")){
-            pclose(fp);
-            return true;
+        case IP_KW_INET:
+            if (IP_ADDR_IS_SET(if_->address) || !slice_next(&rest, CMD_OUT_DELIM, &word) ||
+                !ip_addr_parse(word, &if_->address))
+                break;
+            in_inet = true;
+            if_->auto_opt = true;
+
+            /* The prefix length becomes the network mask */
+            if (if_->address.prefix_len != IP_NO_PREFIX)
+                ip_addr_netmask(if_->address.prefix_len, &if_->netmask);
+            if_->address.prefix_len = IP_NO_PREFIX;
+            break;
+
+        case IP_KW_BRD:
+            if (!in_inet || IP_ADDR_IS_SET(if_->broadcast) || !slice_next(&rest, CMD_OUT_DELIM, &word))
+                break;
+            ip_addr_parse(word, &if_->broadcast);
+            break;
+
+        case IP_KW_SCOPE:
+            if (!in_inet || if_->scope || !slice_next(&rest, CMD_OUT_DELIM, &word))
+                break;
+            if_->scope = slice_intern(word);
+            MEM_CHECK(if_->scope, NULL);
+            break;
+
+        default:
+            break;
         }
     }
-    pclose(fp);
-    return false;
+
+    return if_;
 }
 
 /**
@@ -89,169 +151,102 @@ static bool is_up(const char *interface)
 if_data_t *ubuntu_parse_active_interfaces(const char *if_list_cmd, const char *if_details_cmd)
 {
     FILE *fp;
-    if_data_t *ifaces = calloc(1, sizeof(if_data_t));
+    if_data_t *ifaces = arena_alloc(parse_arena, sizeof(if_data_t));
     MEM_CHECK(ifaces, NULL);
 
     /** Attempt to read output of command */
-    fp = popen(if_list_cmd, "r");
-	if (fp == NULL){
-		sprintf(err_msg, "Could not run command: %s", if_list_cmd);
+    exec_buf_t out = { 0 };
+    fp = exec_open(if_list_cmd, &out);
+    if (fp == NULL){
         return NULL;
     }
 
 
     /** Get the list of interface names */
-    char *if_line = calloc(MAX_OUTPUT_LEN, sizeof(char));
-    MEM_CHECK(if_line, NULL);
-    char *if_name = calloc(MAX_IF_NAME, sizeof(char));
-    MEM_CHECK(if_name, NULL);
+    char if_line[MAX_OUTPUT_LEN];
+    char if_name[MAX_IF_NAME];
     int line_num = 0;
     char *delim = " ";
 	while (fgets(if_line, MAX_OUTPUT_LEN, fp) != NULL){
         if (line_num % 2 == 0) {
-            get_field_delim(if_name, if_line, 2, MAX_IF_NAME, delim);
-            if_name[strlen(if_name)-1] = 0;
-            char* at = strchr(if_name, '@');
-            if (at) *at = 0;
+            /** "<n>: <name>[@<parent>]:" -- drop the colon and any parent */
+            str_slice_t field = slice_field(slice_make(if_line), 2, delim);
+            if (field.len > 0)
+                field.len--;
+            slice_copy(if_name, slice_field(field, 1, "@"), MAX_IF_NAME);
             
-            if (!is_up(if_name)){
-                free(if_name);
-                if_name = calloc(MAX_IF_NAME, sizeof(char));
+            /** Unselected interfaces are left alone, their stanzas are written back as they are */
+            if (!if_is_selected(if_name)) {
+                if (!if_withhold(if_name)) {
+                    fclose(fp);
+                    exec_buf_free(&out);
+                    return NULL;
+                }
+                line_num++;
+                continue;
+            }
+
+            if (!link_has_carrier(if_name)){
+                line_num++;
                 continue;
             }
 
-            ifaces->if_name_list[ifaces->num_if++] = if_name;
-            if_name = calloc(MAX_IF_NAME, sizeof(char));
-            MEM_CHECK(if_name, NULL);
+            if (!if_data_reserve(ifaces, ifaces->num_if + 1)) {
+                fclose(fp);
+                exec_buf_free(&out);
+                return NULL;
+            }
+            ifaces->if_name_list[ifaces->num_if] = slice_intern(slice_make(if_name));
+            MEM_CHECK(ifaces->if_name_list[ifaces->num_if], NULL);
+            ifaces->num_if++;
         }
         line_num++;
     }
 
-    free(if_line);
-    free(if_name);
-    pclose(fp);
+    fclose(fp);
+
+    /** Run the detail commands side by side; the loop below picks up their output */
+    char (*detail_cmds)[MAX_CMD_LEN] = calloc(ifaces->num_if, MAX_CMD_LEN);
+    char **detail_argv = calloc(ifaces->num_if, sizeof(char *));
+    MEM_CHECK(detail_cmds, NULL);
+    MEM_CHECK(detail_argv, NULL);
+    for(int i = 0; i < ifaces->num_if; i++){
+        sprintf(detail_cmds[i], if_details_cmd, ifaces->if_name_list[i]);
+        detail_argv[i] = detail_cmds[i];
+    }
+    bool prefetched = exec_prefetch(detail_argv, ifaces->num_if);
+    free(detail_argv);
+    free(detail_cmds);
+    if (!prefetched) return NULL;
 
-    /** Get the details of all the interfaces */
+    /** Get the details of all the interfaces, reusing the output buffer */
     for(int i = 0; i < ifaces->num_if; i++){
         char cmd[MAX_CMD_LEN];
         sprintf(cmd, if_details_cmd, ifaces->if_name_list[i]);
-        fp = popen(cmd, "r");
-        
-        if (fp == NULL){
-		    sprintf(err_msg, "Could not run command: %s", if_list_cmd);
-            return NULL;
-        }
-        char out_buffer[MAX_OUTPUT_LEN];
-        clean_output(fp, out_buffer);
-        pclose(fp);
-
-        interface_t *if_ = calloc(1, sizeof(interface_t));
-        MEM_CHECK(if_, NULL);
-
-        char *name = calloc(MAX_IF_NAME, sizeof(char));
-        MEM_CHECK(name, NULL);
-        get_field_delim(name, out_buffer, 2, MAX_IF_NAME, " ");
-        trim(name, ":");
-        if_->name = name;
-
-        char *link = strstr(out_buffer, "link");
-        if ( link != NULL){
-            char tmp[MAX_UBUNTU_IF_VAL];
-            get_field_delim(tmp, link, 2, MAX_UBUNTU_IF_VAL, "/");
-            char *link_val = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(link_val, NULL);
-            get_field_delim(link_val, tmp, 1, MAX_UBUNTU_IF_VAL, " ");
-            if(strcmp(link_val, "ether") == 0){
-                free(link_val);
-                link_val = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-                MEM_CHECK(link_val, NULL);
-                char *check_dyn_cmd = "ps -A -o cmd | grep -E '(/| )dhclient .'";
-                FILE *check_dynamic = popen(check_dyn_cmd, "r");
-                if (check_dynamic == NULL){
-                    sprintf(err_msg, "Could not run command: %s", check_dyn_cmd);
-                    return NULL;
-                }
-                char check_dyn_line[MAX_OUTPUT_LEN];
-                bool found = false;
-                while(fgets(check_dyn_line, MAX_OUTPUT_LEN, check_dynamic)){
-                    if(strstr(check_dyn_line, if_->name) != NULL){
-                        memcpy(link_val, "dhcp", 4);
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) memcpy(link_val, "static", 6);
-                
-                pclose(check_dynamic);
-            }
-            if_->linktype = link_val;
-        }
-
-        /** Gets line with inet on it and find the ip address */
-        char *inet = strstr(out_buffer, "inet ");
-        if ( inet != NULL){
-            char *inet_val = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(inet_val, NULL);
-            get_field_delim(inet_val, inet, 2, MAX_UBUNTU_IF_VAL, " ");
-            get_field_delim(inet_val, inet_val, 1, MAX_UBUNTU_IF_VAL, "/");
-            if_->address = inet_val;
-            if_->auto_opt = true;
-        }
-
-        /* Attempt to find network mask */
-        char *inet_mask = strstr(out_buffer, "inet ");
-        if ( inet_mask != NULL){
-            char *inet_mask_val = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(inet_mask_val, NULL);
-            get_field_delim(inet_mask_val, inet_mask, 2, MAX_UBUNTU_IF_VAL, " ");
-            get_field_delim(inet_mask_val, inet_mask_val, 2, MAX_UBUNTU_IF_VAL, "/");
-            if_->netmask = bitmask_to_netmask_ipv4(atoi(inet_mask_val));
-            free(inet_mask_val);
-        }
-
-        /* Attempt to find broadcast address */
-        if ( inet != NULL){
-            char check[MAX_UBUNTU_IF_VAL];
-            get_field_delim(check, inet, 3, MAX_UBUNTU_IF_VAL, " ");
-            if(strstr(check, "brd") != NULL) {            
-                char *broadcast = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-                MEM_CHECK(broadcast, NULL);
-                get_field_delim(broadcast, inet, 4, MAX_UBUNTU_IF_VAL, " ");            
-                if_->broadcast = broadcast;
-            }
-        }
-        /** Get inet scope */
-        if ( inet != NULL){
-            char check[MAX_UBUNTU_IF_VAL];
-            get_field_delim(check, inet, 3, MAX_UBUNTU_IF_VAL, " ");
-            if(strstr(check, "scope") != NULL) {            
-                char *scope = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-                MEM_CHECK(scope, NULL);
-                get_field_delim(scope, inet, 6, MAX_UBUNTU_IF_VAL, " ");            
-                if_->scope = scope;
-            }
-        }
         
-        /** Get MTU */
-        char *mtu = strstr(out_buffer, "mtu");
-        if ( mtu != NULL){
-            char *mtu_val = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(mtu_val, NULL);
-            get_field_delim(mtu_val, mtu, 2, MAX_UBUNTU_IF_VAL, " ");
-            if_->mtu = mtu_val;
+        if (!exec_read(cmd, &out)){
+            if (errno != ETIMEDOUT)
+                return NULL;
+
+            /** Leave the interface alone rather than block the others; its stanza is kept as it is */
+            fprintf(stderr, "%sWarning: %s, skipping %s%s\n", KYEL, err_msg, ifaces->if_name_list[i], KNRM);
+            if (!if_withhold(ifaces->if_name_list[i]))
+                return NULL;
+            memmove(&ifaces->if_name_list[i], &ifaces->if_name_list[i+1],
+                    (ifaces->num_if - i - 1) * sizeof(const char *));
+            ifaces->if_name_list[--ifaces->num_if] = NULL;
+            i--;
+            continue;
         }
-
-        /** Get HW Address -- dependent on being on the same line as link/<opt>  */
-        if ( link != NULL){
-            char *hw_addr = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(hw_addr, NULL);
-            get_field_delim(hw_addr, link, 2, MAX_UBUNTU_IF_VAL, " ");
-            if_->hwaddress = hw_addr;
+        interface_t *if_ = ubuntu_parse_if_details(out.data);
+        if (!if_) {
+            exec_buf_free(&out);
+            return NULL;
         }
-
         ifaces->interfaces[i] = if_;
 
     }
+    exec_buf_free(&out);
 
     return ifaces;
 }
@@ -265,276 +260,335 @@ if_data_t *ubuntu_parse_active_interfaces(const char *if_list_cmd, const char *i
  */
 route_list_t *ubuntu_parse_active_routes(const char *cmd)
 {    
-    FILE *fp;
-    route_list_t *route_lst = calloc(1, sizeof(route_list_t));
+    route_list_t *route_lst = arena_alloc(parse_arena, sizeof(route_list_t));
     MEM_CHECK(route_lst, NULL);
 
     /** Read the output of the cmd */
-    fp = popen(cmd, "r");
-
-	if (fp == NULL){
-		sprintf(err_msg, "Could not run command: %s", cmd);
+    exec_buf_t out = { 0 };
+    if (!exec_read(cmd, &out)){
         return NULL;
     }
 
-    /** Parse all the routes */
-    ubuntu_route_t route = calloc(MAX_OUTPUT_LEN, sizeof(char));
-    MEM_CHECK(route, NULL);
-    
-    while(fgets(route, MAX_OUTPUT_LEN, fp))
+    /** Parse all the routes, in place */
+    line_scanner_t scan;
+    str_slice_t route;
+    bool kernel;
+    scan_init(&scan, out.data, out.len, ROUTE_KERNEL_KW);
+    while (scan_next_line(&scan, &route, &kernel))
     {
         // Ignore routes that are made on boot. Those dont need to be specified.
-        if (strstr(route, "proto kernel") != NULL) continue;
+        if (kernel || route.len == 0) continue;
 
-        if (route[strlen(route)-1] == '\n') route[strlen(route)-1] = '\0';
+        ubuntu_route_t *slot = ARRAY_PUSH(parse_arena, route_lst->routes, route_lst->num_routes, route_lst->cap_routes);
+        if (!slot || !route_parse(route, slot)) {
+            exec_buf_free(&out);
+            return NULL;
+        }
+    }
+    exec_buf_free(&out);
+
+    return route_lst;
+}
 
-        route_lst->routes[route_lst->num_routes++] = route;
-        route = calloc(MAX_OUTPUT_LEN, sizeof(char));
-        MEM_CHECK(route, NULL);
 
+/**
+ * @enum ubuntu_lex_state_t
+ * @brief where the interfaces(5) lexer is in the stanza grammar
+ */
+typedef enum {
+    UBUNTU_LEX_TOP = 0,     // before the first stanza, lines belong to no interface
+    UBUNTU_LEX_AUTO,        // after "auto <name>", before its iface stanza
+    UBUNTU_LEX_IFACE,       // inside an iface stanza
+} ubuntu_lex_state_t;
+
+/**
+ * @brief Starts the next interface of an interfaces(5) file.
+ * 
+ * @param persist_ifs the interfaces parsed so far
+ * @param name the interface's name
+ * 
+ * @returns the new interface, with an empty route list, or NULL if it
+ * could not be allocated
+ */
+static interface_t *ubuntu_new_persist_if(if_data_t *persist_ifs, str_slice_t name)
+{
+    if (!if_data_reserve(persist_ifs, persist_ifs->num_if + 1))
+        return NULL;
+    int i = persist_ifs->num_if++;
+    persist_ifs->if_name_list[i] = slice_intern(name);
+    MEM_CHECK(persist_ifs->if_name_list[i], NULL);
+    persist_ifs->interfaces[i] = arena_alloc(parse_arena, sizeof(interface_t));
+    MEM_CHECK(persist_ifs->interfaces[i], NULL);
+    persist_ifs->interfaces[i]->name = persist_ifs->if_name_list[i];
+    return persist_ifs->interfaces[i];
+}
+
+/**
+ * @brief Checks whether an up command adds a route, i.e. `ip route add`
+ * or `route add`
+ * 
+ * @param cmd the command, after the up keyword. Advanced past "add" if
+ * it is a route command.
+ * 
+ * @returns true if the command adds a route
+ */
+static bool ubuntu_is_route_cmd(str_slice_t *cmd)
+{
+    str_slice_t rest = *cmd, word;
+    bool route_cmd = false;
+    while (slice_next(&rest, UBUNTU_IF_DELIM, &word)) {
+        if (slice_eq(word, "route"))
+            route_cmd = true;
+        else if (route_cmd && slice_eq(word, "add")) {
+            *cmd = rest;
+            return true;
+        }
     }
-    free(route);
-    pclose(fp);
+    return false;
+}
 
-    return route_lst;
+/**
+ * @brief Adds a route to the interface whose stanza it is in
+ * 
+ * @param iface the interface
+ * @param route the route, after `route add`
+ * 
+ * @returns false if the route could not be stored
+ */
+static bool ubuntu_add_persist_route(interface_t *iface, str_slice_t route)
+{
+    route_list_t *routes = &iface->mapped_routes;
+
+    route = slice_trim(route, UBUNTU_IF_DELIM);
+    if (route.len) {
+        ubuntu_route_t *slot = ARRAY_PUSH(parse_arena, routes->routes, routes->num_routes, routes->cap_routes);
+        if (!slot || !route_parse(route, slot))
+            return false;
+    }
+    return true;
 }
 
+/**
+ * @brief Keeps a line nsync does not manage, so it is written back out
+ * unchanged
+ * 
+ * @param lines the lines kept so far, e.g. the unmanaged lines of an
+ * interface
+ * @param line the line as it was read, without its newline; one is added
+ * 
+ * @returns false if the line could not be stored
+ */
+static bool ubuntu_add_unmanaged(char **lines, str_slice_t line)
+{
+    /** Each line keeps its newline, so the lines are written out as they are */
+    *lines = arena_strcat(parse_arena, *lines, line.ptr, line.len);
+    MEM_CHECK(*lines, false);
+    *lines = arena_strcat(parse_arena, *lines, "\n", 1);
+    MEM_CHECK(*lines, false);
+    return true;
+}
 
 /**
- * @brief Parses all of the persistant interface configurations 
- * and store the info in the struct
+ * @brief Parses all of the persistant interface configurations and their
+ * routes in one pass over the file and stores the info in the struct.
+ * 
+ * Lines are lexed once: continuation lines are joined, and each logical
+ * line is dispatched on its first word through the stanza grammar
+ * (auto, iface and its option lines). The routes of `up ip route add`
+ * lines are added to the interface of the stanza they are in, so the
+ * result is already mapped; other up commands are kept unmanaged, as they
+ * were read. Lines outside any stanza, such as header comments and source
+ * lines, are kept in the order they were read. The file
+ * itself stays in the parse arena, and each interface records the bytes of
+ * its stanza so it can be written back exactly as it was.
  * 
  * @param file_loc the absolute location of the file holding the 
  * persistant configs for the interfaces
  * @returns a pointer to an if_data_t stuct storing the persistant 
- * configuration data
+ * configuration data, or NULL on error
  */
 if_data_t *ubuntu_parse_persist_interfaces(const char *file_loc)
 {
-    FILE *fp = fopen(file_loc, "r");
-    if (fp == NULL) {
+    size_t len;
+    const char *raw = file_read(file_loc, &len, parse_arena);
+    if (raw == NULL) {
         sprintf(err_msg, "couldn't open file: %s", file_loc);
         return NULL;
     }
 
-    if_data_t *persist_ifs = calloc(1, sizeof(if_data_t));
+    /** Continuations are joined in a copy, the bytes read are left as they are */
+    if_data_t *persist_ifs = arena_alloc(parse_arena, sizeof(if_data_t));
     MEM_CHECK(persist_ifs, NULL);
-
-    char line[MAX_OUTPUT_LEN];
-
-    // We will add 1 when we find the first iface
-    persist_ifs->num_if = -1;
-    bool reached_auto = false;
-    while(fgets(line, MAX_OUTPUT_LEN, fp)) {
-        bool found_opt = false;
-    
-        /** iface */
-        if(strstr(line, "iface") != NULL) {
-            found_opt = true;
-
-            /** Only iterate to the next saved interface if
-             * this is actually the start of a new one */
-            if(reached_auto)
-                reached_auto = false;
-            else {
-                persist_ifs->num_if++;
-                char *iface_name = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-                MEM_CHECK(iface_name, NULL);
-                get_field_delim(iface_name, line, 2, MAX_UBUNTU_IF_VAL, " ");
-                persist_ifs->if_name_list[persist_ifs->num_if] = trim(iface_name,NULL);
-                char *if_name_cpy = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-                MEM_CHECK(if_name_cpy, NULL);
-                memcpy(if_name_cpy, iface_name, strlen(iface_name));
-                persist_ifs->interfaces[persist_ifs->num_if] = calloc(1, sizeof(interface_t));
-                MEM_CHECK(persist_ifs->interfaces[persist_ifs->num_if], NULL);
-                persist_ifs->interfaces[persist_ifs->num_if]->name = if_name_cpy;
-                            
-            }
-        }
-        /** auto */
-        if(strstr(line, "auto") != NULL) {
-            found_opt = true;
-            reached_auto = true;
-            persist_ifs->num_if++;
-            char *iface_name = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(iface_name, NULL);
-            get_field_delim(iface_name, line, 2, MAX_UBUNTU_IF_VAL, " ");
-            persist_ifs->if_name_list[persist_ifs->num_if] = trim(iface_name,NULL);;
-            char *if_name_cpy = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(if_name_cpy, NULL);
-            memcpy(if_name_cpy, iface_name, strlen(iface_name));
-            persist_ifs->interfaces[persist_ifs->num_if] = calloc(1, sizeof(interface_t));
-            MEM_CHECK(persist_ifs->interfaces[persist_ifs->num_if], NULL);
-            persist_ifs->interfaces[persist_ifs->num_if]->name = if_name_cpy;
-            trim(persist_ifs->interfaces[persist_ifs->num_if]->name,NULL);
-            persist_ifs->interfaces[persist_ifs->num_if]->auto_opt = true;
-            
+    char *buf = malloc(len + 1);
+    MEM_CHECK(buf, NULL);
+    memcpy(buf, raw, len + 1);
+
+    ubuntu_lex_state_t state = UBUNTU_LEX_TOP;
+    interface_t *iface = NULL;
+    bool ok = true;
+
+    char *end = buf + len;
+    for (char *line = buf; ok && line < end; ) {
+        /** A logical line runs to the first newline not escaped by a backslash */
+        char *eol = memchr(line, '\n', end - line);
+        while (eol && eol > line && eol[-1] == '\\') {
+            eol[-1] = eol[0] = ' ';
+            eol = memchr(eol, '\n', end - eol);
         }
-        
-        /** linktype/inet */
-        char *inet_loc = strstr(line, "inet");
-        if(inet_loc != NULL){
-            found_opt = true;
-            char *linktype = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(linktype, NULL);
-            get_field_delim(linktype, inet_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-            persist_ifs->interfaces[persist_ifs->num_if]->linktype = trim(linktype, NULL);
+        if (!eol)
+            eol = end;
+        str_slice_t rest = { line, eol - line };
+        const char *raw_line = raw + (line - buf);
+        str_slice_t text = { raw_line, eol - line };
+        line = eol < end ? eol + 1 : end;
+        const char *raw_next = raw + (line - buf);
+
+        str_slice_t word;
+        bool blank = !slice_next(&rest, UBUNTU_IF_DELIM, &word);
+        ubuntu_kw_t kw = blank ? UBUNTU_KW_NONE : ubuntu_kw_lookup(word.ptr, word.len);
+
+        /** A source line ends the stanza before it */
+        if (kw == UBUNTU_KW_SOURCE) {
+            iface = NULL;
+            state = UBUNTU_LEX_TOP;
         }
 
-         /** hwaddress */
-        char *hwaddr_loc = strstr(line, "hwaddress");
-        if(hwaddr_loc != NULL) {
-            found_opt = true;
-            char *hwaddress = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(hwaddress, NULL);
-            get_field_delim(hwaddress, hwaddr_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-            persist_ifs->interfaces[persist_ifs->num_if]->hwaddress = trim(hwaddress, NULL);
+        /** Lines outside any stanza are kept together, to be written first */
+        if (state == UBUNTU_LEX_TOP && kw != UBUNTU_KW_AUTO && kw != UBUNTU_KW_IFACE) {
+            ok = ubuntu_add_unmanaged(&persist_ifs->top, text);
+            continue;
         }
-        else {
-            /** address */
-            char *addr_loc = strstr(line, "address");
-            if(addr_loc != NULL){
-                found_opt = true;
-                char *address = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-                MEM_CHECK(address, NULL);
-                get_field_delim(address, addr_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-                persist_ifs->interfaces[persist_ifs->num_if]->address = trim(address, NULL);
+        if (blank)
+            continue;
+
+        /** A stanza runs from its auto or iface line to the last line it holds */
+        if (iface && kw != UBUNTU_KW_AUTO && kw != UBUNTU_KW_IFACE)
+            iface->stanza.len = raw_next - iface->stanza.ptr;
+
+        const char **field = NULL;
+        ip_addr_t *addr_field = NULL;
+        switch (kw) {
+        case UBUNTU_KW_AUTO:
+            slice_next(&rest, UBUNTU_IF_DELIM, &word);
+            iface = ubuntu_new_persist_if(persist_ifs, word);
+            ok = iface != NULL;
+            if (ok) {
+                iface->auto_opt = true;
+                iface->stanza = (str_slice_t){ raw_line, raw_next - raw_line };
             }
-        }
+            state = UBUNTU_LEX_AUTO;
+            continue;
 
+        case UBUNTU_KW_IFACE:
+            /** The stanza of the interface just marked auto continues its entry */
+            slice_next(&rest, UBUNTU_IF_DELIM, &word);
+            if (state != UBUNTU_LEX_AUTO || !slice_eq(word, iface->name)) {
+                iface = ubuntu_new_persist_if(persist_ifs, word);
+                ok = iface != NULL;
+                if (ok)
+                    iface->stanza.ptr = raw_line;
+            }
+            if (ok)
+                iface->stanza.len = raw_next - iface->stanza.ptr;
+            state = UBUNTU_LEX_IFACE;
 
-        /** netmask */
-        char *mask_loc = strstr(line, "netmask");
-        if(mask_loc != NULL){
-            found_opt = true;
-            char *netmask = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(netmask, NULL);
-            get_field_delim(netmask, mask_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-            persist_ifs->interfaces[persist_ifs->num_if]->netmask = trim(netmask, NULL);
+            /** iface <name> inet <method> -- the method is the linktype */
+            slice_next(&rest, UBUNTU_IF_DELIM, &word);
+            if (!ok || ubuntu_kw_lookup(word.ptr, word.len) != UBUNTU_KW_INET)
+                continue;
+            field = &iface->linktype;
+            break;
+
+        /** hwaddress [<class>] <address> -- the address is the last word */
+        case UBUNTU_KW_HWADDRESS: {
+            str_slice_t addr = { 0 };
+            while (slice_next(&rest, UBUNTU_IF_DELIM, &word))
+                addr = word;
+            rest = addr;
+            field = iface ? &iface->hwaddress : NULL;
+            break;
         }
 
-        /** broadcast */
-        char *brd_loc = strstr(line, "broadcast");
-        if(brd_loc != NULL) {
-            found_opt = true;
-            char *broadcast = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(broadcast, NULL);
-            get_field_delim(broadcast, brd_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-            persist_ifs->interfaces[persist_ifs->num_if]->broadcast = trim(broadcast, NULL);
-        }
+        case UBUNTU_KW_ADDRESS:     addr_field = iface ? &iface->address : NULL;   break;
+        case UBUNTU_KW_NETMASK:     addr_field = iface ? &iface->netmask : NULL;   break;
+        case UBUNTU_KW_BROADCAST:   addr_field = iface ? &iface->broadcast : NULL; break;
+        case UBUNTU_KW_GATEWAY:     addr_field = iface ? &iface->gateway : NULL;   break;
+        case UBUNTU_KW_METRIC:      field = iface ? &iface->metric : NULL;    break;
+        case UBUNTU_KW_MTU:         field = iface ? &iface->mtu : NULL;       break;
+        case UBUNTU_KW_SCOPE:       field = iface ? &iface->scope : NULL;     break;
+
+        /** Routes are mapped to the stanza, other commands are kept as they are */
+        case UBUNTU_KW_UP:
+            if (iface && state == UBUNTU_LEX_IFACE && ubuntu_is_route_cmd(&rest))
+                ok = ubuntu_add_persist_route(iface, rest);
+            else if (iface)
+                ok = ubuntu_add_unmanaged(&iface->unmanaged, text);
+            continue;
 
-        /** metric */
-        char *metric_loc = strstr(line, "metric");
-        if(metric_loc != NULL) {
-            found_opt = true;
-            char *metric = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(metric, NULL);
-            get_field_delim(metric, metric_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-            persist_ifs->interfaces[persist_ifs->num_if]->metric = trim(metric, NULL);
+        /** Uncategorized/managed */
+        default:
+            if (iface)
+                ok = ubuntu_add_unmanaged(&iface->unmanaged, text);
+            continue;
         }
 
-       
-
-        /** gateway */
-        char *gw_loc = strstr(line, "gateway");
-        if(gw_loc != NULL) {
-            found_opt = true;
-            char *gateway = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(gateway, NULL);
-            get_field_delim(gateway, gw_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-            persist_ifs->interfaces[persist_ifs->num_if]->gateway = trim(gateway, NULL);
+        /** Addresses are kept in binary; one that does not parse is kept as its line */
+        if (addr_field) {
+            ip_addr_t addr;
+            if (!slice_next(&rest, UBUNTU_IF_DELIM, &word))
+                continue;
+            if (ip_addr_parse(word, &addr))
+                *addr_field = addr;
+            else
+                ok = ubuntu_add_unmanaged(&iface->unmanaged, text);
+            continue;
         }
 
-        /** mtu */
-        char *mtu_loc = strstr(line, "mtu");
-        if(mtu_loc != NULL) {
-            found_opt = true;
-            char *mtu = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-            MEM_CHECK(mtu, NULL);
-            get_field_delim(mtu, mtu_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-            persist_ifs->interfaces[persist_ifs->num_if]->mtu = trim(mtu, NULL);
-        }
-        
-        /** If its a route then it will be handled by the mapper */
-        if(strstr(line, "up") != NULL)
-            found_opt = true;
-        else{
-            /** scope */
-            char *scope_loc = strstr(line, "scope");
-            if(scope_loc != NULL) {
-                found_opt = true;
-                char *scope = calloc(MAX_UBUNTU_IF_VAL, sizeof(char));
-                MEM_CHECK(scope, NULL);
-                get_field_delim(scope, scope_loc, 2, MAX_UBUNTU_IF_VAL, " ");
-                persist_ifs->interfaces[persist_ifs->num_if]->scope = trim(scope, NULL);
-                printf("%s\n", persist_ifs->interfaces[persist_ifs->num_if]->scope);
-            }
-        }
-        /** Uncategorized/managed */
-        if (!found_opt && persist_ifs->num_if >= 0) {
-            if(!persist_ifs->interfaces[persist_ifs->num_if]->unmanaged){
-                persist_ifs->interfaces[persist_ifs->num_if]->unmanaged = calloc(strlen(line)+1, sizeof(char));
-                MEM_CHECK(persist_ifs->interfaces[persist_ifs->num_if]->unmanaged, NULL);
-                safe_strncpy(persist_ifs->interfaces[persist_ifs->num_if]->unmanaged, line, strlen(line));
-            }
-            else {
-                // curr_size+1 to include null terminator
-                int curr_size = strlen(persist_ifs->interfaces[persist_ifs->num_if]->unmanaged)+1;
-                int line_size = strlen(line);
-                char *new_unmanaged = calloc(curr_size+line_size, sizeof(char));
-                MEM_CHECK(new_unmanaged, NULL);
-                safe_strncpy(new_unmanaged, persist_ifs->interfaces[persist_ifs->num_if]->unmanaged, curr_size);
-                safe_strncpy(&new_unmanaged[curr_size-1], line, line_size);
-                free(persist_ifs->interfaces[persist_ifs->num_if]->unmanaged); 
-                new_unmanaged[strlen(new_unmanaged)] = '\n';
-                persist_ifs->interfaces[persist_ifs->num_if]->unmanaged = new_unmanaged; 
-            }
-        }
+        if (field == NULL || !slice_next(&rest, UBUNTU_IF_DELIM, &word))
+            continue;
+        *field = slice_intern(word);
+        ok = *field != NULL;
     }
-    // To avoid segfaults w/ indexing we initialize from -1 and then need to add 1 at the end so the count is right
-    persist_ifs->num_if++;
+    free(buf);
 
-    fclose(fp);
-    return persist_ifs;
+    return ok ? persist_ifs : NULL;
 }
 
 
 /**
- * @brief Parses all of the persistant routes and stores them in the struct
- * 
- * @param file_loc the path to the file containing the persistent routes
- * @returns a pointer to a route_lsit_t struct containing the persistent routes
+ * @brief Adds a route to the routes of its interface
+ * @param ctx the if_data_t of the interfaces
+ * @param if_index the index of the route's interface
+ * @param rt the route
+ * @returns false if memory could not be allocated
  */
-route_list_t *ubuntu_parse_persist_routes(const char *file_loc)
+static bool ubuntu_route_sink(void *ctx, int if_index, const route_t *rt)
 {
-    /** Open the file for reading */
-    FILE *fp = fopen(file_loc, "r");
-    if (fp == NULL) {
-        sprintf(err_msg, "couldn't open file: %s", file_loc);
-        return NULL;
-    }
+    route_list_t *mapped = &((if_data_t *)ctx)->interfaces[if_index]->mapped_routes;
+    ubuntu_route_t *slot = ARRAY_PUSH(parse_arena, mapped->routes, mapped->num_routes, mapped->cap_routes);
+    if (!slot)
+        return false;
+    *slot = *rt;
+    return true;
+}
 
-    route_list_t *persist_routes = calloc(1, sizeof(route_list_t));
-    MEM_CHECK(persist_routes, NULL);
+/**
+ * @brief Lists the interfaces that take routes. Routes of dhcp interfaces
+ * are left to the dhcp client, so those are listed as NULL.
+ * @param sys_ifs struct containing interface configuration details
+ * @returns the names, indexed as sys_ifs, or NULL if memory could not be
+ * allocated
+ */
+static const char **ubuntu_route_if_names(if_data_t *sys_ifs)
+{
+    const char **names = arena_alloc(parse_arena, sys_ifs->num_if * sizeof(char *));
+    MEM_CHECK(names, NULL);
 
-    /** parse all of the routes from the files */
-    char line[MAX_OUTPUT_LEN];
-    while(fgets(line, MAX_OUTPUT_LEN, fp)) {
-        if (!strstr(line, "up")) {
-            continue;
-        }
-        char *mark = strstr(line,"add");
-        if (mark){
-            ubuntu_route_t route = calloc(MAX_OUTPUT_LEN, sizeof(char));
-            MEM_CHECK(route, NULL);
-            memcpy(route, &mark[4], MAX_OUTPUT_LEN); // copy everything after the "up"
-            trim(route, "\n");
-            persist_routes->routes[persist_routes->num_routes++] = route;
-        }
+    for (int i = 0; i < sys_ifs->num_if; i++) {
+        if (strncmp(sys_ifs->interfaces[i]->linktype, "dhcp", 4) != 0)
+            names[i] = sys_ifs->if_name_list[i];
     }
-    fclose(fp);
-
-    return persist_routes;
+    return names;
 }
 
 /**
@@ -548,44 +602,39 @@ route_list_t *ubuntu_parse_persist_routes(const char *file_loc)
  */
 bool map_routes_to_if(if_data_t *sys_ifs, route_list_t *route_list)
 {
-    for (int i = 0; i < sys_ifs->num_if; i++) {
-        sys_ifs->interfaces[i]->mapped_routes = calloc(1, sizeof(route_list_t));
-        MEM_CHECK(sys_ifs->interfaces[i]->mapped_routes, false);
-        if (strncmp(sys_ifs->interfaces[i]->linktype, "dhcp", 4) == 0){
-            continue;
-        } 
-        for (int j = 0; j < route_list->num_routes; j++) {
-            if (strstr(route_list->routes[j], sys_ifs->if_name_list[i]) == NULL) {
-                continue;
-            }
-            sys_ifs->interfaces[i]->mapped_routes->
-                routes[sys_ifs->interfaces[i]->
-                    mapped_routes->num_routes++] = route_list->routes[j];
-        }
+    const char **names = ubuntu_route_if_names(sys_ifs);
+    if (!names)
+        return false;
+
+    /** One pass over the routes, each attributed by its device number */
+    route_if_map_t ifs;
+    if (!route_if_map_init(&ifs, names, sys_ifs->num_if))
+        return false;
+    bool ok = true;
+    for (int j = 0; ok && j < route_list->num_routes; j++) {
+        int i = ROUTE_IF(&ifs, &route_list->routes[j]);
+        if (i >= 0)
+            ok = ubuntu_route_sink(sys_ifs, i, &route_list->routes[j]);
     }
-    return true;
+    route_if_map_free(&ifs);
+    return ok;
 }
 
 /**
- * @brief Frees all of the fields in an interface_t struct
+ * @brief Reads the active routes straight into the route lists of their
+ * interfaces, as ubuntu_parse_active_routes followed by map_routes_to_if
+ * would, without first holding the whole route table. The routes of
+ * the listed interfaces are all kept.
+ * 
+ * @param cmd the command to retrieve the list of active routes
+ * @param sys_ifs struct containing interface configuration details
  * 
- * @param iface the interface whose fields will be freed.
+ * @returns boolean that is true if successful and false if there was an error
  */
-void free_interface(interface_t *iface)
+bool ubuntu_stream_routes(const char *cmd, if_data_t *sys_ifs)
 {
-    if (!iface) return;
-
-    if(iface->name)         free(iface->name);
-    if(iface->linktype)     free(iface->linktype);
-    if(iface->address)      free(iface->address);
-    if(iface->netmask)      free(iface->netmask);
-    if(iface->broadcast)    free(iface->broadcast);
-    if(iface->metric)       free(iface->metric);
-    if(iface->hwaddress)    free(iface->hwaddress);
-    if(iface->gateway)      free(iface->gateway);
-    if(iface->mtu)          free(iface->mtu);
-    if(iface->scope)        free(iface->scope);
-    if(iface->unmanaged)    free(iface->unmanaged);
-    
-    free(iface->mapped_routes);
+    const char **names = ubuntu_route_if_names(sys_ifs);
+    if (!names)
+        return false;
+    return route_stream(cmd, names, sys_ifs->num_if, &ubuntu_route_sink, sys_ifs);
 }
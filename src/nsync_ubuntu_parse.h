@@ -7,6 +7,7 @@
 
 #include "nsync_info.h"
 #include "nsync_utils.h"
+#include "nsync_route.h"
 
 #ifndef NSYNC_UBUNTU_PARSE_H
 #define NSYNC_UBUNTU_PARSE_H
@@ -16,41 +17,52 @@
 /*                             CONSTANTS                              */
 /**********************************************************************/
 #define MAX_UBUNTU_IF_VAL 100
+#define UBUNTU_IF_DELIM " \t\n"
 
 /**********************************************************************/
 /*                         STRUCTS AND TYPES                          */
 /**********************************************************************/
 
-typedef char*  ubuntu_route_t;
+typedef route_t ubuntu_route_t;
 
 typedef struct route_list{
-    ubuntu_route_t routes[MAX_ROUTES];
+    ubuntu_route_t *routes;
     int num_routes;
+    int cap_routes;
 } route_list_t;
 
+/**
+ * @struct interface
+ * @brief one interface of /etc/network/interfaces or of the active
+ * configuration. The compared fields, interned strings and binary
+ * addresses, sit together at the front; the routes are part of the record
+ * rather than a separate allocation.
+ */
 typedef struct interface{
-    char *name;
-    char *linktype;
-    char *address;
-    char *netmask;
-    char *broadcast;
-    char *metric;
-    char *hwaddress;
-    char *gateway;
-    char *mtu;
-    char *scope;
-    char *unmanaged;
+    const char *name;       // interned, like the other strings but unmanaged
+    const char *linktype;
+    const char *hwaddress;
+    const char *mtu;
+    const char *scope;
+    const char *metric;
+    ip_addr_t address;      // with a prefix length only if the file gives one
+    ip_addr_t netmask;
+    ip_addr_t broadcast;
+    ip_addr_t gateway;
     bool auto_opt;
 
-    route_list_t* mapped_routes;
-
+    char *unmanaged;
+    route_list_t mapped_routes;
+    str_slice_t stanza;     // its lines in the persisted file, as they were read
 }interface_t;
 
 typedef struct sys_interfaces
 {
-    char *if_name_list[MAX_NUM_IF];
-    interface_t *interfaces[MAX_NUM_IF];
+    const char **if_name_list;
+    interface_t **interfaces;
     int num_if;
+    int cap_if;     // capacity of both lists
+    char *top;      // lines outside any stanza, e.g. header comments and source lines
 } if_data_t;
 
 #define IF_I_NAME(ifs, i)       ifs[i]->name 
@@ -66,18 +78,19 @@ typedef struct sys_interfaces
 #define IF_I_UNMANAGED(ifs, i)  ifs[i]->unmanaged 
 #define IF_I_AUTO_OPT(ifs, i)   ifs[i]->auto_opt
 
-#define IF_I_ROUTES(ifs, i)     ifs[i]->mapped_routes->routes
-#define IF_I_ROUTE_NUM(ifs, i)  ifs[i]->mapped_routes->num_routes
-#define IF_I_ROUTE_J(ifs, i, j) ifs[i]->mapped_routes->routes[j]
+#define IF_I_ROUTES(ifs, i)     ifs[i]->mapped_routes.routes
+#define IF_I_ROUTE_NUM(ifs, i)  ifs[i]->mapped_routes.num_routes
+#define IF_I_ROUTE_J(ifs, i, j) ifs[i]->mapped_routes.routes[j]
 
 
 
 typedef struct ubuntu_parse_func {
+        bool (*collect)(cmd_list_t *cmds);
         if_data_t *(*ubuntu_parse_active_interfaces)(const char *if_list_cmd,const char *if_details_cmd);
         route_list_t *(*ubuntu_parse_active_routes)(const char *cmd);
         if_data_t *(*ubuntu_parse_persist_interfaces)(const char *file_loc);
-        route_list_t *(*ubuntu_parse_persist_routes)(const char *file_loc);
         bool (*ubuntu_map_routes)(if_data_t *sys_ifs, route_list_t *route_list);
+        bool (*ubuntu_stream_routes)(const char *cmd, if_data_t *sys_ifs);
 }ubuntu_parse_func_t;
 
 /**********************************************************************/
@@ -85,16 +98,18 @@ typedef struct ubuntu_parse_func {
 /**********************************************************************/
 extern ubuntu_parse_func_t ubuntu_parsers;
 
+interface_t *ubuntu_parse_if_details(const char *out);
+
 if_data_t *ubuntu_parse_active_interfaces(const char *if_list_cmd, const char *if_details_cmd);
 
 route_list_t *ubuntu_parse_active_routes(const char *cmd);
 
 if_data_t *ubuntu_parse_persist_interfaces(const char *file_loc);
 
-route_list_t *ubuntu_parse_persist_routes(const char *file_loc);
-
 bool map_routes_to_if(if_data_t *sys_ifs, route_list_t *route_list);
 
-void free_interface(interface_t *iface);
+bool ubuntu_stream_routes(const char *cmd, if_data_t *sys_ifs);
+
+bool if_data_reserve(if_data_t *ifs, int num_if);
 
 #endif
\ No newline at end of file
@@ -7,8 +7,33 @@
  * @copyright Copyright 2020, Hyannis Port Research, Inc. All rights reserved.
  */
 
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
 #include "nsync_utils.h"
+#include "nsync_kwhash.h"
 
+extern char **environ;
+
+/** Most external commands run at once, set with -j */
+int exec_max_jobs = EXEC_DEFAULT_JOBS;
+
+/** Longest a single command may run in ms, 0 for no limit, set with -t */
+int exec_timeout_ms = EXEC_DEFAULT_TIMEOUT_MS;
+
+/** Monotonic time in ms by which the whole run must be done, 0 for none */
+static long long exec_budget_end;
+
+/** Output of prefetched commands */
+static exec_job_t *exec_cache;
+static int exec_cache_num;
+
+/** The arena parse results are allocated from, set by the driver */
+arena_t *parse_arena;
+intern_table_t *parse_strings;
 
 /** Global Error Message String */
 char err_msg[ERR_LEN];
@@ -39,6 +64,46 @@ bool file_exists(const char *path)
     return false;
 }
 
+/**
+ * @brief Reads a whole file into one buffer
+ * 
+ * @param path the file
+ * @param len receives the length of the file
+ * @param arena the arena to allocate the buffer from, or NULL for a buffer
+ * the caller frees
+ * @returns a NUL-terminated buffer, or NULL with errno set if the file
+ * could not be read
+ */
+char *file_read(const char *path, size_t *len, arena_t *arena)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        int err = errno;
+        if (fd >= 0)
+            close(fd);
+        errno = err;
+        return NULL;
+    }
+
+    char *buf = arena ? arena_alloc(arena, st.st_size + 1) : malloc(st.st_size + 1);
+    if (!buf) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    size_t n = 0;
+    ssize_t got;
+    while (n < (size_t)st.st_size && (got = pread(fd, &buf[n], st.st_size - n, n)) > 0)
+        n += got;
+    close(fd);
+    buf[n] = '\0';
+
+    *len = n;
+    return buf;
+}
+
 /**
  * @brief Perform strncpy, but ensure null-termination
  * Intended to avoid buffer overruns.
@@ -64,6 +129,555 @@ char *safe_strncpy(char *dest, const char *src, size_t n)
     return dest;
 }
 
+/**
+ * @brief Makes a slice covering a whole string
+ * @param str the string
+ * @returns the slice
+ */
+str_slice_t slice_make(const char *str)
+{
+    return (str_slice_t){ str, strlen(str) };
+}
+
+/**
+ * @brief Splits a slice into fields in one pass, without copying or
+ * modifying it. Like strsep, every delimiter ends a field, so consecutive
+ * delimiters give empty fields.
+ *
+ * @param src the slice to split
+ * @param delim the delimiter characters
+ * @param fields receives the fields
+ * @param max the most fields to return; the rest of the slice is not scanned
+ * @returns the number of fields found
+ */
+int slice_split(str_slice_t src, const char *delim, str_slice_t *fields, int max)
+{
+    int num = 0;
+    const char *start = src.ptr;
+    const char *end = src.ptr + src.len;
+
+    for (const char *p = src.ptr; num < max; p++) {
+        if (p == end || strchr(delim, *p)) {
+            fields[num++] = (str_slice_t){ start, p - start };
+            if (p == end)
+                break;
+            start = p + 1;
+        }
+    }
+    return num;
+}
+
+/**
+ * @brief Takes the next word off the front of a slice, skipping any run of
+ * delimiters before it
+ *
+ * @param rest the unscanned part of the slice, advanced past the word
+ * @param delim the delimiter characters
+ * @param word receives the word
+ * @returns false if only delimiters were left
+ */
+bool slice_next(str_slice_t *rest, const char *delim, str_slice_t *word)
+{
+    const char *p = rest->ptr;
+    const char *end = rest->ptr + rest->len;
+
+    while (p < end && strchr(delim, *p))
+        p++;
+    const char *start = p;
+    while (p < end && !strchr(delim, *p))
+        p++;
+
+    *word = (str_slice_t){ start, p - start };
+    *rest = (str_slice_t){ p, end - p };
+    return word->len > 0;
+}
+
+/**
+ * @brief Gets one field of a delimited slice, scanning only up to it
+ *
+ * @param src the slice
+ * @param col 1-indexed column, 0 for the whole slice (awk-style)
+ * @param delim the delimiter characters
+ * @returns the field, or an empty slice if there are fewer columns
+ */
+str_slice_t slice_field(str_slice_t src, size_t col, const char *delim)
+{
+    if (col == 0)
+        return src;
+
+    const char *start = src.ptr;
+    const char *end = src.ptr + src.len;
+    for (const char *p = src.ptr; ; p++) {
+        if (p == end || strchr(delim, *p)) {
+            if (--col == 0)
+                return (str_slice_t){ start, p - start };
+            if (p == end)
+                break;
+            start = p + 1;
+        }
+    }
+    return (str_slice_t){ src.ptr + src.len, 0 };
+}
+
+/**
+ * @brief Trims characters off both ends of a slice
+ * @param s the slice
+ * @param seps the characters to trim, NULL for whitespace
+ * @returns the trimmed slice
+ */
+str_slice_t slice_trim(str_slice_t s, const char *seps)
+{
+    if (seps == NULL)
+        seps = "\t\n\v\f\r ";
+    while (s.len && strchr(seps, s.ptr[0])) {
+        s.ptr++;
+        s.len--;
+    }
+    while (s.len && strchr(seps, s.ptr[s.len - 1]))
+        s.len--;
+    return s;
+}
+
+/**
+ * @brief Compares a slice to a string
+ * @returns true if they are equal
+ */
+bool slice_eq(str_slice_t s, const char *str)
+{
+    return strncmp(s.ptr, str, s.len) == 0 && str[s.len] == '\0';
+}
+
+/**
+ * @brief Copies a slice into a buffer as a string, truncating if necessary.
+ * The slice may point into the buffer itself.
+ *
+ * @param dest the buffer
+ * @param s the slice
+ * @param destsz the size of dest
+ * @returns dest
+ */
+char *slice_copy(char *dest, str_slice_t s, size_t destsz)
+{
+    if (!destsz)
+        return dest;
+    size_t n = min(s.len, destsz - 1);
+    if (n)
+        memmove(dest, s.ptr, n);
+    dest[n] = '\0';
+    return dest;
+}
+
+/**
+ * @brief Copies a slice into a new string of exactly its length, allocated
+ * from the parse arena
+ * @param s the slice
+ * @returns the string, or NULL if memory could not be allocated (err_msg is set)
+ */
+char *slice_dup(str_slice_t s)
+{
+    return arena_strndup(parse_arena, s.ptr, s.len);
+}
+
+/**
+ * @brief Interns a slice in the parse string table, so equal values share
+ * one copy and compare equal by pointer
+ * @param s the slice
+ * @returns the canonical string, or NULL if memory could not be allocated
+ * (err_msg is set)
+ */
+const char *slice_intern(str_slice_t s)
+{
+    return intern(parse_strings, parse_arena, s);
+}
+
+/**
+ * @brief Rounds an allocation size up to the arena's alignment
+ */
+static size_t arena_round(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/**
+ * @brief Allocates zeroed memory from an arena. Small allocations are
+ * carved from the current block; one that does not fit starts a new block,
+ * and one larger than a quarter block gets a block of its own so the
+ * current block keeps being used.
+ * @param arena the arena
+ * @param size the number of bytes
+ * @returns the memory, or NULL if memory could not be allocated (err_msg is set)
+ */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    size = arena_round(size ? size : 1);
+    arena_block_t *block = arena->head;
+
+    if (!block || block->cap - block->used < size) {
+        bool own = size > ARENA_BLOCK_SIZE / 4;
+        size_t cap = own ? size : ARENA_BLOCK_SIZE;
+        arena_block_t *new_block = malloc(sizeof(arena_block_t) + cap);
+        MEM_CHECK(new_block, NULL);
+        new_block->next = NULL;
+        new_block->cap = cap;
+        new_block->used = 0;
+
+        /** A block that is replaced or holds a single allocation is only kept to be freed */
+        arena_block_t *retired = own ? new_block : block;
+        if (!own)
+            arena->head = new_block;
+        if (retired) {
+            retired->next = arena->full;
+            arena->full = retired;
+        }
+        block = new_block;
+    }
+
+    void *ptr = &block->data[block->used];
+    block->used += size;
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+/**
+ * @brief Grows an allocation of an arena. The most recent allocation of the
+ * current block grows in place when the block has room; anything else is
+ * copied to a new allocation and the old one is left until the reset.
+ * @param arena the arena
+ * @param ptr the allocation, or NULL for a new one
+ * @param old_size its current size
+ * @param new_size the size it needs, not less than old_size
+ * @returns the grown allocation, with the new bytes zeroed, or NULL if
+ * memory could not be allocated (err_msg is set)
+ */
+void *arena_grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size)
+{
+    if (!ptr)
+        return arena_alloc(arena, new_size);
+
+    arena_block_t *block = arena->head;
+    size_t old_r = arena_round(old_size ? old_size : 1);
+    size_t new_r = arena_round(new_size ? new_size : 1);
+    if (block && (char *)ptr + old_r == &block->data[block->used] &&
+        block->cap - block->used >= new_r - old_r) {
+        block->used += new_r - old_r;
+        memset((char *)ptr + old_size, 0, new_r - old_size);
+        return ptr;
+    }
+
+    void *grown = arena_alloc(arena, new_size);
+    MEM_CHECK(grown, NULL);
+    memcpy(grown, ptr, old_size);
+    return grown;
+}
+
+/**
+ * @brief Copies part of a string into an arena
+ * @param arena the arena
+ * @param str the string, need not be NUL-terminated
+ * @param len the number of bytes to copy
+ * @returns the NUL-terminated copy, or NULL if memory could not be
+ * allocated (err_msg is set)
+ */
+char *arena_strndup(arena_t *arena, const char *str, size_t len)
+{
+    char *copy = arena_alloc(arena, len + 1);
+    MEM_CHECK(copy, NULL);
+    if (len)
+        memcpy(copy, str, len);
+    return copy;
+}
+
+/**
+ * @brief Copies a string into an arena
+ * @param arena the arena
+ * @param str the string
+ * @returns the copy, or NULL if memory could not be allocated (err_msg is set)
+ */
+char *arena_strdup(arena_t *arena, const char *str)
+{
+    return arena_strndup(arena, str, strlen(str));
+}
+
+/**
+ * @brief Appends to a string allocated from an arena, in place when it is
+ * the arena's most recent allocation
+ * @param arena the arena
+ * @param str the string, or NULL to start a new one
+ * @param add the bytes to append, need not be NUL-terminated
+ * @param len the number of bytes to append
+ * @returns the string, which may have moved, or NULL if memory could not
+ * be allocated (err_msg is set)
+ */
+char *arena_strcat(arena_t *arena, char *str, const char *add, size_t len)
+{
+    size_t old_len = str ? strlen(str) : 0;
+    char *grown = arena_grow(arena, str, str ? old_len + 1 : 0, old_len + len + 1);
+    MEM_CHECK(grown, NULL);
+    memcpy(&grown[old_len], add, len);
+    grown[old_len + len] = '\0';
+    return grown;
+}
+
+/**
+ * @brief Releases everything allocated from an arena at once
+ * @param arena the arena, empty and reusable afterwards
+ */
+void arena_reset(arena_t *arena)
+{
+    free(arena->head);
+    for (arena_block_t *block = arena->full; block; ) {
+        arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->full = NULL;
+}
+
+/**
+ * @brief Doubles the slots of an intern table. The old slots stay in the
+ * arena until it is reset; the stored hashes spare rehashing the strings.
+ * @param table the table
+ * @param arena the arena the table lives in
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+static bool intern_grow(intern_table_t *table, arena_t *arena)
+{
+    int num_slots = table->num_slots ? table->num_slots * 2 : 256;
+    const char **slots = arena_alloc(arena, num_slots * sizeof(*slots));
+    MEM_CHECK(slots, false);
+    uint32_t *hashes = arena_alloc(arena, num_slots * sizeof(*hashes));
+    MEM_CHECK(hashes, false);
+
+    int mask = num_slots - 1;
+    for (int i = 0; i < table->num_slots; i++) {
+        if (!table->slots[i])
+            continue;
+        int s = table->hashes[i] & mask;
+        while (slots[s])
+            s = (s + 1) & mask;
+        slots[s] = table->slots[i];
+        hashes[s] = table->hashes[i];
+    }
+    table->slots = slots;
+    table->hashes = hashes;
+    table->num_slots = num_slots;
+    return true;
+}
+
+/**
+ * @brief Gets the canonical copy of a string, adding it to the table the
+ * first time it is seen
+ * @param table the table
+ * @param arena the arena the table and its strings live in
+ * @param str the string, not necessarily NUL-terminated
+ * @returns the canonical string, or NULL if memory could not be allocated
+ * (err_msg is set)
+ */
+const char *intern(intern_table_t *table, arena_t *arena, str_slice_t str)
+{
+    if (2 * (table->num + 1) > table->num_slots && !intern_grow(table, arena))
+        return NULL;
+
+    uint32_t hash = kw_hash(str.ptr, str.len, 0);
+    int mask = table->num_slots - 1;
+    for (int s = hash & mask;; s = (s + 1) & mask) {
+        const char *cur = table->slots[s];
+        if (!cur) {
+            char *copy = arena_strndup(arena, str.ptr, str.len);
+            MEM_CHECK(copy, NULL);
+            table->slots[s] = copy;
+            table->hashes[s] = hash;
+            table->num++;
+            return copy;
+        }
+        if (table->hashes[s] == hash && strncmp(cur, str.ptr, str.len) == 0 && cur[str.len] == '\0')
+            return cur;
+    }
+}
+
+/**
+ * @brief Looks up a string in an intern table without adding it
+ * @param table the table
+ * @param str the string, not necessarily NUL-terminated
+ * @returns the canonical string, or NULL if it was never interned
+ */
+const char *intern_find(const intern_table_t *table, str_slice_t str)
+{
+    if (!table->num_slots)
+        return NULL;
+
+    uint32_t hash = kw_hash(str.ptr, str.len, 0);
+    int mask = table->num_slots - 1;
+    for (int s = hash & mask; table->slots[s]; s = (s + 1) & mask) {
+        const char *cur = table->slots[s];
+        if (table->hashes[s] == hash && strncmp(cur, str.ptr, str.len) == 0 && cur[str.len] == '\0')
+            return cur;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Empties an intern table. Its memory belongs to its arena, so this
+ * goes with resetting the arena.
+ * @param table the table
+ */
+void intern_reset(intern_table_t *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * @brief Makes room in a dynamic array allocated from an arena. The
+ * capacity doubles, so pushing n elements copies O(n) elements in total.
+ * @param arena the arena
+ * @param arr the array, or NULL for a new one
+ * @param cap its capacity, updated when it grows
+ * @param need the number of elements it must hold
+ * @param size the size of one element
+ * @returns the array, which may have moved, with any new elements zeroed,
+ * or NULL if memory could not be allocated (err_msg is set)
+ */
+void *arena_array_grow(arena_t *arena, void *arr, int *cap, int need, size_t size)
+{
+    if (arr && need <= *cap)
+        return arr;
+
+    int new_cap = *cap ? *cap : ARRAY_MIN_CAP;
+    while (new_cap < need)
+        new_cap *= 2;
+
+    void *grown = arena_grow(arena, arr, arr ? (size_t)*cap * size : 0, (size_t)new_cap * size);
+    MEM_CHECK(grown, NULL);
+    *cap = new_cap;
+    return grown;
+}
+
+/**
+ * @brief Sizes a bitset with every bit clear
+ * @param set the bitset
+ * @param num_bits the number of bits it holds
+ * @param arena the arena to allocate the bits from
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+bool bitset_init(bitset_t *set, int num_bits, arena_t *arena)
+{
+    set->num_bits = num_bits;
+    set->words = arena_alloc(arena, ((num_bits + 63) / 64) * sizeof(uint64_t));
+    MEM_CHECK(set->words, false);
+    return true;
+}
+
+/**
+ * @brief Sets a bit of a bitset
+ * @param set the bitset
+ * @param i the bit, less than the bitset's size
+ */
+void bitset_set(bitset_t *set, int i)
+{
+    set->words[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+/**
+ * @brief Tests a bit of a bitset
+ * @param set the bitset
+ * @param i the bit, less than the bitset's size
+ * @returns true if the bit is set
+ */
+bool bitset_test(const bitset_t *set, int i)
+{
+    return (set->words[i / 64] >> (i % 64)) & 1;
+}
+
+/**
+ * @brief Finds the lowest clear bit of a bitset, a word at a time
+ * @param set the bitset
+ * @returns the bit, or the bitset's size if every bit is set
+ */
+int bitset_first_clear(const bitset_t *set)
+{
+    for (int w = 0; w * 64 < set->num_bits; w++) {
+        if (~set->words[w] == 0)
+            continue;
+        int i = w * 64 + __builtin_ctzll(~set->words[w]);
+        return i < set->num_bits ? i : set->num_bits;
+    }
+    return set->num_bits;
+}
+
+/** Cells compared at once; GCC lowers the vector to scalars where there is no SIMD */
+#define IF_TABLE_LANES 2
+typedef uint64_t if_lanes_t __attribute__((vector_size(IF_TABLE_LANES * sizeof(uint64_t))));
+
+/**
+ * @brief Sizes a table of interfaces with every cell zero
+ * @param table the table
+ * @param num_cols the number of columns, at most IF_TABLE_MAX_COLS
+ * @param num_rows the number of interfaces
+ * @param arena the arena to allocate the columns from
+ * @returns false if memory could not be allocated (err_msg is set)
+ */
+bool if_table_init(if_table_t *table, int num_cols, int num_rows, arena_t *arena)
+{
+    int padded = (num_rows + IF_TABLE_LANES - 1) / IF_TABLE_LANES * IF_TABLE_LANES;
+    memset(table, 0, sizeof(*table));
+    table->num_cols = num_cols;
+    table->num_rows = num_rows;
+
+    /** One allocation, cut into columns that each start on a vector */
+    uint64_t *cells = arena_alloc(arena, (size_t)num_cols * padded * sizeof(uint64_t));
+    MEM_CHECK(cells, false);
+    for (int c = 0; c < num_cols; c++)
+        table->cols[c] = &cells[(size_t)c * padded];
+    return true;
+}
+
+/**
+ * @brief Fills the IF_TABLE_ADDR_COLS cells of an address. The prefix length
+ * is left out, as it is by ip_addr_eq.
+ * @param table the table
+ * @param col the first column of the address
+ * @param row the interface
+ * @param addr the address; unset addresses leave the cells zero
+ */
+void if_table_set_addr(if_table_t *table, int col, int row, const ip_addr_t *addr)
+{
+    uint64_t half[2] = { 0, 0 };
+    memcpy(half, addr->bytes, addr->family == AF_INET6 ? 16 : 4);
+    IF_CELL(table, col, row) = addr->family;
+    IF_CELL(table, col + 1, row) = half[0];
+    IF_CELL(table, col + 2, row) = half[1];
+}
+
+/**
+ * @brief Compares two tables of the same interfaces column by column, a
+ * vector of cells at a time
+ * @param a a table
+ * @param b a table with the same columns and rows
+ * @param arena the arena to allocate the result from
+ * @returns one diff per row with the bit of every column whose cells differ
+ * set, or NULL if memory could not be allocated (err_msg is set)
+ */
+uint64_t *if_table_diff(const if_table_t *a, const if_table_t *b, arena_t *arena)
+{
+    int padded = (a->num_rows + IF_TABLE_LANES - 1) / IF_TABLE_LANES * IF_TABLE_LANES;
+    uint64_t *diff = arena_alloc(arena, padded * sizeof(uint64_t));
+    MEM_CHECK(diff, NULL);
+
+    for (int r = 0; r < padded; r += IF_TABLE_LANES) {
+        if_lanes_t d = { 0 };
+        for (int c = 0; c < a->num_cols; c++) {
+            if_lanes_t va, vb;
+            memcpy(&va, &a->cols[c][r], sizeof(va));
+            memcpy(&vb, &b->cols[c][r], sizeof(vb));
+            /** Lanes that differ compare to all ones */
+            d |= ((if_lanes_t)(va != vb) & 1) << c;
+        }
+        memcpy(&diff[r], &d, sizeof(d));
+    }
+    return diff;
+}
+
 /**
  * @brief Get field(s) from a delimted line with filtered leading and trailing whitespace.
  *
@@ -79,23 +693,7 @@ char *safe_strncpy(char *dest, const char *src, size_t n)
  */
 char *get_field_delim(char *dest, char const *src, size_t col, size_t destsz, const char * delim)
 {
-    /** Make a mutable copy of the input string for tokenizing.*/
-    char srccpy[strlen(src) + 1];
-    strcpy(srccpy, src);
-
-    /** Tokenize until the requested field is found. */
-    size_t i = 0;
-    char *srccpyptr = srccpy;
-    char const *field = srccpyptr;
-    while ((i != col) && ((field = strsep(&srccpyptr, delim)) != NULL)) { ++i; }
-    if ((i != col) || (field == NULL)) { return safe_strncpy(dest, "", destsz); }
-
-    /** Trim leading and trailing whitespace. */
-    char const *start = field;
-    char const *end = field + strlen(field);
-
-    /** Copy the trimmed field to the user, truncating if necessary. */
-    return safe_strncpy(dest, start, min((size_t)(end - start) + 1, destsz));
+    return slice_copy(dest, slice_field(slice_make(src), col, delim), destsz);
 }
 
 /**
@@ -184,23 +782,792 @@ bool dir_check(const char *path)
 }
 
 /**
- * @brief convert number of netmask bits into a netmask string 
+ * @brief Reads a dotted-quad IPv4 address. Octets are decimal, so leading
+ * zeros do not change their value.
+ * @param text the address
+ * @param bytes receives the address in network byte order
+ * @returns false if text is not an IPv4 address
+ */
+static bool ip_parse_ipv4(str_slice_t text, uint8_t bytes[4])
+{
+    int octet = 0, digits = 0;
+    unsigned val = 0;
+    for (size_t i = 0; i <= text.len; i++) {
+        if (i == text.len || text.ptr[i] == '.') {
+            if (digits == 0 || octet == 4)
+                return false;
+            bytes[octet++] = val;
+            val = 0;
+            digits = 0;
+        } else if (isdigit((unsigned char)text.ptr[i])) {
+            val = val * 10 + (text.ptr[i] - '0');
+            digits++;
+            if (val > 255)
+                return false;
+        } else {
+            return false;
+        }
+    }
+    return octet == 4;
+}
+
+/**
+ * @brief Parses an IPv4 or IPv6 address or netmask, optionally followed by
+ * a prefix length, e.g. 10.0.0.1, 255.255.255.0, 10.0.0.1/24 or fe80::1/64
+ * @param text the address
+ * @param addr receives the address; unset if text is not an address
+ * @returns false if text is not an address
+ */
+bool ip_addr_parse(str_slice_t text, ip_addr_t *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->prefix_len = IP_NO_PREFIX;
+
+    const char *slash = memchr(text.ptr, '/', text.len);
+    str_slice_t host = { text.ptr, slash ? (size_t)(slash - text.ptr) : text.len };
+
+    int family = AF_INET;
+    if (!ip_parse_ipv4(host, addr->bytes)) {
+        char buf[INET6_ADDRSTRLEN];
+        if (host.len >= sizeof(buf))
+            return false;
+        slice_copy(buf, host, sizeof(buf));
+        if (inet_pton(AF_INET6, buf, addr->bytes) != 1) {
+            memset(addr->bytes, 0, sizeof(addr->bytes));
+            return false;
+        }
+        family = AF_INET6;
+    }
+
+    if (slash) {
+        unsigned max = family == AF_INET ? 32 : 128, len = 0;
+        size_t n = text.len - (slash + 1 - text.ptr);
+        if (n == 0 || n > 3)
+            return false;
+        for (size_t i = 0; i < n; i++) {
+            if (!isdigit((unsigned char)slash[1 + i]))
+                return false;
+            len = len * 10 + (slash[1 + i] - '0');
+        }
+        if (len > max)
+            return false;
+        addr->prefix_len = len;
+    }
+    addr->family = family;
+    return true;
+}
+
+/**
+ * @brief Sets an address from its binary form, as netlink and procfs give it
+ * @param addr the address
+ * @param family AF_INET or AF_INET6
+ * @param bytes the address in network byte order
+ * @param prefix_len the prefix length, or IP_NO_PREFIX
+ */
+void ip_addr_set(ip_addr_t *addr, int family, const void *bytes, int prefix_len)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->family = family;
+    addr->prefix_len = prefix_len;
+    memcpy(addr->bytes, bytes, family == AF_INET6 ? 16 : 4);
+}
+
+/**
+ * @brief Makes the IPv4 netmask of a prefix length
  * @param bits the number of bits on in the netmask
- * @returns netmask string
- */
-char *bitmask_to_netmask_ipv4(int bits){
-    
-    unsigned bitmask = (~0U) << (32-bits);
-    /** Special Case */
-    if (!bits) bitmask = 0;
-    /** ipv4: a.b.c.d */
-    u_int8_t d = ((u_int8_t *) &bitmask)[0];
-    u_int8_t c = ((u_int8_t *) &bitmask)[1];
-    u_int8_t b = ((u_int8_t *) &bitmask)[2];
-    u_int8_t a = ((u_int8_t *) &bitmask)[3];
-
-    char *netmask = malloc(20);
-    sprintf(netmask, "%d.%d.%d.%d", a, b, c, d);
-
-    return netmask;
+ * @param mask receives the netmask
+ */
+void ip_addr_netmask(int bits, ip_addr_t *mask)
+{
+    uint32_t bitmask = bits <= 0 ? 0 : bits >= 32 ? ~0U : (~0U) << (32 - bits);
+    bitmask = htonl(bitmask);
+    ip_addr_set(mask, AF_INET, &bitmask, IP_NO_PREFIX);
+}
+
+/**
+ * @brief Gets the prefix length of an IPv4 netmask
+ * @param mask the netmask
+ * @returns the number of bits on in the netmask, or -1 if it is unset, not
+ * IPv4 or its bits are not contiguous
+ */
+int ip_netmask_len(const ip_addr_t *mask)
+{
+    if (mask->family != AF_INET)
+        return -1;
+    uint32_t bitmask;
+    memcpy(&bitmask, mask->bytes, sizeof(bitmask));
+    bitmask = ntohl(bitmask);
+    if (~bitmask & (~bitmask + 1))
+        return -1;
+    return __builtin_popcount(bitmask);
+}
+
+/**
+ * @brief Compares two addresses by value. Prefix lengths are not compared.
+ * @param a an address
+ * @param b another address
+ * @returns true if both are unset or both hold the same address
+ */
+bool ip_addr_eq(const ip_addr_t *a, const ip_addr_t *b)
+{
+    if (a->family != b->family)
+        return false;
+    return memcmp(a->bytes, b->bytes, a->family == AF_INET6 ? 16 : 4) == 0;
+}
+
+/**
+ * @brief Formats an address, with its prefix length if it was written
+ * with one
+ * @param addr the address
+ * @param buf the output buffer
+ * @returns buf, empty if the address is unset
+ */
+const char *ip_addr_str(const ip_addr_t *addr, char buf[IP_ADDR_STR_LEN])
+{
+    buf[0] = '\0';
+    if (!IP_ADDR_IS_SET(*addr))
+        return buf;
+    inet_ntop(addr->family, addr->bytes, buf, IP_ADDR_STR_LEN);
+    if (addr->prefix_len != IP_NO_PREFIX)
+        sprintf(buf + strlen(buf), "/%u", addr->prefix_len);
+    return buf;
+}
+
+/**
+ * @brief Splits a command into its arguments on whitespace. No shell is
+ * involved, so there is no quoting and no expansion.
+ *
+ * @param cmd the command, modified in place
+ * @param argv the output array, NULL-terminated
+ * @param max the size of argv
+ * @returns the number of arguments, or -1 if there are too many
+ */
+int split_cmd(char *cmd, char *argv[], int max)
+{
+    int argc = 0;
+    char *save = NULL;
+    for (char *arg = strtok_r(cmd, " \t\n", &save); arg; arg = strtok_r(NULL, " \t\n", &save)) {
+        if (argc == max - 1)
+            return -1;
+        argv[argc++] = arg;
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+/**
+ * @brief Starts a program with posix_spawn
+ *
+ * @param argv the program and its arguments, NULL-terminated. The program
+ * is looked up in PATH.
+ * @param out_fd if not NULL, receives the read end of a pipe connected to
+ * the program's standard output. Both ends are close-on-exec, so children
+ * running side by side never hold each other's pipes open.
+ * @returns the pid of the child, or -1 if it could not be started (err_msg is set)
+ */
+static pid_t exec_spawn(char *const argv[], int *out_fd)
+{
+    int fds[2] = { -1, -1 };
+    if (out_fd) {
+        if (pipe(fds) < 0) {
+            sprintf(err_msg, "could not create pipe: %s", strerror(errno));
+            return -1;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (out_fd)
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    /** Each child leads its own process group, so a timeout stops anything it started too */
+    short flags = POSIX_SPAWN_SETPGROUP;
+#ifdef POSIX_SPAWN_USEVFORK
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+    posix_spawnattr_setflags(&attr, flags);
+    posix_spawnattr_setpgroup(&attr, 0);
+
+    pid_t pid;
+    int rc = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (fds[1] >= 0)
+        close(fds[1]);
+
+    if (rc != 0) {
+        sprintf(err_msg, "could not run %s: %s", argv[0], strerror(rc));
+        if (fds[0] >= 0)
+            close(fds[0]);
+        return -1;
+    }
+
+    if (out_fd)
+        *out_fd = fds[0];
+    return pid;
+}
+
+/**
+ * @returns the current monotonic time in ms
+ */
+static long long exec_now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Sets the time budget for the whole run, starting now. Commands
+ * started later are cut short so that the run ends within the budget.
+ * @param ms the budget in ms, 0 for no limit
+ */
+void exec_set_budget(int ms)
+{
+    exec_budget_end = ms > 0 ? exec_now_ms() + ms : 0;
+}
+
+/**
+ * @returns how long in ms a command started now may run: the smaller of
+ * the per-command timeout and what is left of the run's budget. -1 if
+ * there is no limit, 0 if the budget is spent.
+ */
+int exec_time_left(void)
+{
+    long long left = exec_timeout_ms > 0 ? exec_timeout_ms : -1;
+    if (exec_budget_end) {
+        long long budget = exec_budget_end - exec_now_ms();
+        if (budget < 0)
+            budget = 0;
+        if (left < 0 || budget < left)
+            left = budget;
+    }
+    return left;
+}
+
+/**
+ * @returns the monotonic time in ms by which a command started now must
+ * be done, 0 for no limit
+ */
+static long long exec_deadline(void)
+{
+    int left = exec_time_left();
+    return left < 0 ? 0 : exec_now_ms() + left;
+}
+
+/**
+ * @returns the ms left until a deadline, for poll: -1 for no deadline,
+ * 0 once it has passed
+ */
+static int exec_poll_ms(long long deadline)
+{
+    if (!deadline)
+        return -1;
+    long long left = deadline - exec_now_ms();
+    return left > 0 ? left : 0;
+}
+
+/**
+ * @brief Decodes the status of a reaped child
+ * @returns the exit status, or 128 + the signal if it was killed
+ */
+static int exec_status(int status)
+{
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    return 128 + WTERMSIG(status);
+}
+
+/**
+ * @brief Stops a child that ran past its deadline, along with its process
+ * group: SIGTERM first, then SIGKILL if it has not exited after
+ * EXEC_KILL_GRACE_MS. The child is reaped.
+ * @param pid the child
+ * @param name the name of the program, for the error message
+ * @returns EXEC_TIMED_OUT (err_msg is set)
+ */
+static int exec_kill(pid_t pid, const char *name)
+{
+    kill(-pid, SIGTERM);
+
+    int status;
+    long long grace_end = exec_now_ms() + EXEC_KILL_GRACE_MS;
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        if (exec_now_ms() >= grace_end) {
+            kill(-pid, SIGKILL);
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+            break;
+        }
+        nanosleep(&(struct timespec){ 0, EXEC_REAP_POLL_NS }, NULL);
+    }
+
+    sprintf(err_msg, "%s timed out", name);
+    return EXEC_TIMED_OUT;
+}
+
+/**
+ * @brief Reaps a child, stopping it if it is still running at the deadline
+ * @param pid the child
+ * @param name the name of the program, for error messages
+ * @param deadline monotonic time in ms, 0 to wait as long as it takes
+ * @returns the exit status of the child (128 + the signal if it was
+ * killed), EXEC_TIMED_OUT, or -1 on error (err_msg is set)
+ */
+static int exec_wait(pid_t pid, const char *name, long long deadline)
+{
+    int status;
+    pid_t rc;
+    while ((rc = waitpid(pid, &status, deadline ? WNOHANG : 0)) <= 0) {
+        if (rc < 0 && errno != EINTR) {
+            sprintf(err_msg, "could not wait for %s: %s", name, strerror(errno));
+            return -1;
+        }
+        if (rc == 0) {
+            if (exec_now_ms() >= deadline)
+                return exec_kill(pid, name);
+            nanosleep(&(struct timespec){ 0, EXEC_REAP_POLL_NS }, NULL);
+        }
+    }
+    return exec_status(status);
+}
+
+/**
+ * @brief Runs a program with posix_spawn and hands its standard output to
+ * a callback as it arrives. The program is stopped if it runs for longer
+ * than exec_time_left() allows. The child is always reaped.
+ *
+ * @param argv the program and its arguments, NULL-terminated. The program
+ * is looked up in PATH.
+ * @param on_chunk called with each chunk of output. If NULL, output is not
+ * captured and goes to our standard output.
+ * @param ctx passed through to on_chunk
+ * @returns the exit status of the program (128 + the signal if it was
+ * killed), EXEC_TIMED_OUT, or -1 if it could not be run or on_chunk
+ * failed (err_msg is set)
+ */
+int exec_stream(char *const argv[], exec_chunk_fn on_chunk, void *ctx)
+{
+    if (exec_time_left() == 0) {
+        sprintf(err_msg, "%s not run, the time budget is spent", argv[0]);
+        return EXEC_TIMED_OUT;
+    }
+
+    long long deadline = exec_deadline();
+    int fd = -1;
+    pid_t pid = exec_spawn(argv, on_chunk ? &fd : NULL);
+    if (pid < 0)
+        return -1;
+
+    /** keep draining after a failed callback so the child cannot block */
+    bool reading = true;
+    if (on_chunk) {
+        char buf[EXEC_READ_LEN];
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        while (true) {
+            int ready = poll(&pfd, 1, exec_poll_ms(deadline));
+            if (ready == 0) {
+                close(fd);
+                return exec_kill(pid, argv[0]);
+            }
+            if (ready < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n == 0)
+                break;
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            if (reading && !on_chunk(ctx, buf, n))
+                reading = false;
+        }
+        close(fd);
+    }
+
+    int status = exec_wait(pid, argv[0], deadline);
+    return reading || status == EXEC_TIMED_OUT ? status : -1;
+}
+
+/**
+ * @brief Appends a chunk of output to an exec_buf_t, keeping it
+ * NUL-terminated
+ * @returns false if memory could not be allocated
+ */
+static bool exec_buf_append(void *ctx, const char *chunk, size_t len)
+{
+    exec_buf_t *buf = ctx;
+    if (buf->len + len + 1 > buf->cap) {
+        size_t new_cap = buf->cap ? buf->cap : EXEC_READ_LEN;
+        while (new_cap < buf->len + len + 1)
+            new_cap *= 2;
+        char *grown = realloc(buf->data, new_cap);
+        MEM_CHECK(grown, false);
+        buf->data = grown;
+        buf->cap = new_cap;
+    }
+    memcpy(&buf->data[buf->len], chunk, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+    return true;
+}
+
+/**
+ * @brief Runs a program and captures its standard output
+ *
+ * @param argv the program and its arguments, NULL-terminated
+ * @param out the buffer for the output, or NULL to leave output alone.
+ * Any previous contents are replaced.
+ * @returns the exit status of the program, or -1 if it could not be run
+ * (err_msg is set)
+ */
+int exec_argv(char *const argv[], exec_buf_t *out)
+{
+    if (!out)
+        return exec_stream(argv, NULL, NULL);
+
+    out->len = 0;
+    if (!exec_buf_append(out, "", 0))
+        return -1;
+    return exec_stream(argv, &exec_buf_append, out);
+}
+
+/**
+ * @brief Hands over the output of a prefetched command, if there is one
+ *
+ * @param cmd the command
+ * @param out receives the output; the buffers are swapped, so nothing is copied
+ * @param status receives the exit status
+ * @returns true if the command had been prefetched
+ */
+static bool exec_cache_take(const char *cmd, exec_buf_t *out, int *status)
+{
+    for (int i = 0; i < exec_cache_num; i++) {
+        exec_job_t *job = &exec_cache[i];
+        if (job->consumed || job->status == -1 || strcmp(job->cmd, cmd) != 0)
+            continue;
+
+        exec_buf_t tmp = *out;
+        *out = job->out;
+        job->out = tmp;
+        job->consumed = true;
+        *status = job->status;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Runs a command given as a single string, split on whitespace
+ *
+ * @param cmd the command
+ * @param out the buffer for the output, or NULL to leave output alone
+ * @returns the exit status of the command, EXEC_TIMED_OUT, or -1 if it
+ * could not be run (err_msg is set)
+ */
+int exec_cmd(const char *cmd, exec_buf_t *out)
+{
+    int status;
+    if (out && exec_cache_take(cmd, out, &status))
+        goto done;
+
+    char *copy = strdup(cmd);
+    MEM_CHECK(copy, -1);
+
+    char *argv[EXEC_MAX_ARGS];
+    int argc = split_cmd(copy, argv, EXEC_MAX_ARGS);
+    if (argc <= 0) {
+        sprintf(err_msg, "invalid command: %s", cmd);
+        free(copy);
+        return -1;
+    }
+
+    status = exec_argv(argv, out);
+    free(copy);
+
+done:
+    if (status == EXEC_TIMED_OUT)
+        sprintf(err_msg, "`%s` timed out", cmd);
+    return status;
+}
+
+/**
+ * @brief Checks the exit status of a command that was read
+ *
+ * @param cmd the command
+ * @param status what exec_cmd or exec_stream returned
+ * @returns false unless the command succeeded (err_msg is set). errno is
+ * ETIMEDOUT if it timed out.
+ */
+static bool exec_status_ok(const char *cmd, int status)
+{
+    if (status != 0) {
+        if (status == EXEC_TIMED_OUT)
+            errno = ETIMEDOUT;
+        else if (status > 0)
+            sprintf(err_msg, "command `%s` exited with status %d", cmd, status);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs a command and keeps its output, to be read in place
+ *
+ * @param cmd the command
+ * @param out receives the output
+ * @returns false if the command could not be run or failed (err_msg is
+ * set). errno is ETIMEDOUT if it timed out.
+ */
+bool exec_read(const char *cmd, exec_buf_t *out)
+{
+    return exec_status_ok(cmd, exec_cmd(cmd, out));
+}
+
+/**
+ * @brief Runs a command and hands its output to a callback in chunks as it
+ * arrives, so that the output is never held whole. The output of a
+ * prefetched command is handed over in one chunk.
+ *
+ * @param cmd the command
+ * @param on_chunk called with each chunk of output
+ * @param ctx passed through to on_chunk
+ * @returns false if the command could not be run or failed, or on_chunk
+ * failed (err_msg is set). errno is ETIMEDOUT if it timed out.
+ */
+bool exec_read_stream(const char *cmd, exec_chunk_fn on_chunk, void *ctx)
+{
+    int status;
+    exec_buf_t cached = { 0 };
+    if (exec_cache_take(cmd, &cached, &status)) {
+        if (status == 0 && cached.len && !on_chunk(ctx, cached.data, cached.len))
+            status = -1;
+        exec_buf_free(&cached);
+        if (status == EXEC_TIMED_OUT)
+            sprintf(err_msg, "`%s` timed out", cmd);
+        return exec_status_ok(cmd, status);
+    }
+
+    char *copy = strdup(cmd);
+    MEM_CHECK(copy, false);
+
+    char *argv[EXEC_MAX_ARGS];
+    if (split_cmd(copy, argv, EXEC_MAX_ARGS) <= 0) {
+        sprintf(err_msg, "invalid command: %s", cmd);
+        free(copy);
+        return false;
+    }
+
+    status = exec_stream(argv, on_chunk, ctx);
+    free(copy);
+    if (status == EXEC_TIMED_OUT)
+        sprintf(err_msg, "`%s` timed out", cmd);
+    return exec_status_ok(cmd, status);
+}
+
+/**
+ * @brief Runs a command and opens its output as a stream, so that it can
+ * be read with fgets like the output of popen
+ *
+ * @param cmd the command
+ * @param out the buffer holding the output; it must outlive the stream
+ * @returns the stream (close with fclose), or NULL if the command could
+ * not be run or failed (err_msg is set). errno is ETIMEDOUT if it timed out.
+ */
+FILE *exec_open(const char *cmd, exec_buf_t *out)
+{
+    if (!exec_read(cmd, out))
+        return NULL;
+
+    /** fmemopen rejects empty buffers */
+    FILE *fp = fmemopen(out->data, out->len ? out->len : 1, "r");
+    if (!fp)
+        sprintf(err_msg, "could not read the output of %s: %s", cmd, strerror(errno));
+    return fp;
+}
+
+/**
+ * @brief Frees the memory held by an exec_buf_t
+ * @param buf the buffer
+ */
+void exec_buf_free(exec_buf_t *buf)
+{
+    free(buf->data);
+    memset(buf, 0, sizeof(exec_buf_t));
+}
+
+/**
+ * @brief Starts the next job of a batch
+ *
+ * @param job the job
+ * @returns true if the job is running, false if it could not be started
+ * (its status is set to -1) or the time budget is spent (EXEC_TIMED_OUT)
+ */
+static bool exec_job_start(exec_job_t *job)
+{
+    char *copy = strdup(job->cmd);
+    char *argv[EXEC_MAX_ARGS];
+
+    job->status = -1;
+    job->fd = -1;
+    if (exec_time_left() == 0) {
+        job->status = EXEC_TIMED_OUT;
+        free(copy);
+        return false;
+    }
+    if (!copy || split_cmd(copy, argv, EXEC_MAX_ARGS) <= 0) {
+        free(copy);
+        return false;
+    }
+
+    job->out.len = 0;
+    if (!exec_buf_append(&job->out, "", 0)) {
+        free(copy);
+        return false;
+    }
+
+    job->deadline = exec_deadline();
+    job->pid = exec_spawn(argv, &job->fd);
+    free(copy);
+    return job->pid > 0;
+}
+
+/**
+ * @brief Runs a batch of commands side by side, at most max_jobs at a time,
+ * collecting all of their output with poll(). The time taken is close to
+ * that of the slowest command rather than the sum of all of them.
+ *
+ * @param jobs the commands; their output and exit status are filled in
+ * (status -1 if a command could not be started, EXEC_TIMED_OUT if it ran
+ * past exec_time_left() and was stopped)
+ * @param num the number of jobs
+ * @param max_jobs the most commands to run at once
+ * @returns false on a failure of poll itself (err_msg is set)
+ */
+bool exec_run_all(exec_job_t *jobs, int num, int max_jobs)
+{
+    if (max_jobs < 1)
+        max_jobs = 1;
+
+    struct pollfd *pfds = calloc(max_jobs, sizeof(struct pollfd));
+    MEM_CHECK(pfds, false);
+    exec_job_t **running = calloc(max_jobs, sizeof(exec_job_t *));
+    MEM_CHECK(running, false);
+
+    int next = 0, num_running = 0;
+    bool ok = true;
+    char chunk[EXEC_READ_LEN];
+
+    while (ok && (next < num || num_running)) {
+        while (num_running < max_jobs && next < num) {
+            exec_job_t *job = &jobs[next++];
+            if (!exec_job_start(job))
+                continue;
+            running[num_running] = job;
+            pfds[num_running].fd = job->fd;
+            pfds[num_running].events = POLLIN;
+            num_running++;
+        }
+        if (!num_running)
+            continue;
+
+        /** wake up for the earliest deadline */
+        int timeout = -1;
+        for (int i = 0; i < num_running; i++) {
+            int left = exec_poll_ms(running[i]->deadline);
+            if (left >= 0 && (timeout < 0 || left < timeout))
+                timeout = left;
+        }
+
+        if (poll(pfds, num_running, timeout) < 0) {
+            if (errno == EINTR)
+                continue;
+            sprintf(err_msg, "poll failed: %s", strerror(errno));
+            ok = false;
+            break;
+        }
+
+        /** walk backwards so finished jobs can be swapped out of the slots */
+        for (int i = num_running - 1; i >= 0; i--) {
+            exec_job_t *job = running[i];
+            bool expired = job->deadline && exec_now_ms() >= job->deadline;
+            if (!pfds[i].revents && !expired)
+                continue;
+
+            if (pfds[i].revents) {
+                ssize_t n = read(job->fd, chunk, sizeof(chunk));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n > 0 && exec_buf_append(&job->out, chunk, n) && !expired)
+                    continue;
+            }
+
+            close(job->fd);
+            job->fd = -1;
+            job->status = expired ? exec_kill(job->pid, job->cmd)
+                                  : exec_wait(job->pid, job->cmd, job->deadline);
+
+            num_running--;
+            running[i] = running[num_running];
+            pfds[i] = pfds[num_running];
+        }
+    }
+
+    /** only reached on error: reap whatever is still running */
+    for (int i = 0; i < num_running; i++) {
+        close(running[i]->fd);
+        running[i]->status = exec_kill(running[i]->pid, running[i]->cmd);
+    }
+
+    free(pfds);
+    free(running);
+    return ok;
+}
+
+/**
+ * @brief Runs a batch of commands concurrently and keeps their output, so
+ * that later calls of exec_cmd/exec_open for the same commands are served
+ * without running them again. Replaces any previous batch.
+ *
+ * @param cmds the commands
+ * @param num the number of commands
+ * @returns false if memory could not be allocated or poll failed
+ * (err_msg is set)
+ */
+bool exec_prefetch(char *const cmds[], int num)
+{
+    exec_cache_free();
+
+    exec_cache = calloc(num, sizeof(exec_job_t));
+    MEM_CHECK(exec_cache, false);
+    exec_cache_num = num;
+
+    for (int i = 0; i < num; i++) {
+        exec_cache[i].cmd = strdup(cmds[i]);
+        MEM_CHECK(exec_cache[i].cmd, false);
+    }
+
+    return exec_run_all(exec_cache, num, exec_max_jobs);
+}
+
+/**
+ * @brief Frees the output of prefetched commands
+ */
+void exec_cache_free(void)
+{
+    for (int i = 0; i < exec_cache_num; i++) {
+        free(exec_cache[i].cmd);
+        exec_buf_free(&exec_cache[i].out);
+    }
+    free(exec_cache);
+    exec_cache = NULL;
+    exec_cache_num = 0;
 }
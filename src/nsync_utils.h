@@ -17,9 +17,40 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <arpa/inet.h>
 
 #define ERR_LEN 10000
 #define MAX_OUTPUT_LEN 1000
+#define CMD_OUT_DELIM " \t\n"     // whitespace between the words of command output
+
+#define EXEC_MAX_ARGS 32
+#define EXEC_READ_LEN 4096
+#define EXEC_DEFAULT_JOBS 8
+#define EXEC_MAX_JOBS 1024          // each running command holds a pipe
+#define EXEC_DEFAULT_TIMEOUT_MS 10000
+#define EXEC_MAX_SECS (INT_MAX / 1000)     // longest -t/-T whose ms still fit an int
+#define EXEC_KILL_GRACE_MS 500
+#define EXEC_REAP_POLL_NS 5000000
+#define EXEC_TIMED_OUT -2
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+#define ARRAY_MIN_CAP 8
+
+/** Most columns an if_table_t can have, one bit of an interface's diff each */
+#define IF_TABLE_MAX_COLS 64
+/** Columns an address takes: its family and the two halves of its bytes */
+#define IF_TABLE_ADDR_COLS 3
+/** Bits of an interface's diff for the field at a column and the next n - 1 */
+#define IF_DIFF(col, n) ((((uint64_t)1 << (n)) - 1) << (col))
+
+/** Longest text of an address with its prefix length, e.g. <IPv6>/128 */
+#define IP_ADDR_STR_LEN (INET6_ADDRSTRLEN + 4)
+/** Prefix length of an address written without one */
+#define IP_NO_PREFIX 0xff
+#define IP_ADDR_IS_SET(addr) ((addr).family != AF_UNSPEC)
 
 
 #define MEM_CHECK(ptr, ret_fail)                        \
@@ -50,10 +81,198 @@
 
 extern void *fatal_err_ptr;
 
+/**
+ * @struct str_slice
+ * @brief a view of part of a string: not NUL-terminated, never owns its data
+ */
+typedef struct str_slice {
+    const char *ptr;
+    size_t len;
+} str_slice_t;
+
+/**
+ * @struct arena_block
+ * @brief one block of an arena, carved into allocations front to back
+ */
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t cap;
+    size_t used;
+    char data[] __attribute__((aligned(ARENA_ALIGN)));
+} arena_block_t;
+
+/**
+ * @struct arena
+ * @brief a bump allocator. Allocations are never freed one by one; all
+ * of them are released together by arena_reset.
+ */
+typedef struct arena {
+    arena_block_t *head;    // the block allocations are carved from
+    arena_block_t *full;    // blocks that are used up or hold one large allocation
+} arena_t;
+
+/**
+ * @struct bitset
+ * @brief one bit per index, sized once the number of indices is known
+ */
+typedef struct bitset {
+    uint64_t *words;
+    int num_bits;
+} bitset_t;
+
+/**
+ * @struct if_table
+ * @brief the compared fields of every interface, one column of 64-bit cells
+ * per field. A cell holds an interned string's pointer, a number, or part of
+ * an address, so two interfaces' fields are equal exactly when their cells
+ * are and whole columns compare with vector instructions. Columns are
+ * padded to a whole number of vectors.
+ */
+typedef struct if_table {
+    uint64_t *cols[IF_TABLE_MAX_COLS];
+    int num_cols;
+    int num_rows;
+} if_table_t;
+
+/** Cell of an if_table_t at a column and row */
+#define IF_CELL(table, col, row) ((table)->cols[col][row])
+
+/**
+ * @struct intern_table
+ * @brief one canonical copy of each distinct string, so two interned
+ * strings are equal exactly when their pointers are. Open addressing over a
+ * power-of-two number of slots; strings and slots live in an arena.
+ */
+typedef struct intern_table {
+    const char **slots;     // NULL for empty
+    uint32_t *hashes;       // hash of the string in each slot
+    int num;
+    int num_slots;
+} intern_table_t;
+
+/**
+ * @struct ip_addr
+ * @brief an IPv4 or IPv6 address or netmask, held in binary so equal
+ * addresses compare equal however they were written. Zeroed, it is unset.
+ */
+typedef struct ip_addr {
+    uint8_t family;         // AF_INET or AF_INET6, AF_UNSPEC when unset
+    uint8_t prefix_len;     // IP_NO_PREFIX unless written as <addr>/<len>
+    uint8_t bytes[16];      // network byte order; IPv4 uses the first 4
+} ip_addr_t;
+
+/**
+ * @brief Appends a zeroed element to a dynamic array allocated from an
+ * arena, doubling its capacity when it is full
+ * @param arena the arena
+ * @param arr the array, NULL until the first push
+ * @param num the number of elements, incremented
+ * @param cap the capacity of the array
+ * @returns a pointer to the new element, or NULL if memory could not be
+ * allocated (err_msg is set)
+ */
+#define ARRAY_PUSH(arena, arr, num, cap)                                                    \
+    ((arr) = arena_array_grow((arena), (arr), &(cap), (num) + 1, sizeof(*(arr))),          \
+     (arr) ? &(arr)[(num)++] : NULL)
+
+/**
+ * @struct exec_buf
+ * @brief a growable buffer holding the output of a command. It can be
+ * reused for several commands; each run overwrites the previous output.
+ */
+typedef struct exec_buf {
+    char *data;
+    size_t len;
+    size_t cap;
+} exec_buf_t;
+
+/** Called with each chunk of a command's output, returns false to stop reading */
+typedef bool (*exec_chunk_fn)(void *ctx, const char *buf, size_t len);
+
+/**
+ * @struct exec_job
+ * @brief one command of a batch run concurrently
+ */
+typedef struct exec_job {
+    char *cmd;
+    exec_buf_t out;
+    int status;             // exit status, -1 if the command could not be started
+    pid_t pid;
+    int fd;
+    long long deadline;     // monotonic ms, 0 for none
+    bool consumed;          // output already handed out by exec_cmd
+} exec_job_t;
+
+/** The arena parse results are allocated from, owned by net_sync_info_t */
+extern arena_t *parse_arena;
+
+/** The strings interned while parsing, owned by net_sync_info_t */
+extern intern_table_t *parse_strings;
+
+/** Most external commands run at once */
+extern int exec_max_jobs;
+
+/** Longest a single command may run in ms, 0 for no limit */
+extern int exec_timeout_ms;
+
 bool file_exists(const char *);
 
+char *file_read(const char *path, size_t *len, arena_t *arena);
+
 char *safe_strncpy(char *, const char *, size_t);
 
+str_slice_t slice_make(const char *str);
+
+int slice_split(str_slice_t src, const char *delim, str_slice_t *fields, int max);
+
+bool slice_next(str_slice_t *rest, const char *delim, str_slice_t *word);
+
+str_slice_t slice_field(str_slice_t src, size_t col, const char *delim);
+
+str_slice_t slice_trim(str_slice_t s, const char *seps);
+
+bool slice_eq(str_slice_t s, const char *str);
+
+char *slice_copy(char *dest, str_slice_t s, size_t destsz);
+
+char *slice_dup(str_slice_t s);
+
+const char *slice_intern(str_slice_t s);
+
+void *arena_alloc(arena_t *arena, size_t size);
+
+void *arena_grow(arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+
+char *arena_strndup(arena_t *arena, const char *str, size_t len);
+
+char *arena_strdup(arena_t *arena, const char *str);
+
+char *arena_strcat(arena_t *arena, char *str, const char *add, size_t len);
+
+void arena_reset(arena_t *arena);
+
+void *arena_array_grow(arena_t *arena, void *arr, int *cap, int need, size_t size);
+
+const char *intern(intern_table_t *table, arena_t *arena, str_slice_t str);
+
+const char *intern_find(const intern_table_t *table, str_slice_t str);
+
+void intern_reset(intern_table_t *table);
+
+bool bitset_init(bitset_t *set, int num_bits, arena_t *arena);
+
+void bitset_set(bitset_t *set, int i);
+
+bool bitset_test(const bitset_t *set, int i);
+
+int bitset_first_clear(const bitset_t *set);
+
+bool if_table_init(if_table_t *table, int num_cols, int num_rows, arena_t *arena);
+
+void if_table_set_addr(if_table_t *table, int col, int row, const ip_addr_t *addr);
+
+uint64_t *if_table_diff(const if_table_t *a, const if_table_t *b, arena_t *arena);
+
 char *get_field_delim(char *, char const *, size_t, size_t, const char *);
 
 char *ltrim(char *str, const char *seps);
@@ -64,6 +283,42 @@ char *trim(char *str, const char *seps);
 
 bool dir_check(const char *path);
 
-char *bitmask_to_netmask_ipv4(int bits);
+bool ip_addr_parse(str_slice_t text, ip_addr_t *addr);
+
+void ip_addr_set(ip_addr_t *addr, int family, const void *bytes, int prefix_len);
+
+void ip_addr_netmask(int bits, ip_addr_t *mask);
+
+int ip_netmask_len(const ip_addr_t *mask);
+
+bool ip_addr_eq(const ip_addr_t *a, const ip_addr_t *b);
+
+const char *ip_addr_str(const ip_addr_t *addr, char buf[IP_ADDR_STR_LEN]);
+
+int split_cmd(char *cmd, char *argv[], int max);
+
+void exec_set_budget(int ms);
+
+int exec_time_left(void);
+
+int exec_stream(char *const argv[], exec_chunk_fn on_chunk, void *ctx);
+
+int exec_argv(char *const argv[], exec_buf_t *out);
+
+int exec_cmd(const char *cmd, exec_buf_t *out);
+
+bool exec_read(const char *cmd, exec_buf_t *out);
+
+bool exec_read_stream(const char *cmd, exec_chunk_fn on_chunk, void *ctx);
+
+FILE *exec_open(const char *cmd, exec_buf_t *out);
+
+void exec_buf_free(exec_buf_t *buf);
+
+bool exec_run_all(exec_job_t *jobs, int num, int max_jobs);
+
+bool exec_prefetch(char *const cmds[], int num);
+
+void exec_cache_free(void);
 
 #endif
\ No newline at end of file